@@ -0,0 +1,180 @@
+/**
+ * Asian Cryptocurrency Payment System - HTTP/1.1 and HTTP/2 transport benchmark
+ * 
+ * Measures throughput and latency of getPayment() over HTTP/1.1 and over
+ * HTTP/2 with 1, 10 and 100 requests in flight. Qt negotiates HTTP/2 with
+ * ALPN, so this needs a TLS server that speaks both protocols and serves
+ * the files this program writes; README.md shows an h2o setup for that.
+ * 
+ * Write the payment files, start the server, then run:
+ *     bench_http2_transport --write-docroot /tmp/acp-docroot
+ *     bench_http2_transport --endpoint https://127.0.0.1:8443 --ca-cert cert.pem
+ */
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QSslConfiguration>
+#include <QTimer>
+#include <algorithm>
+#include <cstdio>
+
+#include "asian_crypto_payment.h"
+
+using namespace AsianCryptoPay;
+
+static QString benchPaymentId(int index) {
+    return QString("B%1").arg(index);
+}
+
+/**
+ * @brief Write the payment documents the server hands out
+ */
+static bool writeDocroot(const QString& root, int count) {
+    QDir dir(root);
+    if (!dir.mkpath("payments")) {
+        return false;
+    }
+    
+    QDateTime createdAt = QDateTime::currentDateTimeUtc();
+    for (int i = 0; i < count; ++i) {
+        QJsonObject payment;
+        payment["id"] = benchPaymentId(i);
+        payment["merchant_id"] = "MERCHANT-BENCH";
+        payment["amount"] = "25.00";
+        payment["currency"] = "MYR";
+        payment["crypto_amount"] = "0.00005612";
+        payment["crypto_currency"] = "BTC";
+        payment["status"] = "completed";
+        payment["created_at"] = createdAt.toString(Qt::ISODate);
+        payment["updated_at"] = createdAt.toString(Qt::ISODate);
+        payment["version"] = 3;
+        
+        QFile file(dir.filePath("payments/" + benchPaymentId(i)));
+        if (!file.open(QIODevice::WriteOnly)) {
+            return false;
+        }
+        file.write(QJsonDocument(payment).toJson(QJsonDocument::Compact));
+    }
+    
+    return true;
+}
+
+/**
+ * @brief Fetch the payments with a fixed number of requests in flight
+ */
+static void run(const QString& endpoint, bool http2, int concurrency, int count, int round) {
+    AsianCryptoPayment sdk(QString("bench-key-%1").arg(round), "MERCHANT-BENCH", CountryCode::Malaysia);
+    sdk.setApiEndpoint(endpoint);
+    sdk.setHttp2Enabled(http2);
+    sdk.setLaneConcurrency(RequestPriority::Normal, 0);
+    
+    // Let the connection pool warm up first
+    QEventLoop loop;
+    QTimer::singleShot(500, &loop, &QEventLoop::quit);
+    loop.exec();
+    
+    QHash<QString, qint64> startedAt;
+    QVector<double> latencies;
+    QElapsedTimer clock;
+    int next = 0;
+    int failed = 0;
+    
+    auto startNext = [&]() {
+        if (next < count) {
+            QString paymentId = benchPaymentId(next++);
+            startedAt.insert(paymentId, clock.nsecsElapsed());
+            sdk.getPayment(paymentId);
+        } else if (startedAt.isEmpty()) {
+            loop.quit();
+        }
+    };
+    
+    QObject::connect(&sdk, &AsianCryptoPayment::paymentRetrieved, &loop, [&](const Payment& payment) {
+        if (startedAt.contains(payment.id())) {
+            latencies.append((clock.nsecsElapsed() - startedAt.take(payment.id())) / 1e6);
+            startNext();
+        }
+    });
+    QObject::connect(&sdk, &AsianCryptoPayment::error, &loop, [&](int errorCode, const QString& errorMessage) {
+        // Errors do not name the payment, so the measurement ends here
+        failed++;
+        std::fprintf(stderr, "request failed: %d %s\n", errorCode, qPrintable(errorMessage));
+        loop.quit();
+    });
+    
+    clock.start();
+    for (int i = 0; i < concurrency; ++i) {
+        startNext();
+    }
+    loop.exec();
+    
+    double seconds = clock.nsecsElapsed() / 1e9;
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p) {
+        return latencies.isEmpty() ? 0.0 : latencies[qMin(latencies.size() - 1, int(p * latencies.size()))];
+    };
+    
+    RequestStatistics statistics = sdk.statistics();
+    std::printf("%-8s %11d %8d %6d %9.0f %8.2f %8.2f %9llu\n", http2 ? "h2" : "http/1.1", concurrency,
+                int(latencies.size()), failed, latencies.size() / seconds, percentile(0.50), percentile(0.99),
+                (unsigned long long)statistics.http2Requests);
+}
+
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+    
+    QCommandLineParser parser;
+    parser.setApplicationDescription("getPayment() throughput and latency over HTTP/1.1 and HTTP/2");
+    parser.addHelpOption();
+    
+    QCommandLineOption endpointOption("endpoint", "HTTPS server serving the payment files", "url");
+    QCommandLineOption caOption("ca-cert", "PEM certificate the server's certificate is checked against", "file");
+    QCommandLineOption requestsOption("requests", "Requests per measurement (default 2000)", "count", "2000");
+    QCommandLineOption docrootOption("write-docroot", "Write the payment files under this directory and exit", "dir");
+    parser.addOption(endpointOption);
+    parser.addOption(caOption);
+    parser.addOption(requestsOption);
+    parser.addOption(docrootOption);
+    parser.process(app);
+    
+    int count = qMax(1, parser.value(requestsOption).toInt());
+    
+    if (parser.isSet(docrootOption)) {
+        if (!writeDocroot(parser.value(docrootOption), count)) {
+            std::fprintf(stderr, "could not write the payment files\n");
+            return 1;
+        }
+        return 0;
+    }
+    
+    if (!parser.isSet(endpointOption)) {
+        parser.showHelp(1);
+    }
+    
+    if (parser.isSet(caOption)) {
+        QSslConfiguration config = QSslConfiguration::defaultConfiguration();
+        if (!config.addCaCertificates(parser.value(caOption))) {
+            std::fprintf(stderr, "could not read %s\n", qPrintable(parser.value(caOption)));
+            return 1;
+        }
+        QSslConfiguration::setDefaultConfiguration(config);
+    }
+    
+    std::printf("%-8s %11s %8s %6s %9s %8s %8s %9s\n", "protocol", "concurrency", "requests", "failed", "req/s",
+                "p50 ms", "p99 ms", "h2 count");
+    
+    int round = 0;
+    for (bool http2 : {false, true}) {
+        for (int concurrency : {1, 10, 100}) {
+            run(parser.value(endpointOption), http2, concurrency, count, round++);
+        }
+    }
+    
+    return 0;
+}
+
+#include "moc_asian_crypto_payment.cpp"
@@ -0,0 +1,86 @@
+/**
+ * Asian Cryptocurrency Payment System - createPayment() allocation benchmark
+ * 
+ * Counts the heap allocations, bytes and time one createPayment() call
+ * spends before it returns: validation, serializing and signing the body
+ * and handing the request to QNetworkAccessManager. The event loop never
+ * runs, so nothing is sent. Calls rotate over several SDK instances, as in
+ * a gateway serving many kiosks, and each instance stays within its
+ * create-payment rate budget so no call is held back in a queue.
+ * 
+ * Run it as:
+ *     bench_request_pipeline --instances 20 --calls 50
+ * 
+ * Build it with -DBENCHMARK_SDK_DIR=<older sdk/kiosk> to get the numbers
+ * for an earlier SDK.
+ */
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <cstdio>
+
+#include "asian_crypto_payment.h"
+#include "heap_counter.h"
+
+using namespace AsianCryptoPay;
+
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+    
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Heap allocations and time per createPayment() call");
+    parser.addHelpOption();
+    
+    QCommandLineOption instancesOption("instances", "SDK instances to rotate over (default 20)", "count", "20");
+    QCommandLineOption callsOption("calls", "Calls per instance, at most 50 (default 50)", "count", "50");
+    parser.addOption(instancesOption);
+    parser.addOption(callsOption);
+    parser.process(app);
+    
+    // Create-payment requests are limited to 60 a minute per API key
+    int instances = qMax(1, parser.value(instancesOption).toInt());
+    int calls = qBound(2, parser.value(callsOption).toInt(), 50);
+    
+    PaymentDetails details = PaymentDetails()
+        .setAmount(25.0)
+        .setCurrency("MYR")
+        .setCryptoCurrency("BTC")
+        .setDescription("Kiosk order")
+        .setOrderId("ORDER-1");
+    
+    unsigned long long allocations = 0;
+    long long bytes = 0;
+    qint64 nanoseconds = 0;
+    int measured = 0;
+    
+    for (int instance = 0; instance < instances; ++instance) {
+        AsianCryptoPayment sdk(QString("bench-key-%1").arg(instance), "MERCHANT-BENCH", CountryCode::Malaysia);
+        sdk.setApiEndpoint("http://127.0.0.1:9");
+        
+        // The first call sets up state later calls reuse
+        sdk.createPayment(details);
+        
+        for (int call = 1; call < calls; ++call) {
+            HeapCounter::Snapshot before = HeapCounter::snapshot();
+            QElapsedTimer timer;
+            timer.start();
+            
+            sdk.createPayment(details);
+            
+            nanoseconds += timer.nsecsElapsed();
+            HeapCounter::Snapshot after = HeapCounter::snapshot();
+            allocations += after.allocations - before.allocations;
+            bytes += after.allocatedBytes - before.allocatedBytes;
+            ++measured;
+        }
+    }
+    
+    std::printf("calls measured:         %d\n", measured);
+    std::printf("allocations per call:   %.1f\n", double(allocations) / measured);
+    std::printf("bytes allocated / call: %.0f\n", double(bytes) / measured);
+    std::printf("time per call:          %.2f us\n", double(nanoseconds) / measured / 1000.0);
+    return 0;
+}
+
+#include "moc_asian_crypto_payment.cpp"
@@ -0,0 +1,160 @@
+/**
+ * Asian Cryptocurrency Payment System - Status check scheduling benchmark
+ * 
+ * Compares the CPU time and heap the two ways the SDK has scheduled
+ * payment status checks cost at 1k, 10k and 100k tracked payments:
+ * 
+ *   timers   one repeating QTimer per payment, looked up through its
+ *            payment_id property when it fires (the SDK before the wheel)
+ *   wheel    one TimerWheel driven by a single QTimer ticking once a
+ *            second, rescheduling each payment after its check
+ * 
+ * Only the scheduling is measured: a check just counts. Payments start at
+ * random points within the first interval, as they are created over time.
+ * 
+ * Run it as:
+ *     bench_status_checks --seconds 30 --interval 10000
+ */
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QRandomGenerator>
+#include <QTimer>
+#include <cstdio>
+#include <ctime>
+#include <memory>
+
+#include "asian_crypto_payment.h"
+#include "heap_counter.h"
+
+using namespace AsianCryptoPay;
+
+class StatusCheckScheduler : public QObject {
+    Q_OBJECT
+
+public:
+    virtual void start(const QStringList& paymentIds, int intervalMs) = 0;
+    
+    quint64 checks = 0;
+};
+
+class TimerPerPayment : public StatusCheckScheduler {
+    Q_OBJECT
+
+public:
+    void start(const QStringList& paymentIds, int intervalMs) override {
+        for (const QString& paymentId : paymentIds) {
+            QTimer* timer = new QTimer(this);
+            timer->setProperty("payment_id", paymentId);
+            connect(timer, &QTimer::timeout, this, &TimerPerPayment::check);
+            m_timers.insert(paymentId, timer);
+            
+            QTimer::singleShot(QRandomGenerator::global()->bounded(intervalMs), timer, [timer, intervalMs]() {
+                timer->start(intervalMs);
+            });
+        }
+    }
+
+private slots:
+    void check() {
+        QTimer* timer = qobject_cast<QTimer*>(sender());
+        if (timer && m_timers.contains(timer->property("payment_id").toString())) {
+            checks++;
+        }
+    }
+
+private:
+    QMap<QString, QTimer*> m_timers;
+};
+
+class WheelForAllPayments : public StatusCheckScheduler {
+    Q_OBJECT
+
+public:
+    WheelForAllPayments() {
+        m_tickTimer = new QTimer(this);
+        connect(m_tickTimer, &QTimer::timeout, this, &WheelForAllPayments::advance);
+    }
+    
+    void start(const QStringList& paymentIds, int intervalMs) override {
+        m_intervalMs = intervalMs;
+        m_clock.start();
+        
+        for (const QString& paymentId : paymentIds) {
+            m_wheel.schedule(paymentId, 1 + QRandomGenerator::global()->bounded(intervalMs));
+        }
+        
+        m_tickTimer->start(m_wheel.tickMs());
+    }
+
+private slots:
+    void advance() {
+        for (const QString& paymentId : m_wheel.advance(m_clock.elapsed())) {
+            checks++;
+            m_wheel.schedule(paymentId, m_intervalMs);
+        }
+    }
+
+private:
+    TimerWheel m_wheel;
+    QTimer* m_tickTimer;
+    QElapsedTimer m_clock;
+    int m_intervalMs = 10000;
+};
+
+static void measure(const char* name, StatusCheckScheduler* scheduler, const QStringList& paymentIds,
+                    int intervalMs, int seconds) {
+    HeapCounter::Snapshot before = HeapCounter::snapshot();
+    std::clock_t cpuStart = std::clock();
+    
+    scheduler->start(paymentIds, intervalMs);
+    
+    QEventLoop loop;
+    QTimer::singleShot(seconds * 1000, &loop, &QEventLoop::quit);
+    loop.exec();
+    
+    double cpuMs = double(std::clock() - cpuStart) * 1000.0 / CLOCKS_PER_SEC;
+    long long heap = HeapCounter::snapshot().liveBytes - before.liveBytes;
+    std::printf("%8d %-7s %12.1f %12.2f %10llu\n", int(paymentIds.size()), name, double(heap) / paymentIds.size(),
+                cpuMs / seconds, (unsigned long long)scheduler->checks);
+}
+
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+    
+    QCommandLineParser parser;
+    parser.setApplicationDescription("CPU and heap cost of scheduling payment status checks");
+    parser.addHelpOption();
+    
+    QCommandLineOption secondsOption("seconds", "Run time per measurement (default 30)", "seconds", "30");
+    QCommandLineOption intervalOption("interval", "Check interval in ms (default 10000)", "ms", "10000");
+    parser.addOption(secondsOption);
+    parser.addOption(intervalOption);
+    parser.process(app);
+    
+    int seconds = qMax(1, parser.value(secondsOption).toInt());
+    int intervalMs = qMax(1000, parser.value(intervalOption).toInt());
+    
+    std::printf("%8s %-7s %12s %12s %10s\n", "payments", "mode", "heap B/pay", "CPU ms/s", "checks");
+    
+    for (int count : {1000, 10000, 100000}) {
+        QStringList paymentIds;
+        for (int i = 0; i < count; ++i) {
+            paymentIds.append(QString("PAY-%1").arg(i, 8, 10, QChar('0')));
+        }
+        
+        std::unique_ptr<StatusCheckScheduler> timers(new TimerPerPayment);
+        measure("timers", timers.get(), paymentIds, intervalMs, seconds);
+        timers.reset();
+        
+        std::unique_ptr<StatusCheckScheduler> wheel(new WheelForAllPayments);
+        measure("wheel", wheel.get(), paymentIds, intervalMs, seconds);
+    }
+    
+    return 0;
+}
+
+#include "bench_status_checks.moc"
+#include "moc_asian_crypto_payment.cpp"
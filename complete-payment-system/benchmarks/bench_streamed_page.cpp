@@ -0,0 +1,150 @@
+/**
+ * Asian Cryptocurrency Payment System - Payment page memory benchmark
+ * 
+ * Measures the peak heap used to read one large GET /payments page, fed
+ * in chunks the way a QNetworkReply delivers it, three ways:
+ * 
+ *   whole    the reply is buffered, parsed with QJsonDocument and every
+ *            entry turned into a Payment (the SDK before streaming)
+ *   streamed the reply goes through PaymentListStreamParser as it arrives
+ *            and the Payments are kept in a list (paymentsRetrieved)
+ *   handed   as streamed, but each Payment is handed on and dropped as
+ *            soon as it is decoded (streamPaymentHistory)
+ * 
+ * Run it as:
+ *     bench_streamed_page --payments 5000 --chunk 16384
+ */
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <cstdio>
+#include <functional>
+
+#include "asian_crypto_payment.h"
+#include "heap_counter.h"
+
+using namespace AsianCryptoPay;
+
+/**
+ * @brief Build a page holding the given number of payments
+ */
+static QByteArray buildPage(int count) {
+    QDateTime createdAt = QDateTime::fromMSecsSinceEpoch(1767225600000, Qt::UTC);
+    QJsonArray payments;
+    
+    for (int i = 0; i < count; ++i) {
+        QJsonObject payment;
+        payment["id"] = QString("PAY-%1").arg(i, 8, 10, QChar('0'));
+        payment["merchant_id"] = "MERCHANT-BENCH";
+        payment["amount"] = "25.00";
+        payment["currency"] = "MYR";
+        payment["crypto_amount"] = "0.00005612";
+        payment["crypto_currency"] = "BTC";
+        payment["description"] = "Kiosk order";
+        payment["order_id"] = QString("ORDER-%1").arg(i);
+        payment["address"] = "bc1qxy2kgdygjrsqtzq2n0yrf2493p83kkfjhx0wlh";
+        payment["qr_code_url"] = QString("https://api.asiancryptopay.com/qr/PAY-%1.png").arg(i);
+        payment["status"] = "completed";
+        payment["created_at"] = createdAt.addSecs(i).toString(Qt::ISODate);
+        payment["updated_at"] = createdAt.addSecs(i + 60).toString(Qt::ISODate);
+        payment["expires_at"] = createdAt.addSecs(i + 900).toString(Qt::ISODate);
+        payment["version"] = 3;
+        payment["metadata"] = QJsonObject{{"kiosk_id", "KIOSK-042"}, {"location", "Level 2"}};
+        payments.append(payment);
+    }
+    
+    QJsonObject page;
+    page["payments"] = payments;
+    page["total"] = count;
+    page["has_more"] = false;
+    return QJsonDocument(page).toJson(QJsonDocument::Compact);
+}
+
+static QList<Payment> readWhole(const QByteArray& page, int chunkSize) {
+    QByteArray body;
+    for (int offset = 0; offset < page.size(); offset += chunkSize) {
+        body.append(page.mid(offset, chunkSize));
+    }
+    
+    QList<Payment> payments;
+    const QJsonArray array = QJsonDocument::fromJson(body).object()["payments"].toArray();
+    for (const QJsonValue& value : array) {
+        payments.append(Payment::fromJson(value.toObject()));
+    }
+    
+    return payments;
+}
+
+static QList<Payment> readStreamed(const QByteArray& page, int chunkSize, bool keep) {
+    PaymentListStreamParser parser;
+    QList<Payment> payments;
+    int handedOn = 0;
+    
+    for (int offset = 0; offset < page.size(); offset += chunkSize) {
+        parser.feed(page.mid(offset, chunkSize));
+        
+        for (const QJsonObject& element : parser.takeElements()) {
+            Payment payment = Payment::fromJson(element);
+            if (keep) {
+                payments.append(payment);
+            } else {
+                handedOn += payment.id().isEmpty() ? 0 : 1;
+            }
+        }
+    }
+    
+    QJsonObject envelope;
+    if (!parser.finish(envelope)) {
+        std::fprintf(stderr, "page did not parse\n");
+    }
+    
+    if (!keep && handedOn == 0) {
+        std::fprintf(stderr, "no payments decoded\n");
+    }
+    
+    return payments;
+}
+
+static void measure(const char* name, const std::function<QList<Payment>()>& read) {
+    HeapCounter::Snapshot before = HeapCounter::snapshot();
+    HeapCounter::resetPeak();
+    QElapsedTimer timer;
+    timer.start();
+    
+    QList<Payment> payments = read();
+    
+    qint64 elapsed = timer.elapsed();
+    long long peak = HeapCounter::peakBytes() - before.liveBytes;
+    long long retained = HeapCounter::snapshot().liveBytes - before.liveBytes;
+    std::printf("%-9s %10.1f %12.1f %9lld %9d\n", name, peak / 1024.0, retained / 1024.0,
+                (long long)elapsed, int(payments.size()));
+}
+
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+    
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Peak heap used to read one large payment page");
+    parser.addHelpOption();
+    
+    QCommandLineOption paymentsOption("payments", "Payments on the page (default 5000)", "count", "5000");
+    QCommandLineOption chunkOption("chunk", "Bytes per network read (default 16384)", "bytes", "16384");
+    parser.addOption(paymentsOption);
+    parser.addOption(chunkOption);
+    parser.process(app);
+    
+    int count = qMax(1, parser.value(paymentsOption).toInt());
+    int chunkSize = qMax(1, parser.value(chunkOption).toInt());
+    
+    QByteArray page = buildPage(count);
+    std::printf("page: %d payments, %.1f KiB, read in %d byte chunks\n\n", count, page.size() / 1024.0, chunkSize);
+    std::printf("%-9s %10s %12s %9s %9s\n", "mode", "peak KiB", "retained KiB", "ms", "payments");
+    
+    measure("whole", [&]() { return readWhole(page, chunkSize); });
+    measure("streamed", [&]() { return readStreamed(page, chunkSize, true); });
+    measure("handed", [&]() { return readStreamed(page, chunkSize, false); });
+    return 0;
+}
+
+#include "moc_asian_crypto_payment.cpp"
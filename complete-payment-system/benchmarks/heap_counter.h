@@ -0,0 +1,144 @@
+/**
+ * Asian Cryptocurrency Payment System - Heap accounting for the benchmarks
+ * 
+ * Replaces malloc and its relatives for the whole process so that memory
+ * Qt allocates for QByteArray, QString and its containers is counted along
+ * with operator new. Each replacement forwards to glibc's own allocator.
+ * Include this header from exactly one translation unit per program.
+ */
+
+#ifndef HEAP_COUNTER_H
+#define HEAP_COUNTER_H
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <malloc.h>
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* pointer, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* pointer);
+}
+
+namespace HeapCounter {
+
+inline std::atomic<unsigned long long> g_allocations{0};
+inline std::atomic<long long> g_allocatedBytes{0};
+inline std::atomic<long long> g_liveBytes{0};
+inline std::atomic<long long> g_peakBytes{0};
+
+/**
+ * @brief Counters at one point in time
+ */
+struct Snapshot {
+    unsigned long long allocations;   // Allocations made so far
+    long long allocatedBytes;         // Bytes handed out so far, freed or not
+    long long liveBytes;              // Bytes currently allocated
+};
+
+inline void raisePeak(long long live) {
+    long long peak = g_peakBytes.load(std::memory_order_relaxed);
+    while (live > peak && !g_peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+}
+
+inline void recordAllocation(void* pointer) {
+    if (!pointer) {
+        return;
+    }
+    
+    long long size = (long long)malloc_usable_size(pointer);
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    raisePeak(g_liveBytes.fetch_add(size, std::memory_order_relaxed) + size);
+}
+
+inline void recordRelease(void* pointer) {
+    if (pointer) {
+        g_liveBytes.fetch_sub((long long)malloc_usable_size(pointer), std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Read the counters
+ * @return Current counters
+ */
+inline Snapshot snapshot() {
+    return {g_allocations.load(), g_allocatedBytes.load(), g_liveBytes.load()};
+}
+
+/**
+ * @brief Start a new peak measurement from the bytes allocated now
+ */
+inline void resetPeak() {
+    g_peakBytes.store(g_liveBytes.load());
+}
+
+/**
+ * @brief Get the most bytes allocated at once since resetPeak()
+ * @return Peak bytes
+ */
+inline long long peakBytes() {
+    return g_peakBytes.load();
+}
+
+} // namespace HeapCounter
+
+extern "C" {
+
+void* malloc(size_t size) noexcept {
+    void* pointer = __libc_malloc(size);
+    HeapCounter::recordAllocation(pointer);
+    return pointer;
+}
+
+void* calloc(size_t count, size_t size) noexcept {
+    void* pointer = __libc_calloc(count, size);
+    HeapCounter::recordAllocation(pointer);
+    return pointer;
+}
+
+void* realloc(void* pointer, size_t size) noexcept {
+    // Counted as a release of the old block and a new allocation
+    long long before = pointer ? (long long)malloc_usable_size(pointer) : 0;
+    void* result = __libc_realloc(pointer, size);
+    
+    if (result || size == 0) {
+        HeapCounter::g_liveBytes.fetch_sub(before, std::memory_order_relaxed);
+        HeapCounter::recordAllocation(result);
+    }
+    
+    return result;
+}
+
+void free(void* pointer) noexcept {
+    HeapCounter::recordRelease(pointer);
+    __libc_free(pointer);
+}
+
+void* memalign(size_t alignment, size_t size) noexcept {
+    void* pointer = __libc_memalign(alignment, size);
+    HeapCounter::recordAllocation(pointer);
+    return pointer;
+}
+
+void* aligned_alloc(size_t alignment, size_t size) noexcept {
+    return memalign(alignment, size);
+}
+
+int posix_memalign(void** result, size_t alignment, size_t size) noexcept {
+    void* pointer = memalign(alignment, size);
+    if (!pointer) {
+        return ENOMEM;
+    }
+    
+    *result = pointer;
+    return 0;
+}
+
+}
+
+#endif // HEAP_COUNTER_H
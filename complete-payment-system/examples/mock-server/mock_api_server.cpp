@@ -0,0 +1,889 @@
+/**
+ * Asian Cryptocurrency Payment System - Local Mock API Server
+ *
+ * A small HTTP/1.1 stand-in for api.asiancryptopay.com that lets the kiosk
+ * SDK be exercised without the live service. Payments are kept in memory and
+ * move from created to pending to completed as time passes. Responses can be
+ * delayed, failed at random and rate limited to test the SDK under load.
+ *
+ * Point the SDK at it with:
+ *     payment->setApiEndpoint("http://127.0.0.1:8080");
+ *
+ * and, to receive webhooks, run it with:
+ *     mock_api_server --webhook-url http://127.0.0.1:9090/hooks --webhook-secret secret
+ *
+ * With --push-port it also serves the WebSocket push channel:
+ *     payment->setPushEndpoint("ws://127.0.0.1:8081");
+ *
+ * The same events are always streamed as Server-Sent Events:
+ *     payment->setPushEndpoint("http://127.0.0.1:8080/events");
+ *
+ * Build it from complete-payment-system with:
+ *     cmake -S . -B build && cmake --build build --target mock_api_server
+ */
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QHostAddress>
+#include <QUrlQuery>
+#include <QWebSocketServer>
+#include <QWebSocket>
+
+#include "../../sdk/kiosk/asian_crypto_payment.h"
+
+using namespace AsianCryptoPay;
+
+/**
+ * @brief In-memory mock of the payment API
+ */
+class MockApiServer : public QObject {
+public:
+    /**
+     * @brief Parsed HTTP request
+     */
+    struct HttpRequest {
+        QByteArray method;
+        QString path;
+        QUrlQuery query;
+        QMap<QByteArray, QByteArray> headers;
+        QByteArray body;
+    };
+    
+    /**
+     * @brief HTTP response to be written back
+     */
+    struct HttpResponse {
+        int status = 200;
+        QJsonObject body;
+        QMap<QByteArray, QByteArray> headers;
+    };
+    
+    /**
+     * @brief Constructor
+     * @param parent Parent QObject
+     */
+    MockApiServer(QObject* parent = nullptr)
+        : QObject(parent)
+        , m_server(new QTcpServer(this))
+        , m_webhookClient(new QNetworkAccessManager(this))
+        , m_lifecycleTimer(new QTimer(this))
+        , m_heartbeatTimer(new QTimer(this))
+    {
+        connect(m_server, &QTcpServer::newConnection, this, &MockApiServer::onNewConnection);
+        
+        // Comment lines keep idle event streams from looking dead to clients and proxies
+        connect(m_heartbeatTimer, &QTimer::timeout, this, [this]() {
+            for (QTcpSocket* socket : m_eventStreams) {
+                socket->write(": ping\n\n");
+            }
+        });
+        
+        // Without webhooks or push payments only advance when they are read
+        connect(m_lifecycleTimer, &QTimer::timeout, this, [this]() {
+            for (const QString& id : m_payments.keys()) {
+                advance(id);
+            }
+        });
+    }
+    
+    /**
+     * @brief Start listening on localhost
+     * @param port TCP port
+     * @return Whether the server is listening
+     */
+    bool listen(quint16 port) {
+        return m_server->listen(QHostAddress::LocalHost, port);
+    }
+    
+    /**
+     * @brief Enable or disable multi-id lookup (GET /payments?ids=a,b)
+     * @param enabled Whether batch lookups are answered; if not, they get 400
+     */
+    void setBatchLookupEnabled(bool enabled) { m_batchLookupEnabled = enabled; }
+    
+    /**
+     * @brief Set the smallest response body sent deflated
+     * @param bytes Threshold in bytes; responses are only compressed for
+     *              clients that send Accept-Encoding: deflate
+     */
+    void setCompressionThreshold(int bytes) { m_compressionThreshold = bytes; }
+    
+    /**
+     * @brief Set payment lifecycle timings
+     * @param pendingAfter Seconds until a new payment becomes pending
+     * @param completeAfter Seconds until a new payment completes
+     */
+    void setLifecycle(int pendingAfter, int completeAfter) {
+        m_pendingAfter = pendingAfter;
+        m_completeAfter = completeAfter;
+    }
+    
+    /**
+     * @brief Delay every response
+     * @param latencyMs Fixed delay in milliseconds
+     * @param jitterMs Random extra delay of up to this many milliseconds
+     */
+    void setLatency(int latencyMs, int jitterMs) {
+        m_latencyMs = qMax(0, latencyMs);
+        m_jitterMs = qMax(0, jitterMs);
+    }
+    
+    /**
+     * @brief Fail a share of requests with 503 before they are handled
+     * @param errorRate Share of requests to fail (0.0 - 1.0)
+     */
+    void setErrorRate(double errorRate) { m_errorRate = errorRate; }
+    
+    /**
+     * @brief Scale the documented per-minute rate limits
+     * @param scale Multiplier for every limit; 0 disables rate limiting
+     */
+    void setRateLimitScale(double scale) { m_rateLimitScale = scale; }
+    
+    /**
+     * @brief Deliver signed webhook events for payment changes
+     * @param url Callback URL; an empty URL disables webhooks
+     * @param secret Webhook secret used for X-Webhook-Signature
+     */
+    void setWebhook(const QString& url, const QString& secret) {
+        m_webhookUrl = url;
+        m_webhookSecret = secret;
+        updateLifecycleTimer();
+    }
+    
+    /**
+     * @brief Serve the WebSocket push channel on localhost
+     * 
+     * Clients send {"type":"subscribe","payment_ids":[...],"resume_from":n}
+     * and {"type":"unsubscribe","payment_ids":[...]}. Events carry a global
+     * sequence and the time they were sent (sent_at, ms since epoch), so
+     * clients can measure delivery latency; the last 1000 are kept for
+     * resuming.
+     * 
+     * @param port TCP port
+     * @return Whether the push server is listening
+     */
+    bool listenForPush(quint16 port) {
+        m_pushServer = new QWebSocketServer("mock-push", QWebSocketServer::NonSecureMode, this);
+        connect(m_pushServer, &QWebSocketServer::newConnection, this, &MockApiServer::onPushConnection);
+        updateLifecycleTimer();
+        return m_pushServer->listen(QHostAddress::LocalHost, port);
+    }
+
+private:
+    QTcpServer* m_server;
+    QNetworkAccessManager* m_webhookClient;
+    QTimer* m_lifecycleTimer;
+    QTimer* m_heartbeatTimer;
+    QMap<QTcpSocket*, QByteArray> m_buffers;
+    QMap<QTcpSocket*, qint64> m_socketDueAt;
+    QMap<QString, QJsonObject> m_payments;
+    QMap<QString, QPair<qint64, int>> m_rateWindows;
+    bool m_batchLookupEnabled = true;
+    int m_pendingAfter = 5;
+    int m_completeAfter = 30;
+    int m_nextPaymentNumber = 1;
+    int m_compressionThreshold = 1024;
+    qint64 m_uncompressedBytes = 0;
+    qint64 m_compressedBytes = 0;
+    int m_latencyMs = 0;
+    int m_jitterMs = 0;
+    double m_errorRate = 0.0;
+    double m_rateLimitScale = 1.0;
+    QString m_webhookUrl;
+    QString m_webhookSecret;
+    QWebSocketServer* m_pushServer = nullptr;
+    QMap<QWebSocket*, QSet<QString>> m_pushSubscriptions;
+    QSet<QTcpSocket*> m_eventStreams;
+    QList<QJsonObject> m_pushLog;
+    qint64 m_pushSequence = 0;
+    
+    void updateLifecycleTimer() {
+        if (m_webhookUrl.isEmpty() && !m_pushServer && m_eventStreams.isEmpty()) {
+            m_lifecycleTimer->stop();
+        } else {
+            m_lifecycleTimer->start(1000);
+        }
+    }
+    
+    void onNewConnection() {
+        while (m_server->hasPendingConnections()) {
+            QTcpSocket* socket = m_server->nextPendingConnection();
+            
+            connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+                onReadyRead(socket);
+            });
+            connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+                m_buffers.remove(socket);
+                m_socketDueAt.remove(socket);
+                if (m_eventStreams.remove(socket)) {
+                    if (m_eventStreams.isEmpty()) {
+                        m_heartbeatTimer->stop();
+                    }
+                    updateLifecycleTimer();
+                }
+                socket->deleteLater();
+            });
+        }
+    }
+    
+    void onReadyRead(QTcpSocket* socket) {
+        if (m_eventStreams.contains(socket)) {
+            socket->readAll();
+            return;
+        }
+        
+        QByteArray& buffer = m_buffers[socket];
+        buffer.append(socket->readAll());
+        
+        // Answer every complete request in the buffer (keep-alive, pipelining)
+        HttpRequest request;
+        while (takeRequest(buffer, request)) {
+            if (request.method == "GET" && request.path == "/events") {
+                openEventStream(socket, request);
+                return;
+            }
+            
+            scheduleResponse(socket, request, handle(request));
+            request = HttpRequest();
+        }
+    }
+    
+    /**
+     * @brief Turn a connection into a Server-Sent Events stream
+     * 
+     * The stream carries every payment event with its sequence as the event
+     * id, so a reconnecting client can resume with Last-Event-ID. It opens
+     * with the same "subscribed" acknowledgement as the WebSocket channel.
+     */
+    void openEventStream(QTcpSocket* socket, const HttpRequest& request) {
+        const int heartbeatIntervalMs = 10000;
+        
+        m_buffers.remove(socket);
+        socket->write("HTTP/1.1 200 OK\r\n"
+                      "Content-Type: text/event-stream\r\n"
+                      "Cache-Control: no-cache\r\n"
+                      "Connection: close\r\n\r\n");
+        
+        qint64 resumeFrom = request.headers.value("last-event-id").toLongLong();
+        bool resumed = request.headers.contains("last-event-id") && canResumeAfter(resumeFrom);
+        
+        QJsonObject ack;
+        ack["type"] = "subscribed";
+        ack["sequence"] = double(m_pushSequence);
+        ack["resumed"] = resumed;
+        socket->write("data: " + QJsonDocument(ack).toJson(QJsonDocument::Compact) + "\n\n");
+        
+        if (resumed) {
+            for (const QJsonObject& event : m_pushLog) {
+                if (qint64(event["sequence"].toDouble()) > resumeFrom) {
+                    writeStreamEvent(socket, event);
+                }
+            }
+        }
+        
+        m_eventStreams.insert(socket);
+        if (!m_heartbeatTimer->isActive()) {
+            m_heartbeatTimer->start(heartbeatIntervalMs);
+        }
+        updateLifecycleTimer();
+    }
+    
+    void writeStreamEvent(QTcpSocket* socket, const QJsonObject& event) {
+        socket->write("id: " + QByteArray::number(qint64(event["sequence"].toDouble())) + "\n" +
+                      "data: " + QJsonDocument(event).toJson(QJsonDocument::Compact) + "\n\n");
+    }
+    
+    // Resuming works while the log still holds the first missed event
+    bool canResumeAfter(qint64 sequence) const {
+        qint64 oldest = m_pushLog.isEmpty() ? m_pushSequence + 1 : qint64(m_pushLog.first()["sequence"].toDouble());
+        return sequence + 1 >= oldest && sequence <= m_pushSequence;
+    }
+    
+    bool takeRequest(QByteArray& buffer, HttpRequest& request) {
+        int headerEnd = buffer.indexOf("\r\n\r\n");
+        if (headerEnd < 0) {
+            return false;
+        }
+        
+        QList<QByteArray> lines = buffer.left(headerEnd).split('\n');
+        QList<QByteArray> requestLine = lines.first().trimmed().split(' ');
+        if (requestLine.size() < 2) {
+            buffer.clear();
+            return false;
+        }
+        
+        for (int i = 1; i < lines.size(); ++i) {
+            int colon = lines[i].indexOf(':');
+            if (colon > 0) {
+                request.headers[lines[i].left(colon).trimmed().toLower()] = lines[i].mid(colon + 1).trimmed();
+            }
+        }
+        
+        int contentLength = request.headers.value("content-length").toInt();
+        if (buffer.size() < headerEnd + 4 + contentLength) {
+            return false;
+        }
+        
+        QUrl url(QString::fromLatin1(requestLine[1]));
+        request.method = requestLine[0];
+        request.path = url.path();
+        request.query = QUrlQuery(url);
+        request.body = buffer.mid(headerEnd + 4, contentLength);
+        buffer.remove(0, headerEnd + 4 + contentLength);
+        
+        // qUncompress expects the zlib stream behind a big-endian size hint
+        if (request.headers.value("content-encoding") == "deflate") {
+            QByteArray sizeHint(4, '\0');
+            quint32 size = quint32(request.body.size()) * 8;
+            for (int i = 0; i < 4; ++i) {
+                sizeHint[i] = char(size >> (24 - 8 * i));
+            }
+            request.body = qUncompress(sizeHint + request.body);
+        }
+        
+        return true;
+    }
+    
+    HttpResponse handle(const HttpRequest& request) {
+        QMap<QByteArray, QByteArray> rateLimitHeaders;
+        
+        if (m_rateLimitScale > 0 && !takeRateLimitToken(request, rateLimitHeaders)) {
+            HttpResponse response = errorResponse(429, "rate_limit_exceeded", "Rate limit exceeded");
+            response.headers = rateLimitHeaders;
+            return response;
+        }
+        
+        // Injected failures are decided before routing so they have no side effects
+        if (m_errorRate > 0 && QRandomGenerator::global()->generateDouble() < m_errorRate) {
+            HttpResponse response = errorResponse(503, "service_unavailable", "Injected failure");
+            response.headers = rateLimitHeaders;
+            return response;
+        }
+        
+        HttpResponse response = route(request);
+        for (auto it = rateLimitHeaders.begin(); it != rateLimitHeaders.end(); ++it) {
+            response.headers[it.key()] = it.value();
+        }
+        return response;
+    }
+    
+    bool takeRateLimitToken(const HttpRequest& request, QMap<QByteArray, QByteArray>& headers) {
+        // Documented per-minute limits, one fixed window per endpoint class
+        QString endpointClass = "other";
+        int limit = 60;
+        
+        if (request.path.startsWith("/payments")) {
+            endpointClass = request.method == "GET" ? "payments_get" : "payments_post";
+            limit = request.method == "GET" ? 120 : 60;
+        } else if (request.path.startsWith("/exchange-rates")) {
+            endpointClass = "exchange_rates";
+            limit = 300;
+        }
+        
+        limit = qMax(1, int(limit * m_rateLimitScale));
+        
+        qint64 windowStart = QDateTime::currentSecsSinceEpoch() / 60 * 60;
+        QPair<qint64, int>& window = m_rateWindows[endpointClass];
+        if (window.first != windowStart) {
+            window = qMakePair(windowStart, 0);
+        }
+        
+        bool allowed = window.second < limit;
+        if (allowed) {
+            window.second++;
+        }
+        
+        headers["X-RateLimit-Limit"] = QByteArray::number(limit);
+        headers["X-RateLimit-Remaining"] = QByteArray::number(limit - window.second);
+        headers["X-RateLimit-Reset"] = QByteArray::number(windowStart + 60);
+        if (!allowed) {
+            headers["Retry-After"] = QByteArray::number(windowStart + 60 - QDateTime::currentSecsSinceEpoch());
+        }
+        
+        return allowed;
+    }
+    
+    HttpResponse route(const HttpRequest& request) {
+        QStringList segments = request.path.split('/', Qt::SkipEmptyParts);
+        
+        if (segments.value(0) == "payments") {
+            if (segments.size() == 1 && request.method == "POST") {
+                return createPayment(request);
+            }
+            if (segments.size() == 1 && request.method == "GET") {
+                return listPayments(request);
+            }
+            if (segments.size() == 2 && request.method == "GET") {
+                return getPayment(segments[1]);
+            }
+            if (segments.size() == 3 && segments[2] == "cancel" && request.method == "POST") {
+                return cancelPayment(segments[1]);
+            }
+        }
+        
+        if (segments.value(0) == "exchange-rates" && segments.size() == 1 && request.method == "GET") {
+            return exchangeRates(request);
+        }
+        
+        return errorResponse(404, "resource_not_found", "No such endpoint");
+    }
+    
+    HttpResponse createPayment(const HttpRequest& request) {
+        QJsonObject details = QJsonDocument::fromJson(request.body).object();
+        QDateTime now = QDateTime::currentDateTimeUtc();
+        QString id = QString("PAY-%1").arg(m_nextPaymentNumber++, 6, 10, QChar('0'));
+        
+        QJsonObject payment = details;
+        payment["id"] = id;
+        payment["crypto_amount"] = QString::number(details["amount"].toString().toDouble() / 42631.25, 'f', 8);
+        payment["address"] = "bc1q" + QUuid::createUuid().toString(QUuid::Id128).left(38);
+        payment["qr_code_url"] = "http://127.0.0.1/qr/" + id + ".png";
+        payment["status"] = "created";
+        payment["created_at"] = now.toString(Qt::ISODate);
+        payment["updated_at"] = now.toString(Qt::ISODate);
+        payment["expires_at"] = now.addSecs(30 * 60).toString(Qt::ISODate);
+        payment["version"] = 1;
+        
+        // Round-trip through the SDK model so responses match what it parses
+        m_payments[id] = Payment::fromJson(payment).toJson();
+        publish("payment.created", m_payments[id]);
+        
+        HttpResponse response;
+        response.status = 201;
+        response.body = m_payments[id];
+        return response;
+    }
+    
+    HttpResponse getPayment(const QString& id) {
+        if (!m_payments.contains(id)) {
+            return errorResponse(404, "resource_not_found", "Payment not found");
+        }
+        
+        HttpResponse response;
+        response.body = advance(id);
+        return response;
+    }
+    
+    HttpResponse cancelPayment(const QString& id) {
+        if (!m_payments.contains(id)) {
+            return errorResponse(404, "resource_not_found", "Payment not found");
+        }
+        
+        QString status = advance(id)["status"].toString();
+        if (status != "created" && status != "pending") {
+            return errorResponse(409, "invalid_state", "Payment can no longer be cancelled");
+        }
+        
+        QJsonObject& payment = m_payments[id];
+        payment["status"] = "cancelled";
+        payment["updated_at"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+        payment["version"] = payment["version"].toDouble() + 1;
+        publish("payment.cancelled", payment);
+        
+        HttpResponse response;
+        response.body = payment;
+        return response;
+    }
+    
+    HttpResponse listPayments(const HttpRequest& request) {
+        QStringList ids;
+        
+        if (request.query.hasQueryItem("ids")) {
+            if (!m_batchLookupEnabled) {
+                return errorResponse(400, "invalid_request", "Unknown parameter: ids");
+            }
+            ids = request.query.queryItemValue("ids").split(',', Qt::SkipEmptyParts);
+        } else {
+            ids = m_payments.keys();
+        }
+        
+        int limit = request.query.hasQueryItem("limit") ? request.query.queryItemValue("limit").toInt() : 20;
+        int offset = request.query.queryItemValue("offset").toInt();
+        
+        if (request.query.hasQueryItem("updated_since")) {
+            return listChangedPayments(request, ids, limit);
+        }
+        
+        QJsonArray payments;
+        int total = 0;
+        for (const QString& id : ids) {
+            if (!m_payments.contains(id)) {
+                continue;
+            }
+            if (total >= offset && total < offset + limit) {
+                payments.append(advance(id));
+            }
+            ++total;
+        }
+        
+        HttpResponse response;
+        response.body["total"] = total;
+        response.body["limit"] = limit;
+        response.body["offset"] = offset;
+        response.body["has_more"] = offset + limit < total;
+        response.body["payments"] = payments;
+        return response;
+    }
+    
+    HttpResponse listChangedPayments(const HttpRequest& request, const QStringList& ids, int limit) {
+        QDateTime since = QDateTime::fromString(request.query.queryItemValue("updated_since"), Qt::ISODate);
+        if (!since.isValid()) {
+            return errorResponse(400, "invalid_request", "Invalid updated_since");
+        }
+        QString afterId = request.query.queryItemValue("after_id");
+        
+        // Order by (updated_at, id) and return what sorts after the mark
+        QMap<QPair<QDateTime, QString>, QJsonObject> changed;
+        for (const QString& id : ids) {
+            if (!m_payments.contains(id)) {
+                continue;
+            }
+            QJsonObject payment = advance(id);
+            QDateTime updatedAt = QDateTime::fromString(payment["updated_at"].toString(), Qt::ISODate);
+            if (updatedAt > since || (updatedAt == since && id > afterId)) {
+                changed.insert(qMakePair(updatedAt, id), payment);
+            }
+        }
+        
+        QJsonArray payments;
+        for (auto it = changed.constBegin(); it != changed.constEnd() && payments.size() < limit; ++it) {
+            payments.append(it.value());
+        }
+        
+        HttpResponse response;
+        response.body["total"] = changed.size();
+        response.body["limit"] = limit;
+        response.body["has_more"] = changed.size() > limit;
+        response.body["payments"] = payments;
+        return response;
+    }
+    
+    HttpResponse exchangeRates(const HttpRequest& request) {
+        // Fixed SGD prices converted with fixed fiat rates
+        static const QMap<QString, double> cryptoPrices = {
+            {"BTC", 42631.25}, {"ETH", 2845.67}, {"USDT", 1.35}, {"USDC", 1.35}, {"BNB", 412.30}
+        };
+        static const QMap<QString, double> fiatRates = {
+            {"SGD", 1.0}, {"MYR", 3.48}, {"IDR", 11800.0}, {"THB", 26.9}, {"BND", 1.0},
+            {"KHR", 3040.0}, {"VND", 18900.0}, {"LAK", 16200.0}, {"USD", 0.74}
+        };
+        
+        QString baseCurrency = request.query.queryItemValue("base_currency");
+        if (!fiatRates.contains(baseCurrency)) {
+            return errorResponse(400, "invalid_currency", "Unsupported base currency");
+        }
+        
+        QStringList currencies = request.query.queryItemValue("currencies").split(',', Qt::SkipEmptyParts);
+        if (currencies.isEmpty()) {
+            currencies = cryptoPrices.keys();
+        }
+        
+        QJsonObject rates;
+        for (const QString& currency : currencies) {
+            if (cryptoPrices.contains(currency)) {
+                rates[currency] = QString::number(cryptoPrices[currency] * fiatRates[baseCurrency], 'f', 2);
+            }
+        }
+        
+        HttpResponse response;
+        response.body["base_currency"] = baseCurrency;
+        response.body["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+        response.body["rates"] = rates;
+        return response;
+    }
+    
+    QJsonObject advance(const QString& id) {
+        QJsonObject& payment = m_payments[id];
+        QDateTime now = QDateTime::currentDateTimeUtc();
+        qint64 age = QDateTime::fromString(payment["created_at"].toString(), Qt::ISODate).secsTo(now);
+        
+        QString status = payment["status"].toString();
+        QString next = status;
+        
+        if (status == "created" && age >= m_pendingAfter) {
+            next = "pending";
+        }
+        if ((status == "created" || status == "pending") && age >= m_completeAfter) {
+            next = "completed";
+        }
+        
+        if (next != status) {
+            payment["status"] = next;
+            payment["updated_at"] = now.toString(Qt::ISODate);
+            payment["version"] = payment["version"].toDouble() + 1;
+            publish(next == "completed" ? "payment.completed" : "payment.updated", payment);
+        }
+        
+        return payment;
+    }
+    
+    void publish(const QString& type, const QJsonObject& payment) {
+        deliverWebhook(type, payment);
+        pushEvent(type, payment);
+    }
+    
+    void pushEvent(const QString& type, const QJsonObject& payment) {
+        const int maxLoggedEvents = 1000;
+        
+        QJsonObject event;
+        event["type"] = type;
+        event["event"] = type;
+        event["sequence"] = double(++m_pushSequence);
+        event["sent_at"] = double(QDateTime::currentMSecsSinceEpoch());
+        event["data"] = payment;
+        
+        m_pushLog.append(event);
+        if (m_pushLog.size() > maxLoggedEvents) {
+            m_pushLog.removeFirst();
+        }
+        
+        QString message = QString::fromUtf8(QJsonDocument(event).toJson(QJsonDocument::Compact));
+        for (auto it = m_pushSubscriptions.begin(); it != m_pushSubscriptions.end(); ++it) {
+            if (it.value().contains(payment["id"].toString())) {
+                it.key()->sendTextMessage(message);
+            }
+        }
+        
+        for (QTcpSocket* socket : m_eventStreams) {
+            writeStreamEvent(socket, event);
+        }
+    }
+    
+    void onPushConnection() {
+        while (QWebSocket* socket = m_pushServer->nextPendingConnection()) {
+            m_pushSubscriptions.insert(socket, QSet<QString>());
+            
+            connect(socket, &QWebSocket::textMessageReceived, this, [this, socket](const QString& message) {
+                onPushMessage(socket, message);
+            });
+            connect(socket, &QWebSocket::disconnected, this, [this, socket]() {
+                m_pushSubscriptions.remove(socket);
+                socket->deleteLater();
+            });
+        }
+    }
+    
+    void onPushMessage(QWebSocket* socket, const QString& message) {
+        QJsonObject request = QJsonDocument::fromJson(message.toUtf8()).object();
+        QSet<QString>& subscriptions = m_pushSubscriptions[socket];
+        
+        for (const QJsonValue& id : request["payment_ids"].toArray()) {
+            if (request["type"].toString() == "unsubscribe") {
+                subscriptions.remove(id.toString());
+            } else {
+                subscriptions.insert(id.toString());
+            }
+        }
+        
+        if (request["type"].toString() != "subscribe") {
+            return;
+        }
+        
+        qint64 resumeFrom = qint64(request["resume_from"].toDouble());
+        bool resumed = request.contains("resume_from") && canResumeAfter(resumeFrom);
+        
+        QJsonObject ack;
+        ack["type"] = "subscribed";
+        ack["sequence"] = double(m_pushSequence);
+        ack["resumed"] = resumed;
+        socket->sendTextMessage(QString::fromUtf8(QJsonDocument(ack).toJson(QJsonDocument::Compact)));
+        
+        if (!resumed) {
+            return;
+        }
+        
+        for (const QJsonObject& event : m_pushLog) {
+            if (qint64(event["sequence"].toDouble()) > resumeFrom &&
+                    subscriptions.contains(event["data"].toObject()["id"].toString())) {
+                socket->sendTextMessage(QString::fromUtf8(QJsonDocument(event).toJson(QJsonDocument::Compact)));
+            }
+        }
+    }
+    
+    void deliverWebhook(const QString& type, const QJsonObject& payment) {
+        if (m_webhookUrl.isEmpty()) {
+            return;
+        }
+        
+        QJsonObject event;
+        event["type"] = type;
+        event["event"] = type;
+        event["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+        event["data"] = payment;
+        
+        // Signed over the compact JSON, as AsianCryptoPayment::processWebhookEvent verifies it
+        QByteArray body = QJsonDocument(event).toJson(QJsonDocument::Compact);
+        QByteArray signature = QMessageAuthenticationCode::hash(body, m_webhookSecret.toUtf8(),
+                                                                QCryptographicHash::Sha256).toHex();
+        
+        QNetworkRequest request{QUrl(m_webhookUrl)};
+        request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+        request.setRawHeader("X-Webhook-Signature", signature);
+        
+        QNetworkReply* reply = m_webhookClient->post(request, body);
+        connect(reply, &QNetworkReply::finished, reply, &QNetworkReply::deleteLater);
+    }
+    
+    HttpResponse errorResponse(int status, const QString& code, const QString& message) {
+        QJsonObject error;
+        error["code"] = code;
+        error["message"] = message;
+        
+        HttpResponse response;
+        response.status = status;
+        response.body["error"] = error;
+        return response;
+    }
+    
+    void scheduleResponse(QTcpSocket* socket, const HttpRequest& request, const HttpResponse& response) {
+        qint64 now = QDateTime::currentMSecsSinceEpoch();
+        qint64 delay = m_latencyMs + (m_jitterMs > 0 ? QRandomGenerator::global()->bounded(m_jitterMs + 1) : 0);
+        
+        // Responses on one connection must leave in request order
+        qint64 dueAt = qMax(now + delay, m_socketDueAt.value(socket));
+        m_socketDueAt[socket] = dueAt;
+        
+        if (dueAt <= now) {
+            writeResponse(socket, request, response);
+            return;
+        }
+        
+        QPointer<QTcpSocket> target(socket);
+        QTimer::singleShot(int(dueAt - now), this, [this, target, request, response]() {
+            if (target) {
+                writeResponse(target, request, response);
+            }
+        });
+    }
+    
+    void writeResponse(QTcpSocket* socket, const HttpRequest& request, const HttpResponse& response) {
+        QByteArray body = QJsonDocument(response.body).toJson(QJsonDocument::Compact);
+        int status = response.status;
+        
+        // Strong validator over the body so unchanged resources revalidate as 304
+        QByteArray etag;
+        if (request.method == "GET" && status == 200) {
+            etag = "\"" + QCryptographicHash::hash(body, QCryptographicHash::Sha256).toHex().left(16) + "\"";
+            
+            if (request.headers.value("if-none-match") == etag) {
+                status = 304;
+                body.clear();
+            }
+        }
+        
+        // Deflate larger bodies for clients that accept it and report the saving
+        bool deflated = false;
+        if (body.size() >= m_compressionThreshold && request.headers.value("accept-encoding").contains("deflate")) {
+            QByteArray compressed = qCompress(body).mid(4);
+            
+            m_uncompressedBytes += body.size();
+            m_compressedBytes += compressed.size();
+            qInfo().noquote() << QString("%1 %2: %3 -> %4 bytes (total %5 -> %6)")
+                    .arg(QString::fromLatin1(request.method), request.path)
+                    .arg(body.size()).arg(compressed.size())
+                    .arg(m_uncompressedBytes).arg(m_compressedBytes);
+            
+            body = compressed;
+            deflated = true;
+        }
+        
+        QByteArray head;
+        head += "HTTP/1.1 " + QByteArray::number(status) + " " + reasonPhrase(status) + "\r\n";
+        head += "Content-Type: application/json\r\n";
+        if (deflated) {
+            head += "Content-Encoding: deflate\r\n";
+        }
+        if (!etag.isEmpty()) {
+            head += "ETag: " + etag + "\r\n";
+        }
+        for (auto it = response.headers.begin(); it != response.headers.end(); ++it) {
+            head += it.key() + ": " + it.value() + "\r\n";
+        }
+        head += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+        head += "Connection: keep-alive\r\n\r\n";
+        
+        socket->write(head + body);
+    }
+    
+    static QByteArray reasonPhrase(int status) {
+        switch (status) {
+            case 200: return "OK";
+            case 201: return "Created";
+            case 304: return "Not Modified";
+            case 400: return "Bad Request";
+            case 404: return "Not Found";
+            case 409: return "Conflict";
+            case 429: return "Too Many Requests";
+            case 503: return "Service Unavailable";
+            default: return "Unknown";
+        }
+    }
+};
+
+/**
+ * Main function to run the mock API server
+ */
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Local mock of the Asian Crypto Payment API");
+    parser.addHelpOption();
+    
+    QCommandLineOption portOption("port", "Port to listen on.", "port", "8080");
+    QCommandLineOption noBatchOption("no-batch", "Reject multi-id lookups (GET /payments?ids=...).");
+    QCommandLineOption completeOption("complete-after", "Seconds until a payment completes.", "seconds", "30");
+    QCommandLineOption compressOption("compress-above", "Deflate response bodies of at least this size.", "bytes", "1024");
+    QCommandLineOption latencyOption("latency", "Delay every response by this many milliseconds.", "ms", "0");
+    QCommandLineOption jitterOption("jitter", "Add up to this many milliseconds of random delay.", "ms", "0");
+    QCommandLineOption errorRateOption("error-rate", "Share of requests failed with 503 (0.0 - 1.0).", "rate", "0");
+    QCommandLineOption rateLimitOption("rate-limit-scale", "Multiplier for the documented rate limits; 0 disables them.", "scale", "1");
+    QCommandLineOption webhookUrlOption("webhook-url", "Deliver webhook events to this URL.", "url");
+    QCommandLineOption pushPortOption("push-port", "Serve the WebSocket push channel on this port.", "port");
+    QCommandLineOption webhookSecretOption("webhook-secret", "Secret used to sign webhook events.", "secret", "mock-webhook-secret");
+    parser.addOption(portOption);
+    parser.addOption(noBatchOption);
+    parser.addOption(completeOption);
+    parser.addOption(compressOption);
+    parser.addOption(latencyOption);
+    parser.addOption(jitterOption);
+    parser.addOption(errorRateOption);
+    parser.addOption(rateLimitOption);
+    parser.addOption(webhookUrlOption);
+    parser.addOption(webhookSecretOption);
+    parser.addOption(pushPortOption);
+    parser.process(app);
+    
+    MockApiServer server;
+    server.setBatchLookupEnabled(!parser.isSet(noBatchOption));
+    server.setCompressionThreshold(parser.value(compressOption).toInt());
+    server.setLifecycle(5, parser.value(completeOption).toInt());
+    server.setLatency(parser.value(latencyOption).toInt(), parser.value(jitterOption).toInt());
+    server.setErrorRate(parser.value(errorRateOption).toDouble());
+    server.setRateLimitScale(parser.value(rateLimitOption).toDouble());
+    server.setWebhook(parser.value(webhookUrlOption), parser.value(webhookSecretOption));
+    
+    quint16 port = parser.value(portOption).toUShort();
+    if (!server.listen(port)) {
+        qCritical() << "Failed to listen on port" << port;
+        return 1;
+    }
+    
+    qInfo() << "Mock API listening on http://127.0.0.1:" << port;
+    
+    if (parser.isSet(pushPortOption)) {
+        quint16 pushPort = parser.value(pushPortOption).toUShort();
+        if (!server.listenForPush(pushPort)) {
+            qCritical() << "Failed to listen for push clients on port" << pushPort;
+            return 1;
+        }
+        qInfo() << "Push channel listening on ws://127.0.0.1:" << pushPort;
+    }
+    return app.exec();
+}
+
+// The SDK header is compiled here, so its meta-object code is too
+#include "moc_asian_crypto_payment.cpp"
@@ -15,34 +15,450 @@ AsianCryptoPayment::AsianCryptoPayment(const QString& apiKey, const QString& mer
     , m_apiKey(apiKey)
     , m_merchantId(merchantId)
     , m_countryCode(countryCode)
-    , m_networkManager(new QNetworkAccessManager(this))
+    , m_networkManager(sharedNetworkManager())
     , m_countryModule(createCountryModule(countryCode))
     , m_securityModule(std::make_unique<SecurityModule>(apiKey))
+    , m_rateLimits(sharedRateLimits(apiKey))
 {
     // Default supported cryptocurrencies
     m_supportedCryptocurrencies << "BTC" << "ETH" << "USDT" << "USDC" << "BNB";
     
-    // Connect network manager
-    connect(m_networkManager, &QNetworkAccessManager::finished, this, &AsianCryptoPayment::onNetworkReply);
+    rebuildRequestTemplate();
+    
+    // Retry budgets; batch polls are not retried because the next poll follows anyway
+    m_retryPolicies[RequestType::CreatePayment] = RetryPolicy(4, 500, 8000);
+    m_retryPolicies[RequestType::CancelPayment] = RetryPolicy(3, 500, 8000);
+    m_retryPolicies[RequestType::GetPayment] = RetryPolicy(3, 500, 4000);
+    m_retryPolicies[RequestType::GetPayments] = RetryPolicy(3, 1000, 8000);
+    m_retryPolicies[RequestType::GetExchangeRates] = RetryPolicy(2, 500, 2000);
+    m_retryPolicies[RequestType::PollPayments] = RetryPolicy(1);
+    
+    // Lower lanes leave connections free for checkout traffic
+    m_laneLimits[RequestPriority::Interactive] = 0;
+    m_laneLimits[RequestPriority::Normal] = 3;
+    m_laneLimits[RequestPriority::Background] = 2;
+    
+    m_schedulerTimer = new QTimer(this);
+    m_schedulerTimer->setSingleShot(true);
+    connect(m_schedulerTimer, &QTimer::timeout, this, &AsianCryptoPayment::drainRequestQueues);
+    
+    m_pollBatchTimer = new QTimer(this);
+    m_pollBatchTimer->setSingleShot(true);
+    connect(m_pollBatchTimer, &QTimer::timeout, this, &AsianCryptoPayment::pollDuePayments);
+    
+    m_statusCheckClock.start();
+    m_statusCheckTimer = new QTimer(this);
+    m_statusCheckTimer->setTimerType(Qt::CoarseTimer);
+    connect(m_statusCheckTimer, &QTimer::timeout, this, &AsianCryptoPayment::checkPaymentStatus);
+    
+    // Connections are opened once the event loop runs, so an endpoint set
+    // right after construction is the one that gets warmed
+    m_prewarmTimer = new QTimer(this);
+    m_prewarmTimer->setSingleShot(true);
+    connect(m_prewarmTimer, &QTimer::timeout, this, &AsianCryptoPayment::prewarmConnections);
+    m_prewarmTimer->start(0);
+    
+    m_keepAliveTimer = new QTimer(this);
+    connect(m_keepAliveTimer, &QTimer::timeout, this, &AsianCryptoPayment::sendKeepAlive);
+    m_keepAliveTimer->start(m_keepAliveIntervalMs);
+    m_lastApiRequestAt = QDateTime::currentMSecsSinceEpoch();
+    
+    m_outboundTimer = new QTimer(this);
+    connect(m_outboundTimer, &QTimer::timeout, this, &AsianCryptoPayment::drainOutboundQueue);
+    
+    m_pushReconnectTimer = new QTimer(this);
+    m_pushReconnectTimer->setSingleShot(true);
+    connect(m_pushReconnectTimer, &QTimer::timeout, this, &AsianCryptoPayment::connectPushChannel);
+    
+    m_pushPingTimer = new QTimer(this);
+    connect(m_pushPingTimer, &QTimer::timeout, this, &AsianCryptoPayment::checkPushHealth);
+    
+    m_regionProbeTimer = new QTimer(this);
+    connect(m_regionProbeTimer, &QTimer::timeout, this, &AsianCryptoPayment::probeRegions);
+    m_regions.append(ApiRegion{m_apiEndpoint});
     
     qDebug() << "SDK initialized for country:" << m_countryModule->countryName();
 }
 
 AsianCryptoPayment::~AsianCryptoPayment() {
-    // Stop all payment timers
-    for (auto timer : m_paymentTimers.values()) {
-        timer->stop();
-        timer->deleteLater();
+    // Closing the push channel must not call back into a half-destroyed object
+    if (m_pushSocket) {
+        m_pushSocket->disconnect(this);
+    }
+    if (m_pushStreamReply) {
+        m_pushStreamReply->disconnect(this);
+        m_pushStreamReply->abort();
+        m_pushStreamReply->deleteLater();
+    }
+    
+    // The shared network manager outlives this instance; drop its replies
+    QSet<QNetworkReply*> replies;
+    for (const QList<QNetworkReply*>& requestReplies : m_inflightReplies) {
+        for (QNetworkReply* reply : requestReplies) {
+            replies.insert(reply);
+        }
+    }
+    for (auto it = m_regionProbes.constBegin(); it != m_regionProbes.constEnd(); ++it) {
+        replies.insert(it.key());
     }
-    m_paymentTimers.clear();
+    
+    for (QNetworkReply* reply : replies) {
+        reply->disconnect(this);
+        reply->abort();
+        reply->deleteLater();
+    }
+}
+
+QNetworkAccessManager* AsianCryptoPayment::sharedNetworkManager() {
+    // Lives as long as the application, so a new instance reuses the open
+    // connections, TLS sessions and host lookups of the ones before it.
+    // Instances must therefore live in the application's thread.
+    static QPointer<QNetworkAccessManager> manager;
+    
+    if (!manager) {
+        manager = new QNetworkAccessManager(QCoreApplication::instance());
+    }
+    
+    return manager;
+}
+
+QMap<AsianCryptoPayment::EndpointClass, TokenBucket>& AsianCryptoPayment::sharedRateLimits(const QString& apiKey) {
+    // The server counts requests per API key, whichever instance sends them
+    static QMap<QString, QMap<EndpointClass, TokenBucket>> rateLimits;
+    
+    QMap<EndpointClass, TokenBucket>& limits = rateLimits[apiKey];
+    
+    // Documented per-minute limits, corrected later from X-RateLimit-* headers
+    if (limits.isEmpty()) {
+        limits[EndpointClass::PaymentsPost] = TokenBucket(60, 5);
+        limits[EndpointClass::PaymentsGet] = TokenBucket(120);
+        limits[EndpointClass::ExchangeRates] = TokenBucket(300);
+        limits[EndpointClass::Other] = TokenBucket(60);
+    }
+    
+    return limits;
 }
 
 void AsianCryptoPayment::setTestMode(bool testMode) {
+    if (testMode == m_testMode) {
+        return;
+    }
+    
+    if (m_syncId != 0) {
+        qWarning() << "Payment sync running; test mode stays" << (m_testMode ? "on" : "off");
+        return;
+    }
+    
     m_testMode = testMode;
+    m_responseCache.clear();
+    rebuildRequestTemplate();
+    
+    // Each mode keeps its own sync mark, read again on next use
+    m_syncMarkLoaded = false;
+    m_syncUpdatedAt = QDateTime();
+    m_syncAfterId.clear();
 }
 
 void AsianCryptoPayment::setApiEndpoint(const QString& apiEndpoint) {
-    m_apiEndpoint = apiEndpoint;
+    setApiEndpoints(QStringList() << apiEndpoint);
+}
+
+void AsianCryptoPayment::setApiEndpoints(const QStringList& apiEndpoints, int probeIntervalMs) {
+    if (apiEndpoints.isEmpty()) {
+        return;
+    }
+    
+    m_regions.clear();
+    m_regionProbes.clear();
+    for (const QString& endpoint : apiEndpoints) {
+        m_regions.append(ApiRegion{endpoint});
+    }
+    
+    m_regionProbeIntervalMs = qMax(1000, probeIntervalMs);
+    m_activeRegion = 0;
+    m_apiEndpoint = m_regions.first().endpoint;
+    m_responseCache.clear();
+    rebuildRequestTemplate();
+    m_prewarmTimer->start(0);
+    
+    // A single endpoint has nothing to choose from
+    if (m_regions.size() > 1) {
+        m_regionProbeTimer->start(m_regionProbeIntervalMs);
+        QTimer::singleShot(0, this, &AsianCryptoPayment::probeRegions);
+    } else {
+        m_regionProbeTimer->stop();
+    }
+}
+
+void AsianCryptoPayment::setConnectionPoolPolicy(int warmConnections, int keepAliveIntervalMs, int keepAliveIdleMs) {
+    m_warmConnections = qMax(0, warmConnections);
+    m_keepAliveIntervalMs = qMax(0, keepAliveIntervalMs);
+    m_keepAliveIdleMs = qMax(0, keepAliveIdleMs);
+    m_lastApiRequestAt = QDateTime::currentMSecsSinceEpoch();
+    
+    if (m_keepAliveIntervalMs > 0) {
+        m_keepAliveTimer->start(m_keepAliveIntervalMs);
+    } else {
+        m_keepAliveTimer->stop();
+    }
+    
+    m_prewarmTimer->start(0);
+}
+
+void AsianCryptoPayment::setRequestCompressionThreshold(int bytes) {
+    m_requestCompressionThreshold = qMax(0, bytes);
+}
+
+void AsianCryptoPayment::setOutboundQueuePath(const QString& filePath) {
+    if (filePath.isEmpty() && !m_outboundOperations.isEmpty()) {
+        qWarning() << "Outbound queue still holds" << m_outboundOperations.size() << "operations; keeping"
+                   << m_outboundQueuePath;
+        return;
+    }
+    
+    m_outboundQueuePath = filePath;
+    
+    // Pending operations move to the new file; otherwise pick up its contents
+    if (m_outboundOperations.isEmpty()) {
+        loadOutboundQueue();
+    } else {
+        saveOutboundQueue();
+    }
+}
+
+qint64 AsianCryptoPayment::outboundQueueOldestAge() const {
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    qint64 oldest = now;
+    
+    for (const OutboundOperation& operation : m_outboundOperations) {
+        oldest = qMin(oldest, operation.queuedAt);
+    }
+    
+    return now - oldest;
+}
+
+void AsianCryptoPayment::setHttp2Enabled(bool enabled) {
+    m_http2Enabled = enabled;
+    m_http2FellBack = false;
+    rebuildRequestTemplate();
+    m_prewarmTimer->start(0);
+}
+
+void AsianCryptoPayment::prewarmConnections() {
+    QUrl url(m_apiEndpoint);
+    if (!url.isValid() || url.host().isEmpty()) {
+        return;
+    }
+    
+    // A single multiplexed connection carries all traffic; a HEAD request
+    // opens it with HTTP/2 offered during the TLS handshake
+    if (http2Active()) {
+        if (m_warmConnections > 0) {
+            QNetworkRequest request(m_requestTemplate);
+            request.setUrl(url);
+            
+            QNetworkReply* reply = m_networkManager->head(request);
+            connect(reply, &QNetworkReply::finished, reply, &QObject::deleteLater);
+        }
+        m_lastNetworkActivity = QDateTime::currentMSecsSinceEpoch();
+        return;
+    }
+    
+    // Each call opens another channel to the host, up to Qt's per-host limit;
+    // DNS, TCP and TLS are then done before the first request needs them
+    for (int i = 0; i < m_warmConnections; ++i) {
+        if (url.scheme() == "https") {
+            m_networkManager->connectToHostEncrypted(url.host(), quint16(url.port(443)));
+        } else {
+            m_networkManager->connectToHost(url.host(), quint16(url.port(80)));
+        }
+    }
+    
+    m_lastNetworkActivity = QDateTime::currentMSecsSinceEpoch();
+}
+
+void AsianCryptoPayment::sendKeepAlive() {
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    
+    // Connections in use need no ping
+    if (now - m_lastNetworkActivity < m_keepAliveIntervalMs) {
+        return;
+    }
+    
+    // A kiosk nobody uses lets its connections go; dispatchRequest() starts
+    // the timer again with the next request
+    if (m_keepAliveIdleMs > 0 && now - m_lastApiRequestAt >= m_keepAliveIdleMs) {
+        m_keepAliveTimer->stop();
+        return;
+    }
+    
+    // Parallel HEAD requests spread over the warm connections so the server
+    // does not close them as idle; the replies are dropped unread. They
+    // carry the usual API headers and spend the budget of other requests
+    PreparedRequest prepared;
+    prepared.method = "HEAD";
+    QNetworkRequest request = createApiRequest(prepared, RequestPriority::Background);
+    
+    int connections = http2Active() ? qMin(1, m_warmConnections) : m_warmConnections;
+    for (int i = 0; i < connections; ++i) {
+        if (!m_rateLimits[EndpointClass::Other].tryAcquire(false, now)) {
+            break;
+        }
+        
+        QNetworkReply* reply = m_networkManager->head(request);
+        connect(reply, &QNetworkReply::finished, reply, &QObject::deleteLater);
+        m_statistics.keepAlivePings++;
+    }
+    
+    m_lastNetworkActivity = now;
+}
+
+void AsianCryptoPayment::probeRegions() {
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    
+    // HEAD on the base URL; after the first probe the connection is reused,
+    // so the time measured is the network round trip
+    for (const ApiRegion& region : m_regions) {
+        QNetworkRequest request(m_requestTemplate);
+        request.setUrl(QUrl(region.endpoint));
+        
+        QNetworkReply* reply = m_networkManager->head(request);
+        reply->setProperty("probe_sent_at", now);
+        m_regionProbes.insert(reply, region.endpoint);
+        m_statistics.regionProbes++;
+        
+        connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+            handleRegionProbe(reply);
+        });
+        
+        // A probe that does not answer within the interval counts as failed
+        QTimer::singleShot(m_regionProbeIntervalMs, reply, &QNetworkReply::abort);
+    }
+}
+
+void AsianCryptoPayment::handleRegionProbe(QNetworkReply* reply) {
+    QString endpoint = m_regionProbes.take(reply);
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    qint64 roundTrip = now - reply->property("probe_sent_at").toLongLong();
+    
+    const int probesToRecover = 3;
+    
+    // Any HTTP answer below 500 means the region is up, whatever HEAD returns
+    int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    bool reachable = statusCode > 0 && statusCode < 500;
+    
+    for (ApiRegion& region : m_regions) {
+        if (region.endpoint != endpoint) {
+            continue;
+        }
+        
+        if (!reachable) {
+            region.cleanProbes = 0;
+            region.unhealthySince = region.unhealthySince > 0 ? region.unhealthySince : now;
+            region.unhealthyUntil = now + m_regionProbeIntervalMs;
+            continue;
+        }
+        
+        region.rttMs = region.rttMs < 0 ? roundTrip : 0.7 * region.rttMs + 0.3 * roundTrip;
+        
+        // A HEAD answer only shows the host is up, not that requests work:
+        // an unhealthy region needs a run of good probes or a real success
+        if (region.unhealthySince > 0 && ++region.cleanProbes < probesToRecover) {
+            region.unhealthyUntil = now + m_regionProbeIntervalMs;
+            continue;
+        }
+        
+        region.failures = 0;
+        region.cleanProbes = 0;
+        region.unhealthySince = 0;
+        region.unhealthyUntil = 0;
+    }
+    
+    reply->deleteLater();
+    updateActiveRegion();
+}
+
+void AsianCryptoPayment::recordRegionOutcome(const QString& endpoint, bool failed, qint64 sentAt, qint64 now) {
+    const int maxFailures = 2;
+    
+    if (m_regions.size() < 2) {
+        return;
+    }
+    
+    // The endpoint list may have been replaced while the request was out
+    for (ApiRegion& entry : m_regions) {
+        if (entry.endpoint != endpoint) {
+            continue;
+        }
+        
+        if (!failed) {
+            entry.failures = 0;
+            
+            // Only a request sent after the region was marked down shows it recovered
+            if (entry.unhealthySince > 0 && sentAt >= entry.unhealthySince) {
+                entry.cleanProbes = 0;
+                entry.unhealthySince = 0;
+                entry.unhealthyUntil = 0;
+                updateActiveRegion();
+            }
+            return;
+        }
+        
+        // Skip the region until probes or a request show it has recovered
+        if (++entry.failures >= maxFailures) {
+            entry.cleanProbes = 0;
+            entry.unhealthySince = entry.unhealthySince > 0 ? entry.unhealthySince : now;
+            entry.unhealthyUntil = now + m_regionProbeIntervalMs;
+            updateActiveRegion();
+        }
+        return;
+    }
+}
+
+void AsianCryptoPayment::updateActiveRegion() {
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    
+    // Fastest healthy region; unmeasured ones only when nothing was measured
+    int best = -1;
+    for (int i = 0; i < m_regions.size(); ++i) {
+        const ApiRegion& region = m_regions.at(i);
+        if (region.unhealthyUntil > now) {
+            continue;
+        }
+        if (best < 0 || (region.rttMs >= 0 && (m_regions.at(best).rttMs < 0 || region.rttMs < m_regions.at(best).rttMs))) {
+            best = i;
+        }
+    }
+    
+    if (best < 0 || best == m_activeRegion) {
+        return;
+    }
+    
+    // A healthy region is only left for a clearly faster one, so regions
+    // with similar round trips do not take turns
+    const ApiRegion& active = m_regions.at(m_activeRegion);
+    bool activeHealthy = active.unhealthyUntil <= now;
+    if (activeHealthy && active.rttMs >= 0 && m_regions.at(best).rttMs > 0.8 * active.rttMs) {
+        return;
+    }
+    
+    if (!activeHealthy) {
+        m_statistics.regionFailovers++;
+    }
+    
+    qWarning() << "Switching API endpoint from" << m_apiEndpoint << "to" << m_regions.at(best).endpoint;
+    
+    m_activeRegion = best;
+    m_apiEndpoint = m_regions.at(best).endpoint;
+    rebuildRequestTemplate();
+    m_prewarmTimer->start(0);
+    
+    // Failures seen on the previous region say nothing about this one
+    for (auto it = m_circuitBreakers.begin(); it != m_circuitBreakers.end(); ++it) {
+        it->reset();
+    }
+    
+    emit apiEndpointChanged(m_apiEndpoint);
 }
 
 void AsianCryptoPayment::setSupportedCryptocurrencies(const QStringList& supportedCryptocurrencies) {
@@ -54,7 +470,42 @@ void AsianCryptoPayment::setWebhookConfig(const QString& webhookEndpoint, const
     m_webhookConfig["secret"] = webhookSecret;
 }
 
-void AsianCryptoPayment::createPayment(const PaymentDetails& paymentDetails) {
+void AsianCryptoPayment::setCreatePaymentHeadroom(int reservedRequests) {
+    m_rateLimits[EndpointClass::PaymentsPost].setReserve(reservedRequests);
+}
+
+void AsianCryptoPayment::setRetryPolicy(RequestType type, const RetryPolicy& policy) {
+    m_retryPolicies[type] = policy;
+}
+
+void AsianCryptoPayment::setPollingPolicy(const PollingPolicy& policy) {
+    m_pollingPolicy = policy;
+}
+
+void AsianCryptoPayment::setPushEndpoint(const QString& pushEndpoint) {
+    m_pushEndpoint = pushEndpoint;
+    m_pushReconnectAttempts = 0;
+    m_pushReconnectTimer->stop();
+    
+    // An open channel reconnects to the new endpoint once it has closed
+    if (pushChannelOpen()) {
+        closePushChannel();
+    } else {
+        connectPushChannel();
+    }
+}
+
+void AsianCryptoPayment::setCircuitBreakerPolicy(double failureThreshold, int openMs) {
+    for (EndpointClass endpointClass : m_rateLimits.keys()) {
+        m_circuitBreakers[endpointClass] = CircuitBreaker(failureThreshold, 10, openMs);
+    }
+}
+
+void AsianCryptoPayment::setHedgingEnabled(bool enabled) {
+    m_hedgingEnabled = enabled;
+}
+
+RequestHandle AsianCryptoPayment::createPayment(const PaymentDetails& paymentDetails, const RequestOptions& options) {
     try {
         // Validate payment details
         validatePaymentDetails(paymentDetails);
@@ -69,23 +520,63 @@ void AsianCryptoPayment::createPayment(const PaymentDetails& paymentDetails) {
         paymentData["test_mode"] = m_testMode;
         
         // Make API request
-        makeApiRequest("payments", "POST", paymentData);
+        return RequestHandle(this, makeApiRequest(RequestType::CreatePayment, "payments", QString(), paymentData,
+                                                  options));
     } catch (const std::exception& e) {
         emit error(400, QString::fromStdString(e.what()));
     }
+    
+    return RequestHandle();
+}
+
+RequestHandle AsianCryptoPayment::getPayment(const QString& paymentId, const RequestOptions& options) {
+    return fetchPayment(paymentId, false, options);
 }
 
-void AsianCryptoPayment::getPayment(const QString& paymentId) {
+RequestHandle AsianCryptoPayment::fetchPayment(const QString& paymentId, bool statusCheck, const RequestOptions& options) {
     if (paymentId.isEmpty()) {
         emit error(400, "Payment ID is required");
-        return;
+        return RequestHandle();
+    }
+    
+    // Later callers attach to the outstanding request; its reply is decoded
+    // once and delivered to every listener through paymentRetrieved. Each
+    // gets a handle of its own, with its own deadline
+    if (m_inflightPaymentFetches.contains(paymentId)) {
+        quint64 requestId = m_inflightPaymentFetches[paymentId];
+        quint64 handleId = m_nextRequestId++;
+        
+        QSet<quint64>& handles = m_requestAttachments[requestId];
+        if (handles.isEmpty()) {
+            handles.insert(requestId);
+        }
+        handles.insert(handleId);
+        m_attachedHandles[handleId] = requestId;
+        m_statistics.coalescedRequests++;
+        
+        armDeadline(handleId, options.deadline());
+        return RequestHandle(this, handleId);
     }
     
     QString endpoint = "payments/" + paymentId;
-    makeApiRequest(endpoint, "GET");
+    RequestContext context = newRequestContext(RequestType::GetPayment, endpoint, paymentId, QJsonObject(), options);
+    context.statusCheck = statusCheck;
+    quint64 requestId = submitRequest(context);
+    
+    // The request may already have failed fast (e.g. open circuit)
+    if (m_liveRequests.contains(requestId)) {
+        m_inflightPaymentFetches[paymentId] = requestId;
+    }
+    
+    return RequestHandle(this, requestId);
+}
+
+RequestHandle AsianCryptoPayment::getPayments(const PaymentFilters& filters, const RequestOptions& options) {
+    return RequestHandle(this, makeApiRequest(RequestType::GetPayments, paymentsEndpoint(filters), QString(),
+                                              QJsonObject(), options));
 }
 
-void AsianCryptoPayment::getPayments(const PaymentFilters& filters) {
+QString AsianCryptoPayment::paymentsEndpoint(const PaymentFilters& filters) {
     QString endpoint = "payments";
     
     // Add query parameters if filters are provided
@@ -94,108 +585,380 @@ void AsianCryptoPayment::getPayments(const PaymentFilters& filters) {
         endpoint += "?" + queryString;
     }
     
-    makeApiRequest(endpoint, "GET");
-}
-
-void AsianCryptoPayment::cancelPayment(const QString& paymentId) {
-    if (paymentId.isEmpty()) {
-        emit error(400, "Payment ID is required");
-        return;
-    }
-    
-    QString endpoint = "payments/" + paymentId + "/cancel";
-    makeApiRequest(endpoint, "POST");
+    return endpoint;
 }
 
-void AsianCryptoPayment::getExchangeRates(const QString& baseCurrency, const QStringList& cryptoCurrencies) {
-    if (baseCurrency.isEmpty()) {
-        emit error(400, "Base currency is required");
-        return;
-    }
+RequestHandle AsianCryptoPayment::streamPaymentHistory(const PaymentFilters& filters, int concurrency,
+                                                       const RequestOptions& options) {
+    quint64 historyId = m_nextRequestId++;
     
-    QStringList currencies = cryptoCurrencies.isEmpty() ? m_supportedCryptocurrencies : cryptoCurrencies;
+    PaymentHistory& history = m_paymentHistories[historyId];
+    history.filters = filters;
+    history.options = options;
+    history.concurrency = qMax(1, concurrency);
+    history.nextOffset = filters.offset();
+    history.deliverOffset = filters.offset();
     
-    QString endpoint = "exchange-rates?base_currency=" + baseCurrency + "&currencies=" + currencies.join(",");
-    makeApiRequest(endpoint, "GET");
+    requestHistoryPages(historyId);
+    return RequestHandle(this, historyId);
 }
 
-bool AsianCryptoPayment::verifyWebhookSignature(const QString& signature, const QString& body) {
-    if (!m_webhookConfig.contains("secret")) {
-        qWarning() << "Webhooks not initialized";
-        return false;
-    }
+void AsianCryptoPayment::requestHistoryPages(quint64 historyId) {
+    auto it = m_paymentHistories.find(historyId);
     
-    QString secret = m_webhookConfig["secret"].toString();
-    return m_securityModule->verifySignature(signature, body, secret);
+    // Pages are only fetched within reach of the one being delivered, so a
+    // slow page holds back the rest instead of piling them up in memory
+    while (it != m_paymentHistories.end() && it->pageRequests.size() < it->concurrency &&
+            it->nextOffset < it->endOffset &&
+            it->nextOffset < it->deliverOffset + qint64(it->concurrency) * qMax(1, it->filters.limit())) {
+        int offset = it->nextOffset;
+        it->nextOffset += qMax(1, it->filters.limit());
+        
+        PaymentFilters filters = it->filters;
+        filters.setOffset(offset);
+        
+        RequestContext context = newRequestContext(RequestType::GetPayments, paymentsEndpoint(filters), QString(),
+                                                   QJsonObject(), it->options);
+        context.historyId = historyId;
+        context.offset = offset;
+        quint64 requestId = submitRequest(context);
+        
+        // A request that fails straight away ends the walk
+        it = m_paymentHistories.find(historyId);
+        if (it != m_paymentHistories.end() && m_liveRequests.contains(requestId)) {
+            it->pageRequests[offset] = requestId;
+        }
+    }
 }
 
-bool AsianCryptoPayment::processWebhookEvent(const QJsonObject& event, const QString& signature) {
-    if (m_webhookConfig.isEmpty()) {
-        qWarning() << "Webhooks not initialized";
-        return false;
+void AsianCryptoPayment::handleHistoryPage(const RequestContext& context, const QList<Payment>& payments,
+                                           const QJsonObject& response) {
+    quint64 historyId = context.historyId;
+    int offset = context.offset;
+    
+    auto it = m_paymentHistories.find(historyId);
+    if (it == m_paymentHistories.end()) {
+        return;
     }
     
-    // Verify signature
-    QJsonDocument doc(event);
-    QString eventString = doc.toJson(QJsonDocument::Compact);
-    bool isValid = verifyWebhookSignature(signature, eventString);
+    it->pageRequests.remove(offset);
+    it->readyPages[offset] = payments;
     
-    if (!isValid) {
-        qWarning() << "Invalid webhook signature";
-        return false;
-    }
+    bool hasMore = response.contains("has_more") ? response["has_more"].toBool()
+                                                 : offset + payments.size() < response["total"].toInt();
     
-    // Process event
-    try {
-        QString eventType = event["type"].toString();
+    // Once a page marks the end, pages requested beyond it are dropped
+    if (!hasMore || payments.isEmpty()) {
+        it->endOffset = qMin(it->endOffset, offset + qMax(1, it->filters.limit()));
         
-        if (event.contains("data") && event["data"].isObject()) {
-            Payment payment = Payment::fromJson(event["data"].toObject());
-            
-            if (eventType == "payment.created") {
-                emit paymentCreated(payment);
-            } else if (eventType == "payment.updated") {
-                emit paymentStatusUpdated(payment);
-            } else if (eventType == "payment.completed") {
-                emit paymentStatusUpdated(payment);
-                stopPaymentStatusCheck(payment.id());
-            } else if (eventType == "payment.cancelled") {
-                emit paymentStatusUpdated(payment);
-                stopPaymentStatusCheck(payment.id());
-            } else if (eventType == "payment.expired") {
-                emit paymentStatusUpdated(payment);
-                stopPaymentStatusCheck(payment.id());
+        for (auto page = it->pageRequests.begin(); page != it->pageRequests.end();) {
+            if (page.key() >= it->endOffset) {
+                quint64 requestId = page.value();
+                page = it->pageRequests.erase(page);
+                abandonRequest(requestId);
+            } else {
+                ++page;
             }
         }
-        
-        return true;
-    } catch (const std::exception& e) {
-        qWarning() << "Failed to process webhook event:" << e.what();
-        return false;
     }
+    
+    deliverHistoryPages(historyId);
 }
 
-void AsianCryptoPayment::downloadQrCode(const QString& url) {
-    if (url.isEmpty()) {
-        emit error(400, "QR code URL is required");
-        return;
+void AsianCryptoPayment::deliverHistoryPages(quint64 historyId) {
+    auto it = m_paymentHistories.find(historyId);
+    
+    while (it != m_paymentHistories.end() && it->readyPages.contains(it->deliverOffset)) {
+        QList<Payment> payments = it->readyPages.take(it->deliverOffset);
+        it->deliverOffset += qMax(1, it->filters.limit());
+        it->delivered += payments.size();
+        
+        if (!payments.isEmpty()) {
+            emit paymentHistoryPage(historyId, payments);
+        }
+        
+        // A slot may have cancelled the walk
+        it = m_paymentHistories.find(historyId);
     }
     
-    QNetworkRequest request(url);
-    QNetworkReply* reply = m_networkManager->get(request);
+    if (it == m_paymentHistories.end()) {
+        return;
+    }
     
-    RequestContext context;
-    context.type = RequestType::DownloadQrCode;
-    m_pendingRequests[reply] = context;
+    if (it->deliverOffset >= it->endOffset) {
+        int count = it->delivered;
+        m_paymentHistories.erase(it);
+        emit paymentHistoryFinished(historyId, count);
+        return;
+    }
     
-    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
-        onQrCodeDownloaded(reply);
-    });
+    requestHistoryPages(historyId);
 }
 
-void AsianCryptoPayment::validatePaymentDetails(const PaymentDetails& paymentDetails) {
-    if (paymentDetails.amount() <= 0.0) {
-        throw std::invalid_argument("Payment amount must be greater than zero");
+RequestHandle AsianCryptoPayment::syncPayments(int pageSize) {
+    if (m_syncId != 0) {
+        return RequestHandle(this, m_syncId);
+    }
+    
+    loadSyncMark();
+    m_syncId = m_nextRequestId++;
+    m_syncPageSize = qMax(1, pageSize);
+    m_syncCount = 0;
+    
+    quint64 syncId = m_syncId;
+    requestSyncPage();
+    return RequestHandle(this, syncId);
+}
+
+void AsianCryptoPayment::resetPaymentSync(const QDateTime& updatedSince) {
+    m_syncMarkLoaded = true;
+    m_syncUpdatedAt = updatedSince;
+    m_syncAfterId.clear();
+    saveSyncMark();
+}
+
+QDateTime AsianCryptoPayment::paymentSyncMark() {
+    loadSyncMark();
+    return m_syncUpdatedAt;
+}
+
+void AsianCryptoPayment::requestSyncPage() {
+    // Without a mark the first sync starts at the beginning of the history
+    PaymentFilters filters;
+    filters.setUpdatedSince(m_syncUpdatedAt.isValid() ? m_syncUpdatedAt : QDateTime::fromMSecsSinceEpoch(0, Qt::UTC),
+                            m_syncAfterId);
+    filters.setLimit(m_syncPageSize);
+    
+    RequestContext context = newRequestContext(RequestType::GetPayments, paymentsEndpoint(filters), QString(),
+                                               QJsonObject(), RequestOptions());
+    context.syncId = m_syncId;
+    m_syncPageRequest = submitRequest(context);
+}
+
+void AsianCryptoPayment::handleSyncPage(const RequestContext& context, const QList<Payment>& payments,
+                                        const QJsonObject& response) {
+    if (context.syncId != m_syncId) {
+        return;
+    }
+    
+    // Results are ordered by (updated_at, id), so the last one is the new mark
+    if (!payments.isEmpty()) {
+        m_syncUpdatedAt = payments.last().updatedAt();
+        m_syncAfterId = payments.last().id();
+        m_syncCount += payments.size();
+        saveSyncMark();
+        
+        emit paymentsSynced(payments);
+        
+        // A slot may have cancelled the sync
+        if (context.syncId != m_syncId) {
+            return;
+        }
+    }
+    
+    if (response["has_more"].toBool() && !payments.isEmpty()) {
+        requestSyncPage();
+        return;
+    }
+    
+    int count = m_syncCount;
+    m_syncId = 0;
+    m_syncPageRequest = 0;
+    emit paymentSyncFinished(count);
+}
+
+QString AsianCryptoPayment::syncSettingsGroup() const {
+    return QString("AsianCryptoPay/sync/%1/%2").arg(m_merchantId, m_testMode ? "test" : "live");
+}
+
+void AsianCryptoPayment::loadSyncMark() {
+    if (m_syncMarkLoaded) {
+        return;
+    }
+    
+    QSettings settings;
+    settings.beginGroup(syncSettingsGroup());
+    m_syncUpdatedAt = QDateTime::fromString(settings.value("updated_at").toString(), Qt::ISODateWithMs);
+    m_syncAfterId = settings.value("after_id").toString();
+    settings.endGroup();
+    
+    m_syncMarkLoaded = true;
+}
+
+void AsianCryptoPayment::saveSyncMark() {
+    QSettings settings;
+    settings.beginGroup(syncSettingsGroup());
+    settings.setValue("updated_at", m_syncUpdatedAt.isValid() ? m_syncUpdatedAt.toUTC().toString(Qt::ISODateWithMs) : QString());
+    settings.setValue("after_id", m_syncAfterId);
+    settings.endGroup();
+}
+
+void AsianCryptoPayment::abortPaymentHistory(quint64 historyId) {
+    if (!m_paymentHistories.contains(historyId)) {
+        return;
+    }
+    
+    PaymentHistory history = m_paymentHistories.take(historyId);
+    for (quint64 requestId : history.pageRequests.values()) {
+        abandonRequest(requestId);
+    }
+}
+
+RequestHandle AsianCryptoPayment::cancelPayment(const QString& paymentId, const RequestOptions& options) {
+    if (paymentId.isEmpty()) {
+        emit error(400, "Payment ID is required");
+        return RequestHandle();
+    }
+    
+    QString endpoint = "payments/" + paymentId + "/cancel";
+    return RequestHandle(this, makeApiRequest(RequestType::CancelPayment, endpoint, paymentId, QJsonObject(), options));
+}
+
+RequestHandle AsianCryptoPayment::getExchangeRates(const QString& baseCurrency, const QStringList& cryptoCurrencies,
+                                                   const RequestOptions& options) {
+    if (baseCurrency.isEmpty()) {
+        emit error(400, "Base currency is required");
+        return RequestHandle();
+    }
+    
+    QStringList currencies = cryptoCurrencies.isEmpty() ? m_supportedCryptocurrencies : cryptoCurrencies;
+    
+    QString endpoint = "exchange-rates?base_currency=" + baseCurrency + "&currencies=" + currencies.join(",");
+    return RequestHandle(this, makeApiRequest(RequestType::GetExchangeRates, endpoint, QString(), QJsonObject(),
+                                              options));
+}
+
+bool AsianCryptoPayment::cancelRequest(quint64 requestId) {
+    if (m_paymentHistories.contains(requestId)) {
+        abortPaymentHistory(requestId);
+        m_statistics.requestsCancelled++;
+        return true;
+    }
+    
+    if (m_syncId != 0 && requestId == m_syncId) {
+        m_syncId = 0;
+        abandonRequest(m_syncPageRequest);
+        m_statistics.requestsCancelled++;
+        return true;
+    }
+    
+    quint64 abandoned = 0;
+    if (!releaseHandle(requestId, abandoned)) {
+        return false;
+    }
+    
+    if (abandoned != 0) {
+        abandonRequest(abandoned);
+        m_statistics.requestsCancelled++;
+    }
+    return true;
+}
+
+bool AsianCryptoPayment::verifyWebhookSignature(const QString& signature, const QString& body) {
+    if (!m_webhookConfig.contains("secret")) {
+        qWarning() << "Webhooks not initialized";
+        return false;
+    }
+    
+    QString secret = m_webhookConfig["secret"].toString();
+    return m_securityModule->verifySignature(signature, body, secret);
+}
+
+bool AsianCryptoPayment::processWebhookEvent(const QJsonObject& event, const QString& signature) {
+    if (m_webhookConfig.isEmpty()) {
+        qWarning() << "Webhooks not initialized";
+        return false;
+    }
+    
+    // Verify signature
+    QJsonDocument doc(event);
+    QString eventString = doc.toJson(QJsonDocument::Compact);
+    bool isValid = verifyWebhookSignature(signature, eventString);
+    
+    if (!isValid) {
+        qWarning() << "Invalid webhook signature";
+        return false;
+    }
+    
+    // Process event
+    try {
+        dispatchPaymentEvent(event, true);
+        return true;
+    } catch (const std::exception& e) {
+        qWarning() << "Failed to process webhook event:" << e.what();
+        return false;
+    }
+}
+
+bool AsianCryptoPayment::dispatchPaymentEvent(const QJsonObject& event, bool verified) {
+    if (!event.contains("data") || !event["data"].isObject()) {
+        return false;
+    }
+    
+    QString eventType = event["type"].toString();
+    Payment payment = Payment::fromJson(event["data"].toObject());
+    
+    // Push events are not signed, so they may only update payments this
+    // kiosk is checking; anything else needs a verified webhook
+    if (!verified && !m_statusCheckStates.contains(payment.id())) {
+        return false;
+    }
+    
+    // Tracked payments take the polling path; for the rest, a change already
+    // reported through another channel is dropped here
+    if (m_activePayments.contains(payment.id())) {
+        applyPolledPayment(payment);
+        return true;
+    }
+    if (!acceptPaymentRevision(payment)) {
+        return true;
+    }
+    
+    if (eventType == "payment.created") {
+        emit paymentCreated(payment);
+    } else if (eventType == "payment.updated") {
+        emit paymentStatusUpdated(payment);
+    } else if (eventType == "payment.completed") {
+        emit paymentStatusUpdated(payment);
+        stopPaymentStatusCheck(payment.id());
+    } else if (eventType == "payment.cancelled") {
+        emit paymentStatusUpdated(payment);
+        stopPaymentStatusCheck(payment.id());
+    } else if (eventType == "payment.expired") {
+        emit paymentStatusUpdated(payment);
+        stopPaymentStatusCheck(payment.id());
+    }
+    
+    return true;
+}
+
+RequestHandle AsianCryptoPayment::downloadQrCode(const QString& url, const RequestOptions& options) {
+    if (url.isEmpty()) {
+        emit error(400, "QR code URL is required");
+        return RequestHandle();
+    }
+    
+    QNetworkRequest request(url);
+    QNetworkReply* reply = m_networkManager->get(request);
+    
+    // Tracked for cancellation and deadlines only; the reply is handled by
+    // onQrCodeDownloaded rather than the API reply path
+    quint64 requestId = m_nextRequestId++;
+    reply->setProperty("request_id", requestId);
+    m_liveRequests.insert(requestId);
+    m_inflightReplies[requestId].append(reply);
+    armDeadline(requestId, options.deadline());
+    
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        onQrCodeDownloaded(reply);
+    });
+    
+    return RequestHandle(this, requestId);
+}
+
+void AsianCryptoPayment::validatePaymentDetails(const PaymentDetails& paymentDetails) {
+    if (paymentDetails.amount() <= 0.0) {
+        throw std::invalid_argument("Payment amount must be greater than zero");
     }
     
     if (paymentDetails.currency().isEmpty()) {
@@ -212,111 +975,1075 @@ void AsianCryptoPayment::validatePaymentDetails(const PaymentDetails& paymentDet
     }
 }
 
-QNetworkRequest AsianCryptoPayment::createApiRequest(const QString& endpoint, const QJsonObject& data) {
-    QString url = m_apiEndpoint + "/" + endpoint;
-    QNetworkRequest request(url);
+void AsianCryptoPayment::rebuildRequestTemplate() {
+    m_apiEndpointPrefix = m_apiEndpoint + "/";
+    
+    // Headers that only change with configuration are encoded once here
+    // and shared by every request copied from the template
+    m_requestTemplate = QNetworkRequest();
+    m_requestTemplate.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    m_requestTemplate.setRawHeader("X-Merchant-ID", m_merchantId.toUtf8());
+    m_requestTemplate.setRawHeader("X-Test-Mode", m_testMode ? "true" : "false");
+    m_requestTemplate.setRawHeader("User-Agent", "AsianCryptoPayment-Qt/1.0.0");
+    
+    // HTTP/2 is negotiated through ALPN; servers without it answer over HTTP/1.1
+    m_requestTemplate.setAttribute(QNetworkRequest::Http2AllowedAttribute, http2Active());
+}
+
+AsianCryptoPayment::PreparedRequest AsianCryptoPayment::prepareApiRequest(const QString& endpoint, const QString& method, const QJsonObject& data) const {
+    PreparedRequest prepared;
+    prepared.endpoint = endpoint;
+    prepared.method = method.toLatin1();
+    
+    // Serialize once; the same bytes are signed and sent
+    if (!data.isEmpty()) {
+        prepared.body = QJsonDocument(data).toJson(QJsonDocument::Compact);
+    }
+    
+    // Large bodies go out deflated; the signature still covers the JSON.
+    // qCompress output is a zlib stream behind a 4-byte length prefix.
+    if (m_requestCompressionThreshold > 0 && prepared.body.size() >= m_requestCompressionThreshold) {
+        QByteArray deflated = qCompress(prepared.body).mid(4);
+        
+        if (deflated.size() < prepared.body.size()) {
+            prepared.encodedBody = deflated;
+        }
+    }
+    
+    // One key per logical request, reused by every retry of it
+    if (prepared.method == "POST") {
+        prepared.idempotencyKey = QUuid::createUuid().toByteArray(QUuid::WithoutBraces);
+    }
+    
+    return prepared;
+}
+
+QNetworkRequest AsianCryptoPayment::createApiRequest(const PreparedRequest& prepared, RequestPriority priority) {
+    QNetworkRequest request(m_requestTemplate);
+    request.setUrl(QUrl(m_apiEndpointPrefix + prepared.endpoint));
+    
+    // Qt also orders its own per-host queue by request priority
+    if (priority != RequestPriority::Normal) {
+        request.setPriority(priority == RequestPriority::Interactive ? QNetworkRequest::HighPriority
+                                                                     : QNetworkRequest::LowPriority);
+    }
+    
+    QByteArray timestamp = QByteArray::number(QDateTime::currentMSecsSinceEpoch());
+    request.setRawHeader("X-Timestamp", timestamp);
+    
+    if (!prepared.body.isEmpty()) {
+        request.setRawHeader("X-Signature", m_securityModule->generateSignature(prepared.body, timestamp));
+    }
+    
+    if (!prepared.idempotencyKey.isEmpty()) {
+        request.setRawHeader("Idempotency-Key", prepared.idempotencyKey);
+    }
+    
+    if (!prepared.encodedBody.isEmpty()) {
+        request.setRawHeader("Content-Encoding", "deflate");
+    }
+    
+    // Revalidate cached responses; an unchanged resource comes back as 304
+    if (prepared.method == "GET") {
+        const CachedResponse* cached = m_responseCache.object(prepared.endpoint);
+        
+        if (cached) {
+            if (!cached->etag.isEmpty()) {
+                request.setRawHeader("If-None-Match", cached->etag);
+            }
+            if (!cached->lastModified.isEmpty()) {
+                request.setRawHeader("If-Modified-Since", cached->lastModified);
+            }
+        }
+    }
+    
+    return request;
+}
+
+QNetworkReply* AsianCryptoPayment::sendPreparedRequest(const PreparedRequest& prepared, RequestPriority priority) {
+    QNetworkRequest request = createApiRequest(prepared, priority);
+    const QByteArray& body = prepared.encodedBody.isEmpty() ? prepared.body : prepared.encodedBody;
+    
+    m_statistics.requestBodyBytes += quint64(prepared.body.size());
+    m_statistics.requestWireBytes += quint64(body.size());
+    
+    if (prepared.method == "GET") {
+        return m_networkManager->get(request);
+    } else if (prepared.method == "POST") {
+        return m_networkManager->post(request, body);
+    } else if (prepared.method == "PUT") {
+        return m_networkManager->put(request, body);
+    } else if (prepared.method == "DELETE") {
+        return m_networkManager->deleteResource(request);
+    }
+    
+    return nullptr;
+}
+
+quint64 AsianCryptoPayment::makeApiRequest(RequestType type, const QString& endpoint, const QString& paymentId,
+                                           const QJsonObject& data, const RequestOptions& options) {
+    RequestContext context = newRequestContext(type, endpoint, paymentId, data, options);
+    return submitRequest(context);
+}
+
+AsianCryptoPayment::RequestContext AsianCryptoPayment::newRequestContext(RequestType type, const QString& endpoint,
+                                                                         const QString& paymentId,
+                                                                         const QJsonObject& data,
+                                                                         const RequestOptions& options) {
+    Route route = routeFor(type);
+    
+    RequestContext context;
+    context.type = type;
+    context.id = paymentId;
+    context.request = prepareApiRequest(endpoint, QString::fromLatin1(route.method), data);
+    context.endpointClass = route.endpointClass;
+    context.deadline = options.deadline();
+    context.priority = options.hasPriority() ? options.priority() : defaultPriority(context.type);
+    return context;
+}
+
+quint64 AsianCryptoPayment::submitRequest(RequestContext& context) {
+    context.requestId = m_nextRequestId++;
+    context.submittedAt = QDateTime::currentMSecsSinceEpoch();
+    
+    m_liveRequests.insert(context.requestId);
+    armDeadline(context.requestId, context.deadline);
+    
+    if (!submitOutboundOperation(context)) {
+        enqueueRequest(context);
+    }
+    
+    return context.requestId;
+}
+
+void AsianCryptoPayment::enqueueRequest(const RequestContext& context, bool retry) {
+    // Cancelled or expired while waiting for a retry
+    if (!m_liveRequests.contains(context.requestId)) {
+        return;
+    }
+    
+    QList<RequestContext>& queue = m_requestQueues[context.endpointClass];
+    bool privileged = context.type == RequestType::CreatePayment;
+    
+    // Send straight away when nothing is waiting and the budget allows it
+    if (queue.isEmpty() && !retry && laneHasCapacity(context.priority) &&
+            m_rateLimits[context.endpointClass].tryAcquire(privileged, QDateTime::currentMSecsSinceEpoch())) {
+        dispatchRequest(context);
+        return;
+    }
+    
+    // Queues are ordered by lane; throttled requests keep their place at
+    // the front of their lane, new ones join its back
+    int index = 0;
+    while (index < queue.size() && (queue.at(index).priority < context.priority ||
+            (!retry && queue.at(index).priority == context.priority))) {
+        ++index;
+    }
+    queue.insert(index, context);
+    
+    if (retry) {
+        scheduleQueueDrain();
+    } else {
+        drainRequestQueues();
+    }
+}
+
+RequestPriority AsianCryptoPayment::defaultPriority(RequestType type) {
+    switch (type) {
+        case RequestType::CreatePayment:
+        case RequestType::CancelPayment:
+            return RequestPriority::Interactive;
+        case RequestType::GetPayments:
+        case RequestType::PollPayments:
+            return RequestPriority::Background;
+        default:
+            return RequestPriority::Normal;
+    }
+}
+
+bool AsianCryptoPayment::laneHasCapacity(RequestPriority priority) const {
+    int limit = m_laneLimits.value(priority);
+    return limit <= 0 || m_laneInFlight.value(priority) < limit;
+}
+
+void AsianCryptoPayment::setLaneConcurrency(RequestPriority priority, int maxInFlight) {
+    m_laneLimits[priority] = qMax(0, maxInFlight);
+    drainRequestQueues();
+}
+
+void AsianCryptoPayment::dispatchRequest(const RequestContext& context) {
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    
+    if (!m_liveRequests.contains(context.requestId)) {
+        return;
+    }
+    
+    // Callers attached to a coalesced request may still wait for it
+    if (context.deadline > 0 && now >= context.deadline) {
+        expireRequest(context.requestId);
+        
+        if (!m_liveRequests.contains(context.requestId)) {
+            return;
+        }
+    }
+    
+    if (!m_circuitBreakers[context.endpointClass].allowRequest(now)) {
+        m_statistics.circuitRejections++;
+        if (parkOutboundOperation(context)) {
+            return;
+        }
+        failRequest(context, CircuitOpenError, "Service temporarily unavailable; request not sent");
+        return;
+    }
+    
+    QNetworkReply* reply = sendPreparedRequest(context.request, context.priority);
+    if (!reply) {
+        return;
+    }
+    
+    // Hedges ride on the original request's lane slot
+    if (!context.hedge) {
+        m_laneInFlight[context.priority]++;
+    }
+    
+    RequestContext& sent = m_pendingRequests[reply];
+    sent = context;
+    sent.sentAt = now;
+    sent.region = m_apiEndpoint;
+    m_inflightReplies[context.requestId].append(reply);
+    m_statistics.requestsSent++;
+    m_lastNetworkActivity = now;
+    m_lastApiRequestAt = now;
+    
+    if (m_keepAliveIntervalMs > 0 && !m_keepAliveTimer->isActive()) {
+        m_keepAliveTimer->start(m_keepAliveIntervalMs);
+    }
+    
+    // Replies are connected one by one; the shared manager's finished()
+    // also reports those of other instances
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        onNetworkReply(reply);
+    });
+    
+    // A TLS handshake on behalf of this reply means no warm connection was free
+    connect(reply, &QNetworkReply::encrypted, this, [reply]() {
+        reply->setProperty("cold_connection", true);
+    });
+    
+    // Pages are decoded as they arrive instead of after the last byte
+    if (context.type == RequestType::GetPayments) {
+        StreamedPage& page = m_streamedPages[reply];
+        page.announce = context.historyId == 0 && context.syncId == 0;
+        connect(reply, &QNetworkReply::readyRead, this, [this, reply]() {
+            onStreamedReplyData(reply);
+        });
+    }
+    
+    // Hedge slow reads once the endpoint's p95 latency has passed;
+    // streamed pages are not hedged so their payments are emitted once
+    if (m_hedgingEnabled && !context.hedge && context.request.method == "GET" &&
+            context.type != RequestType::GetPayments) {
+        int hedgeDelay = m_latencies[context.endpointClass].percentile(0.95);
+        
+        if (hedgeDelay >= 0) {
+            quint64 requestId = context.requestId;
+            QTimer::singleShot(hedgeDelay, this, [this, requestId]() {
+                sendHedgeRequest(requestId);
+            });
+        }
+    }
+}
+
+void AsianCryptoPayment::sendHedgeRequest(quint64 requestId) {
+    QList<QNetworkReply*> replies = m_inflightReplies.value(requestId);
+    if (replies.size() != 1 || !m_pendingRequests.contains(replies.first())) {
+        return;
+    }
+    
+    RequestContext hedge = m_pendingRequests[replies.first()];
+    hedge.hedge = true;
+    
+    // Hedges are optional: skip them on a troubled endpoint or a tight budget
+    if (m_circuitBreakers[hedge.endpointClass].state() != CircuitBreaker::State::Closed ||
+            !m_rateLimits[hedge.endpointClass].tryAcquire(false, QDateTime::currentMSecsSinceEpoch())) {
+        return;
+    }
+    
+    m_statistics.hedgedRequests++;
+    dispatchRequest(hedge);
+}
+
+bool AsianCryptoPayment::resolveHedgedReply(QNetworkReply* reply, const RequestContext& context) {
+    auto it = m_inflightReplies.find(context.requestId);
+    if (it == m_inflightReplies.end()) {
+        return false;
+    }
+    
+    it.value().removeOne(reply);
+    QList<QNetworkReply*> siblings = it.value();
+    
+    if (siblings.isEmpty()) {
+        m_inflightReplies.erase(it);
+        return false;
+    }
+    
+    // Only a success or a definitive client error answers the request; a
+    // transient failure, a rate limit or a broken connection leaves the
+    // answer to the copy still in flight
+    int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    bool definitive = (statusCode >= 200 && statusCode < 300) || statusCode == 304 ||
+                      (statusCode >= 400 && statusCode < 500 && statusCode != 408 && statusCode != 429);
+    if (!definitive) {
+        return true;
+    }
+    
+    // The first usable reply wins; the other copy is aborted
+    m_inflightReplies.erase(it);
+    for (QNetworkReply* sibling : siblings) {
+        m_pendingRequests.remove(sibling);
+        sibling->abort();
+    }
+    
+    if (context.hedge) {
+        m_statistics.hedgeWins++;
+    }
+    
+    return false;
+}
+
+void AsianCryptoPayment::failRequest(const RequestContext& context, int errorCode, const QString& errorMessage) {
+    finishRequest(context.requestId);
+    
+    if (context.historyId != 0) {
+        abortPaymentHistory(context.historyId);
+    }
+    
+    // The mark keeps the progress; the next sync resumes from it
+    if (context.syncId != 0 && context.syncId == m_syncId) {
+        m_syncId = 0;
+    }
+    
+    m_statistics.requestsFailed++;
+    emit error(errorCode, errorMessage);
+}
+
+void AsianCryptoPayment::finishRequest(quint64 requestId) {
+    m_liveRequests.remove(requestId);
+    for (quint64 handleId : m_requestAttachments.take(requestId)) {
+        m_attachedHandles.remove(handleId);
+    }
+    completeOutboundOperation(requestId);
+    
+    for (auto it = m_inflightPaymentFetches.begin(); it != m_inflightPaymentFetches.end(); ++it) {
+        if (it.value() == requestId) {
+            m_inflightPaymentFetches.erase(it);
+            break;
+        }
+    }
+}
+
+void AsianCryptoPayment::armDeadline(quint64 requestId, qint64 deadline) {
+    if (deadline <= 0) {
+        return;
+    }
+    
+    qint64 remaining = qBound<qint64>(0, deadline - QDateTime::currentMSecsSinceEpoch(), INT_MAX);
+    QTimer::singleShot(int(remaining), this, [this, requestId]() {
+        expireRequest(requestId);
+    });
+}
+
+void AsianCryptoPayment::expireRequest(quint64 requestId) {
+    quint64 abandoned = 0;
+    if (!releaseHandle(requestId, abandoned)) {
+        return;
+    }
+    
+    if (abandoned != 0) {
+        abandonRequest(abandoned);
+        
+        // An expired page ends its history walk or sync
+        for (auto it = m_paymentHistories.begin(); it != m_paymentHistories.end(); ++it) {
+            if (it->pageRequests.values().contains(abandoned)) {
+                abortPaymentHistory(it.key());
+                break;
+            }
+        }
+        
+        if (m_syncId != 0 && abandoned == m_syncPageRequest) {
+            m_syncId = 0;
+        }
+    }
+    
+    m_statistics.deadlinesExceeded++;
+    m_statistics.requestsFailed++;
+    emit error(DeadlineExceededError, "Request deadline exceeded");
+}
+
+bool AsianCryptoPayment::releaseHandle(quint64 handleId, quint64& abandonedRequest) {
+    quint64 requestId = m_attachedHandles.value(handleId, handleId);
+    if (!m_liveRequests.contains(requestId)) {
+        return false;
+    }
+    
+    // A caller sharing a coalesced request only detaches from it, once; the
+    // request is abandoned with the last caller
+    auto it = m_requestAttachments.find(requestId);
+    if (it != m_requestAttachments.end()) {
+        if (!it->remove(handleId)) {
+            return false;
+        }
+        m_attachedHandles.remove(handleId);
+        
+        if (!it->isEmpty()) {
+            abandonedRequest = 0;
+            return true;
+        }
+    }
+    
+    abandonedRequest = requestId;
+    return true;
+}
+
+void AsianCryptoPayment::abandonRequest(quint64 requestId) {
+    finishRequest(requestId);
+    
+    for (auto it = m_requestQueues.begin(); it != m_requestQueues.end(); ++it) {
+        QList<RequestContext>& queue = it.value();
+        
+        for (int i = queue.size() - 1; i >= 0; --i) {
+            if (queue.at(i).requestId == requestId) {
+                queue.removeAt(i);
+            }
+        }
+    }
+    
+    // Untrack before aborting so the aborted replies are ignored
+    QList<QNetworkReply*> replies = m_inflightReplies.take(requestId);
+    if (!replies.isEmpty() && m_pendingRequests.contains(replies.first())) {
+        m_laneInFlight[m_pendingRequests[replies.first()].priority]--;
+    }
+    
+    for (QNetworkReply* reply : replies) {
+        m_pendingRequests.remove(reply);
+        reply->abort();
+    }
+}
+
+void AsianCryptoPayment::drainRequestQueues() {
+    // A dispatch can fail at once and emit error(), whose slots may call
+    // back into the SDK and change the queues: each context is taken out
+    // before it is sent and its queue is scanned afresh afterwards
+    for (EndpointClass endpointClass : m_requestQueues.keys()) {
+        bool dispatched = true;
+        while (dispatched) {
+            dispatched = false;
+            QList<RequestContext>& queue = m_requestQueues[endpointClass];
+            TokenBucket& bucket = m_rateLimits[endpointClass];
+            qint64 now = QDateTime::currentMSecsSinceEpoch();
+            
+            // Full lanes are skipped, but a lower lane never takes a token
+            // that a waiting higher lane could not get. Behind a request the
+            // budget holds back, only createPayment may still go, on headroom
+            bool headroomOnly = false;
+            for (int index = 0; index < queue.size(); ++index) {
+                bool privileged = queue.at(index).type == RequestType::CreatePayment;
+                
+                if (!laneHasCapacity(queue.at(index).priority) || (headroomOnly && !privileged)) {
+                    continue;
+                }
+                
+                if (!bucket.tryAcquire(privileged, now)) {
+                    if (privileged) {
+                        break;
+                    }
+                    headroomOnly = true;
+                    continue;
+                }
+                
+                RequestContext context = queue.takeAt(index);
+                dispatchRequest(context);
+                dispatched = true;
+                break;
+            }
+        }
+    }
+    
+    scheduleQueueDrain();
+}
+
+void AsianCryptoPayment::scheduleQueueDrain() {
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    qint64 wait = -1;
+    
+    for (auto it = m_requestQueues.begin(); it != m_requestQueues.end(); ++it) {
+        // Requests in full lanes are woken when a reply frees a slot; a
+        // createPayment behind a held-back request may go sooner on headroom
+        bool headroomOnly = false;
+        for (const RequestContext& next : it.value()) {
+            bool privileged = next.type == RequestType::CreatePayment;
+            if (!laneHasCapacity(next.priority) || (headroomOnly && !privileged)) {
+                continue;
+            }
+            
+            qint64 classWait = m_rateLimits[it.key()].msUntilAvailable(privileged, now);
+            wait = wait < 0 ? classWait : qMin(wait, classWait);
+            
+            if (privileged) {
+                break;
+            }
+            headroomOnly = true;
+        }
+    }
+    
+    if (wait < 0) {
+        m_schedulerTimer->stop();
+    } else {
+        m_schedulerTimer->start(int(qBound<qint64>(1, wait, 60000)));
+    }
+}
+
+bool AsianCryptoPayment::handleRateLimitHeaders(QNetworkReply* reply, RequestContext& context) {
+    const int maxRateLimitRetries = 3;
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    TokenBucket& bucket = m_rateLimits[context.endpointClass];
+    bool ok = false;
+    
+    int limit = reply->rawHeader("X-RateLimit-Limit").toInt(&ok);
+    if (!ok) {
+        limit = -1;
+    }
+    
+    int remaining = reply->rawHeader("X-RateLimit-Remaining").toInt(&ok);
+    if (!ok) {
+        remaining = -1;
+    }
+    
+    qint64 resetAt = reply->rawHeader("X-RateLimit-Reset").toLongLong(&ok) * 1000;
+    if (!ok) {
+        resetAt = 0;
+    }
+    
+    bucket.update(limit, remaining, resetAt, now);
+    
+    if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 429) {
+        return false;
+    }
+    
+    m_statistics.rateLimitedResponses++;
+    
+    // Hold the whole endpoint class until the server says it may continue
+    int retryAfter = reply->rawHeader("Retry-After").toInt(&ok);
+    if (ok) {
+        bucket.blockUntil(now + retryAfter * 1000);
+    } else {
+        bucket.blockUntil(resetAt > now ? resetAt : now + 1000);
+    }
+    
+    if (++context.rateLimitedCount > maxRateLimitRetries) {
+        return false;
+    }
+    
+    enqueueRequest(context, true);
+    return true;
+}
+
+bool AsianCryptoPayment::refetchUncachedResponse(QNetworkReply* reply, RequestContext& context) {
+    // A 304 whose cache entry has been evicted or cleared meanwhile has no
+    // body to serve. Without the entry the request goes out again with no
+    // validators and gets the full body; a second 304 is an error
+    if (context.request.method != "GET" || context.refetched ||
+            reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 304 ||
+            m_responseCache.contains(context.request.endpoint)) {
+        return false;
+    }
+    
+    context.refetched = true;
+    enqueueRequest(context, true);
+    return true;
+}
+
+bool AsianCryptoPayment::isTransientFailure(QNetworkReply* reply) {
+    switch (reply->error()) {
+        case QNetworkReply::ConnectionRefusedError:
+        case QNetworkReply::RemoteHostClosedError:
+        case QNetworkReply::HostNotFoundError:
+        case QNetworkReply::TimeoutError:
+        case QNetworkReply::TemporaryNetworkFailureError:
+        case QNetworkReply::NetworkSessionFailedError:
+        case QNetworkReply::UnknownNetworkError:
+        case QNetworkReply::ProxyTimeoutError:
+            return true;
+        default:
+            break;
+    }
+    
+    int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    return statusCode == 408 || statusCode == 500 || statusCode == 502 ||
+           statusCode == 503 || statusCode == 504;
+}
+
+bool AsianCryptoPayment::decodeResponse(QNetworkReply* reply, const RequestContext& context, QJsonObject& response) {
+    QString cacheKey = context.request.endpoint;
+    bool cacheable = context.request.method == "GET";
+    int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    
+    // Not modified: reuse the decoded object without reading the body
+    if (cacheable && statusCode == 304) {
+        const CachedResponse* cached = m_responseCache.object(cacheKey);
+        if (!cached) {
+            return false;
+        }
+        
+        m_statistics.responseCacheHits++;
+        response = cached->response;
+        return true;
+    }
+    
+    // QNetworkAccessManager advertises gzip and deflate itself and inflates
+    // the body as it arrives; the original length is what crossed the wire
+    QByteArray body = reply->readAll();
+    QVariant wireLength = reply->attribute(QNetworkRequest::OriginalContentLengthAttribute);
+    
+    m_statistics.responseBodyBytes += quint64(body.size());
+    m_statistics.responseWireBytes += wireLength.isValid() ? wireLength.toULongLong() : quint64(body.size());
+    
+    QJsonDocument doc = QJsonDocument::fromJson(body);
+    if (doc.isNull() || !doc.isObject()) {
+        return false;
+    }
+    
+    response = doc.object();
+    
+    if (cacheable) {
+        cacheResponse(reply, context, response);
+    }
+    
+    return true;
+}
+
+void AsianCryptoPayment::cacheResponse(QNetworkReply* reply, const RequestContext& context, const QJsonObject& response,
+                                       const QList<Payment>& payments) {
+    m_statistics.responseCacheMisses++;
+    
+    QByteArray etag = reply->rawHeader("ETag");
+    QByteArray lastModified = reply->rawHeader("Last-Modified");
+    
+    if (etag.isEmpty() && lastModified.isEmpty()) {
+        m_responseCache.remove(context.request.endpoint);
+        return;
+    }
+    
+    CachedResponse* entry = new CachedResponse;
+    entry->etag = etag;
+    entry->lastModified = lastModified;
+    entry->response = response;
+    entry->payments = payments;
+    m_responseCache.insert(context.request.endpoint, entry);
+}
+
+bool AsianCryptoPayment::submitOutboundOperation(const RequestContext& context) {
+    if (m_outboundQueuePath.isEmpty() ||
+            (context.type != RequestType::CreatePayment && context.type != RequestType::CancelPayment)) {
+        return false;
+    }
+    
+    // Creates are independent; operations on an existing payment are ordered
+    OutboundOperation operation;
+    operation.key = context.type == RequestType::CancelPayment ? context.id : QString(context.request.idempotencyKey);
+    operation.queuedAt = QDateTime::currentMSecsSinceEpoch();
+    operation.context = context;
+    
+    for (const OutboundOperation& earlier : m_outboundOperations) {
+        if (earlier.key == operation.key) {
+            operation.parked = true;
+            break;
+        }
+    }
+    
+    m_outboundOperations.insert(m_nextOutboundSequence++, operation);
+    saveOutboundQueue();
+    
+    if (!operation.parked) {
+        enqueueRequest(context);
+    }
+    
+    return true;
+}
+
+bool AsianCryptoPayment::parkOutboundOperation(const RequestContext& context) {
+    for (auto it = m_outboundOperations.begin(); it != m_outboundOperations.end(); ++it) {
+        if (it->context.requestId != context.requestId) {
+            continue;
+        }
+        
+        // Resent with a fresh retry budget once the API is reachable again
+        it->parked = true;
+        it->context.attempt = 1;
+        it->context.rateLimitedCount = 0;
+        m_statistics.operationsDeferred++;
+        
+        if (!m_outboundTimer->isActive()) {
+            m_outboundTimer->start(15000);
+        }
+        return true;
+    }
+    
+    return false;
+}
+
+void AsianCryptoPayment::completeOutboundOperation(quint64 requestId) {
+    for (auto it = m_outboundOperations.begin(); it != m_outboundOperations.end(); ++it) {
+        if (it->context.requestId == requestId) {
+            QString key = it->key;
+            m_outboundOperations.erase(it);
+            saveOutboundQueue();
+            
+            // Release the next operation on the same payment
+            for (auto next = m_outboundOperations.begin(); next != m_outboundOperations.end(); ++next) {
+                if (next->key == key) {
+                    if (next->parked) {
+                        QTimer::singleShot(0, this, &AsianCryptoPayment::drainOutboundQueue);
+                    }
+                    break;
+                }
+            }
+            return;
+        }
+    }
+}
+
+void AsianCryptoPayment::drainOutboundQueue() {
+    QSet<QString> busyKeys;
+    QList<quint64> released;
+    bool parked = false;
+    
+    // Only the oldest operation per key may be on its way
+    for (auto it = m_outboundOperations.cbegin(); it != m_outboundOperations.cend(); ++it) {
+        if (busyKeys.contains(it->key)) {
+            parked = parked || it->parked;
+            continue;
+        }
+        busyKeys.insert(it->key);
+        
+        if (it->parked) {
+            released.append(it.key());
+        }
+    }
+    
+    // Sending can expire a request and complete its operation, so each one
+    // is looked up again and sent from a copy
+    for (quint64 sequence : released) {
+        auto it = m_outboundOperations.find(sequence);
+        if (it == m_outboundOperations.end()) {
+            continue;
+        }
+        
+        it->parked = false;
+        RequestContext context = it->context;
+        enqueueRequest(context);
+    }
+    
+    if (!parked) {
+        m_outboundTimer->stop();
+    }
+}
+
+void AsianCryptoPayment::loadOutboundQueue() {
+    // Operations restored from disk get new request IDs and are resent with
+    // their original idempotency keys, so the server applies them once
+    QFile file(m_outboundQueuePath);
+    if (m_outboundQueuePath.isEmpty() || !file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    while (!file.atEnd()) {
+        QJsonObject entry = QJsonDocument::fromJson(file.readLine()).object();
+        if (entry.isEmpty()) {
+            continue;
+        }
+        
+        RequestContext context;
+        if (!outboundTypeFromName(entry["type"].toString(), context.type)) {
+            qWarning() << "Skipping unknown outbound operation:" << entry["type"].toVariant().toString();
+            continue;
+        }
+        
+        context.id = entry["id"].toString();
+        context.request = prepareApiRequest(entry["endpoint"].toString(), entry["method"].toString(),
+                                            QJsonDocument::fromJson(entry["body"].toString().toUtf8()).object());
+        context.request.idempotencyKey = entry["idempotency_key"].toString().toLatin1();
+        context.endpointClass = routeFor(context.type).endpointClass;
+        context.priority = defaultPriority(context.type);
+        context.submittedAt = now;
+        context.requestId = m_nextRequestId++;
+        m_liveRequests.insert(context.requestId);
+        
+        OutboundOperation operation;
+        operation.key = entry["key"].toString();
+        operation.queuedAt = qint64(entry["queued_at"].toDouble());
+        operation.parked = true;
+        operation.context = context;
+        m_outboundOperations.insert(m_nextOutboundSequence++, operation);
+    }
+    
+    if (!m_outboundOperations.isEmpty()) {
+        m_outboundTimer->start(15000);
+        QTimer::singleShot(0, this, &AsianCryptoPayment::drainOutboundQueue);
+    }
+}
+
+void AsianCryptoPayment::saveOutboundQueue() {
+    if (m_outboundQueuePath.isEmpty()) {
+        return;
+    }
+    
+    QSaveFile file(m_outboundQueuePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to write outbound queue:" << m_outboundQueuePath;
+        return;
+    }
+    
+    // One JSON document per line, oldest first
+    for (const OutboundOperation& operation : m_outboundOperations) {
+        const PreparedRequest& request = operation.context.request;
+        
+        QJsonObject entry;
+        entry["type"] = outboundTypeName(operation.context.type);
+        entry["id"] = operation.context.id;
+        entry["key"] = operation.key;
+        entry["endpoint"] = request.endpoint;
+        entry["method"] = QString::fromLatin1(request.method);
+        entry["body"] = QString::fromUtf8(request.body);
+        entry["idempotency_key"] = QString::fromLatin1(request.idempotencyKey);
+        entry["queued_at"] = double(operation.queuedAt);
+        
+        file.write(QJsonDocument(entry).toJson(QJsonDocument::Compact) + "\n");
+    }
+    
+    file.commit();
+}
+
+bool AsianCryptoPayment::fallBackFromHttp2(QNetworkReply* reply, RequestContext& context) {
+    if (!http2Active() || reply->error() != QNetworkReply::ProtocolFailure) {
+        return false;
+    }
+    
+    // Intermediaries that break HTTP/2 framing surface as protocol failures;
+    // switch to HTTP/1.1 for the rest of the session and resend
+    qWarning() << "HTTP/2 protocol failure, falling back to HTTP/1.1:" << reply->errorString();
+    
+    m_http2FellBack = true;
+    m_statistics.http2Fallbacks++;
+    rebuildRequestTemplate();
+    m_prewarmTimer->start(0);
+    
+    enqueueRequest(context, true);
+    return true;
+}
+
+bool AsianCryptoPayment::retryRequest(QNetworkReply* reply, RequestContext& context) {
+    if (reply->error() == QNetworkReply::NoError || !isTransientFailure(reply)) {
+        return false;
+    }
+    
+    RetryPolicy policy = m_retryPolicies.value(context.type, RetryPolicy(1));
+    if (context.attempt >= policy.maxAttempts || !m_liveRequests.contains(context.requestId)) {
+        if (policy.maxAttempts > 1) {
+            m_statistics.retriesExhausted++;
+        }
+        return false;
+    }
+    
+    // Exponential backoff with jitter, capped at the policy maximum
+    double delay = qMin<double>(policy.maxDelayMs, policy.baseDelayMs * double(1 << qMin(context.attempt - 1, 16)));
+    delay *= 1.0 - policy.jitter * QRandomGenerator::global()->generateDouble();
+    
+    // The region that failed has been left; resend to the new one at once
+    if (context.region != m_apiEndpoint) {
+        delay = 0;
+    }
+    
+    // A retry that cannot start before the deadline would only delay the error
+    if (context.deadline > 0 && QDateTime::currentMSecsSinceEpoch() + qint64(delay) >= context.deadline) {
+        return false;
+    }
+    
+    context.attempt++;
+    m_statistics.retries++;
+    
+    RequestContext retry = context;
+    QTimer::singleShot(int(delay), this, [this, retry]() {
+        enqueueRequest(retry, true);
+    });
+    
+    return true;
+}
+
+void AsianCryptoPayment::onNetworkReply(QNetworkReply* reply) {
+    StreamedPage page = m_streamedPages.take(reply);
+    
+    if (!m_pendingRequests.contains(reply)) {
+        reply->deleteLater();
+        return;
+    }
+    
+    RequestContext context = m_pendingRequests.take(reply);
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    
+    if (isTransientFailure(reply)) {
+        m_circuitBreakers[context.endpointClass].recordFailure(context.sentAt, now);
+        recordRegionOutcome(context.region, true, context.sentAt, now);
+    } else {
+        m_circuitBreakers[context.endpointClass].recordSuccess(context.sentAt, now);
+        recordRegionOutcome(context.region, false, context.sentAt, now);
+    }
+    
+    if (reply->error() == QNetworkReply::NoError) {
+        m_latencies[context.endpointClass].addSample(int(now - context.sentAt));
+        
+        if (reply->attribute(QNetworkRequest::Http2WasUsedAttribute).toBool()) {
+            m_statistics.http2Requests++;
+        }
+        
+        if (reply->property("cold_connection").toBool()) {
+            m_statistics.coldConnectionRequests++;
+            m_statistics.coldConnectionLatencyMs += quint64(now - context.sentAt);
+        } else {
+            m_statistics.warmConnectionRequests++;
+            m_statistics.warmConnectionLatencyMs += quint64(now - context.sentAt);
+        }
+    }
     
-    QString timestamp = QString::number(QDateTime::currentMSecsSinceEpoch());
+    m_lastNetworkActivity = now;
     
-    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
-    request.setRawHeader("X-Merchant-ID", m_merchantId.toUtf8());
-    request.setRawHeader("X-Timestamp", timestamp.toUtf8());
-    request.setRawHeader("X-Test-Mode", m_testMode ? "true" : "false");
-    request.setRawHeader("User-Agent", "AsianCryptoPayment-Qt/1.0.0");
+    if (context.type == RequestType::PollPayments || context.type == RequestType::GetPayment) {
+        applyPollHint(reply, context);
+    }
     
-    if (!data.isEmpty()) {
-        QJsonDocument doc(data);
-        QString dataString = doc.toJson(QJsonDocument::Compact);
-        QString signature = m_securityModule->generateSignature(dataString, timestamp);
-        request.setRawHeader("X-Signature", signature.toUtf8());
+    if (resolveHedgedReply(reply, context)) {
+        reply->deleteLater();
+        return;
     }
     
-    return request;
-}
-
-void AsianCryptoPayment::makeApiRequest(const QString& endpoint, const QString& method, const QJsonObject& data) {
-    QNetworkRequest request = createApiRequest(endpoint, data);
-    QNetworkReply* reply = nullptr;
+    bool resent = fallBackFromHttp2(reply, context) || handleRateLimitHeaders(reply, context) ||
+            retryRequest(reply, context) || refetchUncachedResponse(reply, context);
     
-    if (method == "GET") {
-        reply = m_networkManager->get(request);
-    } else if (method == "POST") {
-        QJsonDocument doc(data);
-        QByteArray requestData = doc.toJson(QJsonDocument::Compact);
-        reply = m_networkManager->post(request, requestData);
-    } else if (method == "PUT") {
-        QJsonDocument doc(data);
-        QByteArray requestData = doc.toJson(QJsonDocument::Compact);
-        reply = m_networkManager->put(request, requestData);
-    } else if (method == "DELETE") {
-        reply = m_networkManager->deleteResource(request);
+    // The request's lane slot is free again. Queued requests go out only now,
+    // once this reply's rate limit headers have updated the budget
+    m_laneInFlight[context.priority]--;
+    if (reply->error() == QNetworkReply::NoError) {
+        m_laneLatencies[context.priority].addSample(int(now - context.submittedAt));
     }
+    drainRequestQueues();
     
-    if (reply) {
-        RequestContext context;
-        
-        if (endpoint.startsWith("payments") && method == "POST" && !endpoint.contains("/cancel")) {
-            context.type = RequestType::CreatePayment;
-        } else if (endpoint.startsWith("payments/") && method == "GET") {
-            context.type = RequestType::GetPayment;
-            context.id = endpoint.mid(9);
-        } else if (endpoint.startsWith("payments") && method == "GET") {
-            context.type = RequestType::GetPayments;
-        } else if (endpoint.contains("/cancel")) {
-            context.type = RequestType::CancelPayment;
-            context.id = endpoint.mid(9, endpoint.indexOf("/cancel") - 9);
-        } else if (endpoint.startsWith("exchange-rates")) {
-            context.type = RequestType::GetExchangeRates;
-        }
-        
-        m_pendingRequests[reply] = context;
+    if (resent) {
+        reply->deleteLater();
+        return;
     }
-}
-
-void AsianCryptoPayment::onNetworkReply(QNetworkReply* reply) {
-    if (!m_pendingRequests.contains(reply)) {
+    
+    // Unreachable API: keep durable operations for later instead of failing
+    if (isTransientFailure(reply) && parkOutboundOperation(context)) {
         reply->deleteLater();
         return;
     }
     
-    RequestContext context = m_pendingRequests.take(reply);
+    // Status checks only report to callers that attached to them
+    QSet<quint64> callers = m_requestAttachments.value(context.requestId);
+    callers.remove(context.requestId);
+    bool attached = !callers.isEmpty();
+    finishRequest(context.requestId);
+    
+    if (reply->error() == QNetworkReply::NoError && m_outboundTimer->isActive()) {
+        drainOutboundQueue();
+    }
     
     if (reply->error() != QNetworkReply::NoError) {
-        emit error(reply->error(), reply->errorString());
+        int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        
+        // A server without multi-id lookup rejects the batch; poll one by one
+        if (context.type == RequestType::PollPayments &&
+                (statusCode == 400 || statusCode == 404 || statusCode == 405 || statusCode == 501)) {
+            m_batchPollingSupported = false;
+            pollPaymentsIndividually(context.paymentIds);
+            reply->deleteLater();
+            return;
+        }
+        
+        failRequest(context, reply->error(), reply->errorString());
         reply->deleteLater();
         return;
     }
     
-    QByteArray responseData = reply->readAll();
-    QJsonDocument doc = QJsonDocument::fromJson(responseData);
+    QJsonObject response;
+    bool streamed = page.parser.hasStarted();
     
-    if (doc.isNull() || !doc.isObject()) {
-        emit error(500, "Invalid JSON response");
+    if (streamed) {
+        for (const Payment& payment : feedStreamedPage(page, reply->readAll())) {
+            if (page.announce) {
+                emit paymentStreamed(payment);
+            }
+        }
+        
+        QVariant wireLength = reply->attribute(QNetworkRequest::OriginalContentLengthAttribute);
+        m_statistics.responseWireBytes += wireLength.isValid() ? wireLength.toULongLong() : page.bytes;
+    }
+    
+    // A page that cannot be read ends its history walk or sync like any failure
+    if (!(streamed ? page.parser.finish(response) : decodeResponse(reply, context, response))) {
+        failRequest(context, 500, "Invalid JSON response");
         reply->deleteLater();
         return;
     }
     
-    QJsonObject response = doc.object();
+    // Streamed pages are cached decoded; an unchanged page comes back from
+    // the cache with its payments and is announced at once
+    if (streamed) {
+        cacheResponse(reply, context, response, page.payments);
+    } else if (context.type == RequestType::GetPayments &&
+               reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 304) {
+        page.payments = m_responseCache.object(context.request.endpoint)->payments;
+        
+        if (page.announce) {
+            for (const Payment& payment : page.payments) {
+                emit paymentStreamed(payment);
+            }
+        }
+    }
     
     try {
         switch (context.type) {
             case RequestType::CreatePayment: {
                 Payment payment = Payment::fromJson(response);
                 m_activePayments[payment.id()] = payment;
+                acceptPaymentRevision(payment);
                 startPaymentStatusCheck(payment);
                 emit paymentCreated(payment);
                 break;
             }
             case RequestType::GetPayment: {
                 Payment payment = Payment::fromJson(response);
-                emit paymentRetrieved(payment);
+                if (m_activePayments.contains(payment.id()) || context.statusCheck) {
+                    payment = applyPolledPayment(payment);
+                } else {
+                    acceptPaymentRevision(payment);
+                }
+                
+                if (!context.statusCheck || attached) {
+                    emit paymentRetrieved(payment);
+                }
+                break;
+            }
+            case RequestType::PollPayments: {
+                handlePollReply(context.paymentIds, response);
                 break;
             }
             case RequestType::GetPayments: {
-                QList<Payment> payments;
+                QList<Payment> payments = page.payments;
                 int total = response["total"].toInt();
                 
-                if (response.contains("payments") && response["payments"].isArray()) {
+                if (!streamed && response.contains("payments") && response["payments"].isArray()) {
                     QJsonArray paymentsArray = response["payments"].toArray();
                     
                     for (const QJsonValue& value : paymentsArray) {
@@ -326,11 +2053,24 @@ void AsianCryptoPayment::onNetworkReply(QNetworkReply* reply) {
                     }
                 }
                 
+                // History walks and syncs deliver pages their own way
+                if (context.historyId != 0) {
+                    handleHistoryPage(context, payments, response);
+                    break;
+                }
+                if (context.syncId != 0) {
+                    handleSyncPage(context, payments, response);
+                    break;
+                }
+                
                 emit paymentsRetrieved(payments, total);
                 break;
             }
             case RequestType::CancelPayment: {
+                // Recorded so that the cancellation arriving again by webhook,
+                // or a check answered before it, is not reported afterwards
                 Payment payment = Payment::fromJson(response);
+                acceptPaymentRevision(payment);
                 stopPaymentStatusCheck(payment.id());
                 emit paymentCancelled(payment);
                 break;
@@ -353,14 +2093,58 @@ void AsianCryptoPayment::onNetworkReply(QNetworkReply* reply) {
             default:
                 break;
         }
+        
+        m_statistics.requestsSucceeded++;
     } catch (const std::exception& e) {
-        emit error(500, QString::fromStdString(e.what()));
+        failRequest(context, 500, QString::fromStdString(e.what()));
     }
     
     reply->deleteLater();
 }
 
+void AsianCryptoPayment::onStreamedReplyData(QNetworkReply* reply) {
+    auto it = m_streamedPages.find(reply);
+    
+    // Only successful pages are streamed; anything else takes the normal path
+    if (it == m_streamedPages.end() || reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 200) {
+        return;
+    }
+    
+    // Emitted after the page is updated, in case a slot starts another request
+    bool announce = it->announce;
+    for (const Payment& payment : feedStreamedPage(*it, reply->readAll())) {
+        if (announce) {
+            emit paymentStreamed(payment);
+        }
+    }
+}
+
+QList<Payment> AsianCryptoPayment::feedStreamedPage(StreamedPage& page, const QByteArray& data) {
+    page.bytes += quint64(data.size());
+    m_statistics.responseBodyBytes += quint64(data.size());
+    page.parser.feed(data);
+    
+    QList<Payment> payments;
+    for (const QJsonObject& element : page.parser.takeElements()) {
+        payments.append(Payment::fromJson(element));
+    }
+    
+    page.payments.append(payments);
+    return payments;
+}
+
 void AsianCryptoPayment::onQrCodeDownloaded(QNetworkReply* reply) {
+    quint64 requestId = reply->property("request_id").toULongLong();
+    
+    // Cancelled or expired; already reported if needed
+    if (!m_liveRequests.contains(requestId)) {
+        reply->deleteLater();
+        return;
+    }
+    
+    m_inflightReplies.remove(requestId);
+    finishRequest(requestId);
+    
     if (reply->error() != QNetworkReply::NoError) {
         emit error(reply->error(), reply->errorString());
         reply->deleteLater();
@@ -380,40 +2164,542 @@ void AsianCryptoPayment::onQrCodeDownloaded(QNetworkReply* reply) {
 }
 
 void AsianCryptoPayment::startPaymentStatusCheck(const Payment& payment) {
-    if (m_paymentTimers.contains(payment.id())) {
+    if (m_statusChecks.contains(payment.id())) {
         return;
     }
     
-    QTimer* timer = new QTimer(this);
-    m_paymentTimers[payment.id()] = timer;
+    // An idle wheel has not been advanced; catch up so the delay counts from now
+    if (m_statusChecks.size() == 0) {
+        m_statusChecks.advance(m_statusCheckClock.elapsed());
+    }
+    
+    m_statusCheckStates.insert(payment.id(), StatusCheckState());
+    scheduleStatusCheck(payment.id());
+    sendPushSubscription("subscribe", QStringList() << payment.id());
+    
+    // Already past expiry: only the last check is left, and it goes out
+    // with the next batch
+    if (!m_statusChecks.contains(payment.id())) {
+        m_duePaymentChecks.insert(payment.id());
+        m_statusCheckStates[payment.id()].checks++;
+        
+        if (!m_pollBatchTimer->isActive()) {
+            m_pollBatchTimer->start(500);
+        }
+        return;
+    }
     
-    connect(timer, &QTimer::timeout, this, &AsianCryptoPayment::checkPaymentStatus);
-    timer->setProperty("payment_id", payment.id());
-    timer->start(10000); // Check every 10 seconds
+    if (!m_statusCheckTimer->isActive()) {
+        m_statusCheckTimer->start(m_statusChecks.tickMs());
+    }
 }
 
 void AsianCryptoPayment::stopPaymentStatusCheck(const QString& paymentId) {
-    if (m_paymentTimers.contains(paymentId)) {
-        QTimer* timer = m_paymentTimers.take(paymentId);
-        timer->stop();
-        timer->deleteLater();
+    m_statusChecks.cancel(paymentId);
+    m_activePayments.remove(paymentId);
+    
+    if (m_statusCheckStates.remove(paymentId) > 0) {
+        m_statistics.statusCheckedPayments++;
+        sendPushSubscription("unsubscribe", QStringList() << paymentId);
     }
     
-    m_activePayments.remove(paymentId);
+    if (m_statusChecks.size() == 0) {
+        m_statusCheckTimer->stop();
+    }
 }
 
 void AsianCryptoPayment::checkPaymentStatus() {
-    QTimer* timer = qobject_cast<QTimer*>(sender());
-    if (!timer) {
+    QStringList due = m_statusChecks.advance(m_statusCheckClock.elapsed());
+    if (due.isEmpty()) {
         return;
     }
     
-    QString paymentId = timer->property("payment_id").toString();
-    if (paymentId.isEmpty()) {
+    // Collect due payments and poll them together in one request
+    for (const QString& paymentId : due) {
+        m_duePaymentChecks.insert(paymentId);
+        m_statusCheckStates[paymentId].checks++;
+        scheduleStatusCheck(paymentId);
+    }
+    
+    if (!m_pollBatchTimer->isActive()) {
+        m_pollBatchTimer->start(500);
+    }
+}
+
+void AsianCryptoPayment::pollDuePayments() {
+    const int pollHorizon = 5000;
+    const int maxBatchSize = 100;
+    
+    // Payments whose next check is close join this batch; rescheduling them
+    // keeps them in step so later batches stay large
+    for (const QString& paymentId : m_statusChecks.takeDueWithin(pollHorizon)) {
+        m_duePaymentChecks.insert(paymentId);
+        m_statusCheckStates[paymentId].checks++;
+        scheduleStatusCheck(paymentId);
+    }
+    
+    QStringList due;
+    for (const QString& paymentId : m_duePaymentChecks) {
+        if (m_activePayments.contains(paymentId)) {
+            due.append(paymentId);
+        }
+    }
+    m_duePaymentChecks.clear();
+    m_statistics.statusChecks += quint64(due.size());
+    
+    if (!m_batchPollingSupported) {
+        pollPaymentsIndividually(due);
+    } else {
+        for (int i = 0; i < due.size(); i += maxBatchSize) {
+            QStringList batch = due.mid(i, maxBatchSize);
+            
+            QStringList ids;
+            for (const QString& paymentId : batch) {
+                ids << QString::fromLatin1(QUrl::toPercentEncoding(paymentId));
+            }
+            
+            QString endpoint = QString("payments?ids=%1&limit=%2").arg(ids.join(","), QString::number(batch.size()));
+            RequestContext context = newRequestContext(RequestType::PollPayments, endpoint, QString(), QJsonObject(),
+                                                       RequestOptions());
+            context.paymentIds = batch;
+            submitRequest(context);
+        }
+    }
+    
+    // Payments left off the wheel have had their last check after expiry;
+    // tracking ends now, whether or not its answer ever comes back
+    for (const QString& paymentId : due) {
+        if (!m_statusChecks.contains(paymentId)) {
+            stopPaymentStatusCheck(paymentId);
+        }
+    }
+}
+
+void AsianCryptoPayment::scheduleStatusCheck(const QString& paymentId) {
+    const int expiryGraceMs = 2000;
+    const int pushSafetyPollIntervalMs = 60000;
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    const StatusCheckState state = m_statusCheckStates.value(paymentId);
+    
+    // Fast right after the QR code is shown, slower the longer nobody pays
+    double interval = m_pollingPolicy.initialIntervalMs;
+    for (int i = 0; i < state.checks && interval < m_pollingPolicy.maxIntervalMs; ++i) {
+        interval *= m_pollingPolicy.backoffFactor;
+    }
+    qint64 delay = qMin<qint64>(m_pollingPolicy.maxIntervalMs, qint64(interval));
+    
+    // With a healthy push channel polling is only a safety net
+    if (m_pushHealthy) {
+        delay = qMax<qint64>(delay, pushSafetyPollIntervalMs);
+    }
+    
+    QDateTime expiresAt = m_activePayments.value(paymentId).expiresAt();
+    if (expiresAt.isValid()) {
+        qint64 untilExpiry = expiresAt.toMSecsSinceEpoch() - now;
+        
+        // The check going out now is the one after expiry; it is the last,
+        // and tracking ends once it has been sent
+        if (untilExpiry + expiryGraceMs <= 0) {
+            m_statusChecks.cancel(paymentId);
+            return;
+        }
+        
+        // Fast again near expiry, and never sleeping past it
+        if (untilExpiry <= m_pollingPolicy.expiryWindowMs) {
+            delay = qMin<qint64>(delay, m_pollingPolicy.initialIntervalMs);
+        }
+        delay = qMin(delay, untilExpiry + expiryGraceMs);
+    }
+    
+    if (state.notBefore > now) {
+        delay = qMax(delay, state.notBefore - now);
+    }
+    
+    m_statusChecks.schedule(paymentId, delay);
+}
+
+void AsianCryptoPayment::applyPollHint(QNetworkReply* reply, const RequestContext& context) {
+    bool ok = false;
+    int retryAfter = reply->rawHeader("Retry-After").toInt(&ok);
+    if (!ok || retryAfter <= 0) {
+        return;
+    }
+    
+    QStringList paymentIds = context.type == RequestType::PollPayments ? context.paymentIds
+                                                                       : QStringList() << context.id;
+    qint64 notBefore = QDateTime::currentMSecsSinceEpoch() + qint64(retryAfter) * 1000;
+    
+    for (const QString& paymentId : paymentIds) {
+        auto it = m_statusCheckStates.find(paymentId);
+        if (it == m_statusCheckStates.end()) {
+            continue;
+        }
+        
+        it->notBefore = notBefore;
+        if (m_statusChecks.contains(paymentId)) {
+            scheduleStatusCheck(paymentId);
+        }
+    }
+}
+
+bool AsianCryptoPayment::pushChannelOpen() const {
+    return m_pushStreamReply || (m_pushSocket && m_pushSocket->state() != QAbstractSocket::UnconnectedState);
+}
+
+void AsianCryptoPayment::closePushChannel() {
+    if (m_pushStreamReply) {
+        m_pushStreamReply->abort();
+    }
+    if (m_pushSocket) {
+        m_pushSocket->abort();
+    }
+}
+
+void AsianCryptoPayment::connectPushChannel() {
+    if (m_pushEndpoint.isEmpty() || pushChannelOpen()) {
+        return;
+    }
+    
+    if (m_pushReconnectAttempts > 0) {
+        m_statistics.pushReconnects++;
+    }
+    
+    QUrl url(m_pushEndpoint);
+    QNetworkRequest request(m_requestTemplate);
+    request.setUrl(url);
+    request.setRawHeader("X-Timestamp", QByteArray::number(QDateTime::currentMSecsSinceEpoch()));
+    
+    if (url.scheme() == "ws" || url.scheme() == "wss") {
+        if (!m_pushSocket) {
+            m_pushSocket = new QWebSocket(QString(), QWebSocketProtocol::VersionLatest, this);
+            connect(m_pushSocket, &QWebSocket::connected, this, &AsianCryptoPayment::onPushConnected);
+            connect(m_pushSocket, &QWebSocket::disconnected, this, &AsianCryptoPayment::onPushDisconnected);
+            connect(m_pushSocket, &QWebSocket::textMessageReceived, this, &AsianCryptoPayment::onPushMessage);
+            connect(m_pushSocket, &QWebSocket::pong, this, [this]() {
+                m_pushLastPong = QDateTime::currentMSecsSinceEpoch();
+            });
+        }
+        
+        m_pushSocket->open(request);
+        return;
+    }
+    
+    // One long-lived response for all payments; the server resumes after
+    // Last-Event-ID and sends comment lines as heartbeats
+    request.setRawHeader("Accept", "text/event-stream");
+    request.setRawHeader("Cache-Control", "no-cache");
+    request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysNetwork);
+    if (m_pushSequence > 0) {
+        request.setRawHeader("Last-Event-ID", QByteArray::number(m_pushSequence));
+    }
+    
+    m_pushStreamBuffer.clear();
+    m_pushStreamReply = m_networkManager->get(request);
+    connect(m_pushStreamReply, &QNetworkReply::readyRead, this, &AsianCryptoPayment::onPushStreamData);
+    connect(m_pushStreamReply, &QNetworkReply::finished, this, &AsianCryptoPayment::onPushStreamFinished);
+    
+    m_pushLastPong = QDateTime::currentMSecsSinceEpoch();
+    m_pushPingTimer->start(pushPingIntervalMs);
+}
+
+void AsianCryptoPayment::onPushConnected() {
+    // Healthy once the server confirms the subscription
+    m_pushLastPong = QDateTime::currentMSecsSinceEpoch();
+    m_pushPingTimer->start(pushPingIntervalMs);
+    sendPushSubscription("subscribe", m_statusCheckStates.keys());
+}
+
+void AsianCryptoPayment::onPushStreamData() {
+    if (!m_pushStreamReply) {
+        return;
+    }
+    
+    if (m_pushStreamReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 200) {
+        m_pushStreamReply->abort();
+        return;
+    }
+    
+    m_pushLastPong = QDateTime::currentMSecsSinceEpoch();
+    m_pushStreamBuffer.append(m_pushStreamReply->readAll());
+    m_pushStreamBuffer.replace("\r\n", "\n");
+    
+    // Events end with a blank line; their data lines are joined, other
+    // fields and comments are not needed
+    int end;
+    while ((end = m_pushStreamBuffer.indexOf("\n\n")) >= 0) {
+        QByteArray block = m_pushStreamBuffer.left(end);
+        m_pushStreamBuffer.remove(0, end + 2);
+        
+        QByteArray data;
+        for (const QByteArray& line : block.split('\n')) {
+            if (line.startsWith("data:")) {
+                if (!data.isEmpty()) {
+                    data.append('\n');
+                }
+                data.append(line.mid(line.startsWith("data: ") ? 6 : 5));
+            }
+        }
+        
+        if (!data.isEmpty()) {
+            onPushMessage(QString::fromUtf8(data));
+        }
+    }
+}
+
+void AsianCryptoPayment::onPushStreamFinished() {
+    m_pushStreamReply->deleteLater();
+    m_pushStreamReply = nullptr;
+    onPushDisconnected();
+}
+
+void AsianCryptoPayment::onPushDisconnected() {
+    m_pushPingTimer->stop();
+    setPushHealthy(false);
+    
+    if (m_pushEndpoint.isEmpty()) {
+        return;
+    }
+    
+    // Exponential backoff with jitter, so kiosks do not reconnect together
+    double delay = qMin(30000.0, 1000.0 * double(1 << qMin(m_pushReconnectAttempts, 5)));
+    delay *= 1.0 - 0.5 * QRandomGenerator::global()->generateDouble();
+    m_pushReconnectAttempts++;
+    m_pushReconnectTimer->start(int(delay));
+}
+
+void AsianCryptoPayment::checkPushHealth() {
+    const int pongTimeoutMs = 25000;
+    
+    // A channel that stops answering pings is as good as closed
+    if (QDateTime::currentMSecsSinceEpoch() - m_pushLastPong > pongTimeoutMs) {
+        qWarning() << "Push channel stopped answering; falling back to polling";
+        closePushChannel();
+        return;
+    }
+    
+    // Event streams are kept alive by the server's heartbeats
+    if (m_pushSocket && m_pushSocket->state() == QAbstractSocket::ConnectedState) {
+        m_pushSocket->ping();
+    }
+}
+
+void AsianCryptoPayment::onPushMessage(const QString& message) {
+    QJsonObject event = QJsonDocument::fromJson(message.toUtf8()).object();
+    QString type = event["type"].toString();
+    qint64 sequence = qint64(event["sequence"].toDouble());
+    
+    // The first confirmation after connecting says whether the server
+    // replays what was missed; if not, the payments are polled instead and
+    // later resumes start from the server's current sequence
+    if (type == "subscribed") {
+        if (!m_pushHealthy) {
+            if (!event["resumed"].toBool()) {
+                if (m_pushSequence > 0) {
+                    checkAllPaymentsNow();
+                }
+                m_pushSequence = sequence;
+            }
+            
+            m_pushReconnectAttempts = 0;
+            setPushHealthy(true);
+        }
+        return;
+    }
+    
+    if (!event.contains("data") || !event["data"].isObject()) {
+        return;
+    }
+    
+    // Replays after a resume can overlap with events already seen
+    if (sequence > 0 && sequence <= m_pushSequence) {
+        return;
+    }
+    m_pushSequence = qMax(m_pushSequence, sequence);
+    
+    m_statistics.pushEvents++;
+    if (event.contains("sent_at")) {
+        m_statistics.pushDeliveryMs +=
+                quint64(qMax<qint64>(0, QDateTime::currentMSecsSinceEpoch() - qint64(event["sent_at"].toDouble())));
+    }
+    
+    dispatchPaymentEvent(event, false);
+}
+
+void AsianCryptoPayment::sendPushSubscription(const QString& type, const QStringList& paymentIds) {
+    if (!m_pushSocket || m_pushSocket->state() != QAbstractSocket::ConnectedState) {
+        return;
+    }
+    
+    QJsonObject message;
+    message["type"] = type;
+    message["payment_ids"] = QJsonArray::fromStringList(paymentIds);
+    
+    // Only the subscription made on connecting resumes
+    if (type == "subscribe" && !m_pushHealthy && m_pushSequence > 0) {
+        message["resume_from"] = double(m_pushSequence);
+    }
+    
+    m_pushSocket->sendTextMessage(QString::fromUtf8(QJsonDocument(message).toJson(QJsonDocument::Compact)));
+}
+
+void AsianCryptoPayment::setPushHealthy(bool healthy) {
+    if (m_pushHealthy == healthy) {
+        return;
+    }
+    
+    m_pushHealthy = healthy;
+    
+    // Move every check to the new schedule; after losing the channel, poll
+    // at once for whatever was missed while it was failing
+    for (auto it = m_statusCheckStates.constBegin(); it != m_statusCheckStates.constEnd(); ++it) {
+        if (m_statusChecks.contains(it.key())) {
+            scheduleStatusCheck(it.key());
+        }
+    }
+    
+    if (!healthy) {
+        checkAllPaymentsNow();
+    }
+    
+    emit pushChannelChanged(healthy);
+}
+
+void AsianCryptoPayment::checkAllPaymentsNow() {
+    for (auto it = m_statusCheckStates.constBegin(); it != m_statusCheckStates.constEnd(); ++it) {
+        m_duePaymentChecks.insert(it.key());
+    }
+    
+    if (!m_duePaymentChecks.isEmpty() && !m_pollBatchTimer->isActive()) {
+        m_pollBatchTimer->start(500);
+    }
+}
+
+void AsianCryptoPayment::handlePollReply(const QStringList& paymentIds, const QJsonObject& response) {
+    QMap<QString, Payment> received;
+    bool filtered = true;
+    QJsonArray paymentsArray = response["payments"].toArray();
+    
+    for (const QJsonValue& value : paymentsArray) {
+        Payment payment = Payment::fromJson(value.toObject());
+        
+        if (!paymentIds.contains(payment.id())) {
+            filtered = false;
+            break;
+        }
+        
+        received[payment.id()] = payment;
+    }
+    
+    // Payments outside the batch mean the server ignored the id filter;
+    // poll one by one from now on
+    if (!filtered) {
+        m_batchPollingSupported = false;
+        pollPaymentsIndividually(paymentIds);
         return;
     }
     
-    getPayment(paymentId);
+    // Payments the batch left out, possibly all of them, are fetched on
+    // their own this time only
+    QStringList missing;
+    for (const QString& paymentId : paymentIds) {
+        if (received.contains(paymentId)) {
+            applyPolledPayment(received[paymentId]);
+        } else {
+            missing.append(paymentId);
+        }
+    }
+    
+    pollPaymentsIndividually(missing);
+}
+
+void AsianCryptoPayment::pollPaymentsIndividually(const QStringList& paymentIds) {
+    // A fetch already in flight reports through applyPolledPayment as well
+    for (const QString& paymentId : paymentIds) {
+        if (m_activePayments.contains(paymentId) && !m_inflightPaymentFetches.contains(paymentId)) {
+            fetchPayment(paymentId, true, RequestOptions());
+        }
+    }
+}
+
+Payment AsianCryptoPayment::applyPolledPayment(const Payment& payment) {
+    // The answer to a last check arrives after tracking has ended; it is
+    // still reported if it brings news
+    if (!m_activePayments.contains(payment.id())) {
+        if (acceptPaymentRevision(payment)) {
+            emit paymentStatusUpdated(payment);
+        }
+        return payment;
+    }
+    
+    const Payment previous = m_activePayments[payment.id()];
+    Payment current = previous;
+    
+    if (acceptPaymentRevision(payment)) {
+        current = payment;
+        m_activePayments[payment.id()] = payment;
+        emit paymentStatusUpdated(payment);
+        
+        if (payment.status() == PaymentStatus::Completed && previous.status() != PaymentStatus::Completed &&
+                payment.updatedAt().isValid()) {
+            m_statistics.completionsDetected++;
+            m_statistics.completionDetectionMs +=
+                    quint64(qMax<qint64>(0, QDateTime::currentMSecsSinceEpoch() - payment.updatedAt().toMSecsSinceEpoch()));
+        }
+    }
+    
+    if (current.status() == PaymentStatus::Completed ||
+            current.status() == PaymentStatus::Cancelled ||
+            current.status() == PaymentStatus::Expired) {
+        stopPaymentStatusCheck(payment.id());
+    }
+    
+    return current;
+}
+
+bool AsianCryptoPayment::acceptPaymentRevision(const Payment& payment) {
+    auto statusRank = [](PaymentStatus status) {
+        switch (status) {
+            case PaymentStatus::Created: return 0;
+            case PaymentStatus::Pending: return 1;
+            default: return 2;
+        }
+    };
+    
+    // Looking a payment up marks it as recently seen; tracked payments are
+    // seen on every check, so the cache forgets finished ones first
+    PaymentRevision* revision = m_paymentRevisions.object(payment.id());
+    if (revision) {
+        // A finished payment stays finished; otherwise the server's version
+        // decides, then updated_at, then how far the status has progressed
+        int order;
+        if (statusRank(revision->status) == 2 && statusRank(payment.status()) < 2) {
+            order = -1;
+        } else if (revision->version > 0 && payment.version() > 0 && revision->version != payment.version()) {
+            order = payment.version() > revision->version ? 1 : -1;
+        } else if (revision->updatedAt.isValid() && payment.updatedAt().isValid() &&
+                   revision->updatedAt != payment.updatedAt()) {
+            order = payment.updatedAt() > revision->updatedAt ? 1 : -1;
+        } else {
+            order = statusRank(payment.status()) - statusRank(revision->status);
+        }
+        
+        if (order <= 0) {
+            if (order == 0) {
+                m_statistics.duplicateUpdates++;
+            } else {
+                m_statistics.staleUpdates++;
+            }
+            return false;
+        }
+    } else {
+        revision = new PaymentRevision;
+        m_paymentRevisions.insert(payment.id(), revision);
+    }
+    
+    revision->version = payment.version();
+    revision->updatedAt = payment.updatedAt();
+    revision->status = payment.status();
+    return true;
 }
 
 } // namespace AsianCryptoPay
@@ -0,0 +1,282 @@
+/**
+ * Asian Cryptocurrency Payment System - Scripted API server for SDK tests
+ * 
+ * Unlike the mock server, which simulates the API, this one answers each
+ * request with exactly the response a test queued for it, so error paths
+ * (bad JSON, 304 without a cache entry, empty batches, ...) can be
+ * reproduced deterministically. Every request is recorded.
+ */
+
+#ifndef FAKE_API_SERVER_H
+#define FAKE_API_SERVER_H
+
+#include <QDateTime>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QHostAddress>
+#include <QUrl>
+#include <QUrlQuery>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QList>
+#include <QSet>
+
+class FakeApiServer : public QObject {
+public:
+    /**
+     * @brief Request as received
+     */
+    struct Request {
+        QByteArray method;
+        QString path;
+        QUrlQuery query;
+        QMap<QByteArray, QByteArray> headers;   // Lower-case names
+        QByteArray body;
+    };
+    
+    /**
+     * @brief Response to send back
+     */
+    struct Response {
+        int status = 200;
+        QByteArray body;
+        QMap<QByteArray, QByteArray> headers;
+        bool eventStream = false;               // Keep the connection open for sendEvent()
+        bool hang = false;                      // Never answer
+        int delayMs = 0;                        // Answer this much later
+    };
+    
+    explicit FakeApiServer(QObject* parent = nullptr)
+        : QObject(parent)
+        , m_server(new QTcpServer(this))
+    {
+        connect(m_server, &QTcpServer::newConnection, this, [this]() {
+            onNewConnection();
+        });
+    }
+    
+    /**
+     * @brief Start listening on a free localhost port
+     * @return Whether the server is listening
+     */
+    bool listen() { return m_server->listen(QHostAddress::LocalHost); }
+    
+    /**
+     * @brief Get the base URL to pass to setApiEndpoint()
+     * @return Base URL without a trailing slash
+     */
+    QString url() const { return QString("http://127.0.0.1:%1").arg(m_server->serverPort()); }
+    
+    /**
+     * @brief Queue a one-off response for a method and path
+     * 
+     * Queued responses are used in order before the route's standing
+     * response.
+     */
+    void enqueue(const QByteArray& method, const QString& path, const Response& response) {
+        m_queued[method + ' ' + path.toUtf8()].append(response);
+    }
+    
+    /**
+     * @brief Set the response used whenever nothing is queued
+     */
+    void setRoute(const QByteArray& method, const QString& path, const Response& response) {
+        m_routes[method + ' ' + path.toUtf8()] = response;
+    }
+    
+    static Response json(int status, const QJsonObject& body,
+                         const QMap<QByteArray, QByteArray>& headers = QMap<QByteArray, QByteArray>()) {
+        Response response;
+        response.status = status;
+        response.body = QJsonDocument(body).toJson(QJsonDocument::Compact);
+        response.headers = headers;
+        response.headers["Content-Type"] = "application/json";
+        return response;
+    }
+    
+    static Response raw(int status, const QByteArray& body = QByteArray()) {
+        Response response;
+        response.status = status;
+        response.body = body;
+        return response;
+    }
+    
+    static Response delayed(Response response, int delayMs) {
+        response.delayMs = delayMs;
+        return response;
+    }
+    
+    /**
+     * @brief Get the requests received so far
+     * @param method Only requests with this method; empty for all
+     * @param path Only requests for this path; empty for all
+     */
+    QList<Request> requests(const QByteArray& method = QByteArray(), const QString& path = QString()) const {
+        QList<Request> matching;
+        for (const Request& request : m_requests) {
+            if ((method.isEmpty() || request.method == method) && (path.isEmpty() || request.path == path)) {
+                matching.append(request);
+            }
+        }
+        return matching;
+    }
+    
+    int count(const QByteArray& method, const QString& path) const { return requests(method, path).size(); }
+    
+    void clearRequests() { m_requests.clear(); }
+    
+    /**
+     * @brief Write raw data to every open event stream
+     */
+    void sendEvent(const QByteArray& data) {
+        for (QTcpSocket* socket : m_streams) {
+            socket->write(data);
+            socket->flush();
+        }
+    }
+    
+    /**
+     * @brief Close every open event stream
+     */
+    void closeStreams() {
+        for (QTcpSocket* socket : m_streams) {
+            socket->disconnectFromHost();
+        }
+    }
+    
+    int streamCount() const { return m_streams.size(); }
+
+private:
+    QTcpServer* m_server;
+    QMap<QByteArray, QList<Response>> m_queued;
+    QMap<QByteArray, Response> m_routes;
+    QMap<QTcpSocket*, QByteArray> m_buffers;
+    QSet<QTcpSocket*> m_streams;
+    QList<Request> m_requests;
+    
+    void onNewConnection() {
+        while (m_server->hasPendingConnections()) {
+            QTcpSocket* socket = m_server->nextPendingConnection();
+            
+            connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+                onReadyRead(socket);
+            });
+            connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+                m_buffers.remove(socket);
+                m_streams.remove(socket);
+                socket->deleteLater();
+            });
+        }
+    }
+    
+    void onReadyRead(QTcpSocket* socket) {
+        QByteArray& buffer = m_buffers[socket];
+        buffer.append(socket->readAll());
+        
+        int headerEnd = buffer.indexOf("\r\n\r\n");
+        if (headerEnd < 0) {
+            return;
+        }
+        
+        Request request;
+        QList<QByteArray> lines = buffer.left(headerEnd).split('\n');
+        QList<QByteArray> requestLine = lines.first().trimmed().split(' ');
+        for (int i = 1; i < lines.size(); ++i) {
+            int colon = lines[i].indexOf(':');
+            if (colon > 0) {
+                request.headers[lines[i].left(colon).trimmed().toLower()] = lines[i].mid(colon + 1).trimmed();
+            }
+        }
+        
+        int contentLength = request.headers.value("content-length").toInt();
+        if (requestLine.size() < 2 || buffer.size() < headerEnd + 4 + contentLength) {
+            return;
+        }
+        
+        QUrl url(QString::fromLatin1(requestLine[1]));
+        request.method = requestLine[0];
+        request.path = url.path();
+        request.query = QUrlQuery(url);
+        request.body = buffer.mid(headerEnd + 4, contentLength);
+        buffer.clear();
+        m_requests.append(request);
+        
+        respond(socket, request, takeResponse(request));
+    }
+    
+    Response takeResponse(const Request& request) {
+        QByteArray key = request.method + ' ' + request.path.toUtf8();
+        
+        if (!m_queued.value(key).isEmpty()) {
+            return m_queued[key].takeFirst();
+        }
+        if (m_routes.contains(key)) {
+            return m_routes[key];
+        }
+        
+        // Keep-alive pings and region probes hit the base URL
+        return raw(request.method == "HEAD" ? 200 : 404);
+    }
+    
+    void respond(QTcpSocket* socket, const Request& request, const Response& response) {
+        if (response.hang) {
+            return;
+        }
+        
+        if (response.delayMs > 0) {
+            Response later = response;
+            later.delayMs = 0;
+            QTimer::singleShot(response.delayMs, socket, [this, socket, request, later]() {
+                respond(socket, request, later);
+            });
+            return;
+        }
+        
+        QByteArray head = "HTTP/1.1 " + QByteArray::number(response.status) + " Status\r\n";
+        for (auto it = response.headers.constBegin(); it != response.headers.constEnd(); ++it) {
+            head += it.key() + ": " + it.value() + "\r\n";
+        }
+        
+        if (response.eventStream) {
+            head += "Content-Type: text/event-stream\r\nCache-Control: no-cache\r\nConnection: close\r\n\r\n";
+            socket->write(head + response.body);
+            socket->flush();
+            m_streams.insert(socket);
+            return;
+        }
+        
+        // HEAD and 304 answers carry no body
+        bool bodyless = request.method == "HEAD" || response.status == 304;
+        head += "Content-Length: " + QByteArray::number(bodyless ? 0 : response.body.size()) + "\r\n";
+        head += "Connection: close\r\n\r\n";
+        
+        socket->write(bodyless ? head : head + response.body);
+        socket->disconnectFromHost();
+    }
+};
+
+/**
+ * @brief Payment object in the API's JSON format
+ */
+inline QJsonObject paymentJson(const QString& id, const QString& status, const QDateTime& updatedAt,
+                               qint64 version = 0, const QDateTime& expiresAt = QDateTime()) {
+    QJsonObject payment;
+    payment["id"] = id;
+    payment["merchant_id"] = "MERCHANT-TEST";
+    payment["amount"] = "25.00";
+    payment["currency"] = "MYR";
+    payment["crypto_amount"] = "0.00012000";
+    payment["crypto_currency"] = "BTC";
+    payment["status"] = status;
+    payment["created_at"] = updatedAt.toUTC().toString(Qt::ISODate);
+    payment["updated_at"] = updatedAt.toUTC().toString(Qt::ISODateWithMs);
+    payment["expires_at"] = (expiresAt.isValid() ? expiresAt : updatedAt.addSecs(30 * 60)).toUTC().toString(Qt::ISODate);
+    if (version > 0) {
+        payment["version"] = double(version);
+    }
+    return payment;
+}
+
+#endif // FAKE_API_SERVER_H
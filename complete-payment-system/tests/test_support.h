@@ -0,0 +1,99 @@
+/**
+ * Asian Cryptocurrency Payment System - Helpers shared by the SDK tests
+ */
+
+#ifndef TEST_SUPPORT_H
+#define TEST_SUPPORT_H
+
+#include <QEventLoop>
+#include <QMessageAuthenticationCode>
+#include <QTimer>
+
+#include "asian_crypto_payment.h"
+#include "fake_api_server.h"
+
+/**
+ * @brief Get an API key no other SDK instance in the test run uses
+ * 
+ * Rate budgets are shared per key, so a fresh key keeps them from carrying
+ * over between tests.
+ */
+inline QString uniqueApiKey() {
+    static int keys = 0;
+    return QString("test-key-%1").arg(++keys);
+}
+
+/**
+ * @brief Create an SDK instance that talks to a fake server
+ * 
+ * Warm connections and keep-alive pings are off, so the server only sees
+ * the requests a test triggers.
+ */
+inline AsianCryptoPay::AsianCryptoPayment* createTestSdk(const FakeApiServer& server, QObject* parent = nullptr,
+                                                         const QString& apiKey = uniqueApiKey()) {
+    auto* sdk = new AsianCryptoPay::AsianCryptoPayment(apiKey, "MERCHANT-TEST", AsianCryptoPay::CountryCode::Malaysia,
+                                                       parent);
+    sdk->setConnectionPoolPolicy(0, 0);
+    sdk->setApiEndpoint(server.url());
+    return sdk;
+}
+
+/**
+ * @brief Run the event loop until a signal is emitted
+ * 
+ * Unlike QTRY_VERIFY, which polls in steps of 50 ms, this returns as soon
+ * as the signal arrives, for tests that wait for many replies in turn.
+ * 
+ * @param sender Object emitting the signal
+ * @param signal Signal to wait for
+ * @param timeoutMs Time to wait at most in milliseconds
+ * @return Whether the signal was emitted in time
+ */
+template<class Sender, class Signal>
+inline bool waitForSignal(const Sender* sender, Signal signal, int timeoutMs = 5000) {
+    QEventLoop loop;
+    bool emitted = false;
+    
+    QObject::connect(sender, signal, &loop, [&loop, &emitted]() {
+        emitted = true;
+        loop.quit();
+    });
+    QTimer::singleShot(timeoutMs, &loop, &QEventLoop::quit);
+    
+    loop.exec();
+    return emitted;
+}
+
+/**
+ * @brief Payment details accepted by the Malaysian compliance module
+ */
+inline AsianCryptoPay::PaymentDetails testPaymentDetails() {
+    return AsianCryptoPay::PaymentDetails().setAmount(25.0).setCurrency("MYR").setCryptoCurrency("BTC");
+}
+
+/**
+ * @brief Sign a webhook event the way the API does
+ * @param event Webhook event
+ * @param secret Webhook secret
+ * @return Hex-encoded X-Webhook-Signature value
+ */
+inline QString signWebhook(const QJsonObject& event, const QString& secret) {
+    return QMessageAuthenticationCode::hash(QJsonDocument(event).toJson(QJsonDocument::Compact), secret.toUtf8(),
+                                            QCryptographicHash::Sha256).toHex();
+}
+
+/**
+ * @brief Build a payment event as delivered by webhooks and the push channel
+ */
+inline QJsonObject paymentEvent(const QString& type, const QJsonObject& payment, qint64 sequence = 0) {
+    QJsonObject event;
+    event["type"] = type;
+    event["event"] = type;
+    event["data"] = payment;
+    if (sequence > 0) {
+        event["sequence"] = double(sequence);
+    }
+    return event;
+}
+
+#endif // TEST_SUPPORT_H
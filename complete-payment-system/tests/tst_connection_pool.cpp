@@ -0,0 +1,55 @@
+/**
+ * Asian Cryptocurrency Payment System - Warm connection keep-alive tests
+ */
+
+#include <QtTest>
+
+#include "test_support.h"
+
+using namespace AsianCryptoPay;
+
+class TestConnectionPool : public QObject {
+    Q_OBJECT
+
+private slots:
+    void keepAlivePingsStopWhenIdle() {
+        FakeApiServer server;
+        QVERIFY(server.listen());
+        
+        std::unique_ptr<AsianCryptoPayment> sdk(createTestSdk(server));
+        sdk->setConnectionPoolPolicy(1, 100, 400);
+        
+        // Pings carry the usual API headers
+        QTRY_VERIFY(server.count("HEAD", QString()) >= 1);
+        QVERIFY(!server.requests("HEAD").first().headers.value("x-timestamp").isEmpty());
+        QCOMPARE(server.requests("HEAD").first().headers.value("x-merchant-id"), QByteArray("MERCHANT-TEST"));
+        
+        // Nobody used the SDK for the idle period: pinging stops...
+        QTest::qWait(800);
+        int pings = server.count("HEAD", QString());
+        QTest::qWait(500);
+        QCOMPARE(server.count("HEAD", QString()), pings);
+        QCOMPARE(sdk->statistics().keepAlivePings, quint64(pings));
+        
+        // ...until the next request
+        QDateTime now = QDateTime::currentDateTimeUtc();
+        server.enqueue("GET", "/payments/P1", FakeApiServer::json(200, paymentJson("P1", "pending", now)));
+        sdk->getPayment("P1");
+        QTRY_VERIFY(server.count("HEAD", QString()) > pings);
+    }
+    
+    void keepAliveCanBeDisabled() {
+        FakeApiServer server;
+        QVERIFY(server.listen());
+        
+        std::unique_ptr<AsianCryptoPayment> sdk(createTestSdk(server));
+        sdk->setConnectionPoolPolicy(1, 0);
+        
+        QTest::qWait(300);
+        QCOMPARE(server.count("HEAD", QString()), 0);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestConnectionPool)
+#include "tst_connection_pool.moc"
+#include "moc_asian_crypto_payment.cpp"
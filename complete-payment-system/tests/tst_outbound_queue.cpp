@@ -0,0 +1,174 @@
+/**
+ * Asian Cryptocurrency Payment System - Durable outbound queue tests
+ */
+
+#include <QtTest>
+#include <QTemporaryDir>
+
+#include "test_support.h"
+
+using namespace AsianCryptoPay;
+
+class TestOutboundQueue : public QObject {
+    Q_OBJECT
+
+private:
+    FakeApiServer* m_server = nullptr;
+    AsianCryptoPayment* m_sdk = nullptr;
+    QTemporaryDir* m_dir = nullptr;
+    QList<Payment> m_created;
+    
+    QString queuePath() const { return m_dir->filePath("outbound.jsonl"); }
+    
+    QList<QJsonObject> queueEntries() const {
+        QList<QJsonObject> entries;
+        QFile file(queuePath());
+        if (file.open(QIODevice::ReadOnly)) {
+            while (!file.atEnd()) {
+                QJsonObject entry = QJsonDocument::fromJson(file.readLine()).object();
+                if (!entry.isEmpty()) {
+                    entries.append(entry);
+                }
+            }
+        }
+        return entries;
+    }
+    
+    void writeQueue(const QList<QJsonObject>& entries) {
+        QFile file(queuePath());
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        for (const QJsonObject& entry : entries) {
+            file.write(QJsonDocument(entry).toJson(QJsonDocument::Compact) + "\n");
+        }
+    }
+
+private slots:
+    void init() {
+        m_dir = new QTemporaryDir;
+        QVERIFY(m_dir->isValid());
+        
+        m_server = new FakeApiServer(this);
+        QVERIFY(m_server->listen());
+        
+        m_sdk = createTestSdk(*m_server, this);
+        m_created.clear();
+        
+        connect(m_sdk, &AsianCryptoPayment::paymentCreated, this, [this](const Payment& payment) {
+            m_created.append(payment);
+        });
+    }
+    
+    void cleanup() {
+        delete m_sdk;
+        delete m_server;
+        delete m_dir;
+    }
+    
+    void storesOperationTypeByName() {
+        m_server->setRoute("POST", "/payments", FakeApiServer::delayed(FakeApiServer::raw(503), 60000));
+        m_sdk->setOutboundQueuePath(queuePath());
+        
+        m_sdk->createPayment(testPaymentDetails());
+        
+        QList<QJsonObject> entries = queueEntries();
+        QCOMPARE(entries.size(), 1);
+        QCOMPARE(entries.first()["type"].toString(), QString("create_payment"));
+        QCOMPARE(entries.first()["method"].toString(), QString("POST"));
+        QVERIFY(!entries.first()["idempotency_key"].toString().isEmpty());
+    }
+    
+    void resendsRestoredOperations() {
+        QJsonObject body = testPaymentDetails().toJson();
+        body["merchant_id"] = "MERCHANT-TEST";
+        
+        QJsonObject create;
+        create["type"] = "create_payment";
+        create["key"] = "restored-key";
+        create["endpoint"] = "payments";
+        create["method"] = "POST";
+        create["body"] = QString::fromUtf8(QJsonDocument(body).toJson(QJsonDocument::Compact));
+        create["idempotency_key"] = "restored-key";
+        create["queued_at"] = double(QDateTime::currentMSecsSinceEpoch());
+        
+        // An operation this version does not know is skipped
+        QJsonObject unknown = create;
+        unknown["type"] = "refund_payment";
+        unknown["key"] = "other-key";
+        
+        writeQueue(QList<QJsonObject>() << unknown << create);
+        
+        QDateTime now = QDateTime::currentDateTimeUtc();
+        m_server->enqueue("POST", "/payments", FakeApiServer::json(201, paymentJson("P1", "created", now)));
+        QTest::ignoreMessage(QtWarningMsg, QRegularExpression("Skipping unknown outbound operation"));
+        m_sdk->setOutboundQueuePath(queuePath());
+        QCOMPARE(m_sdk->outboundQueueDepth(), 1);
+        
+        QTRY_COMPARE(m_created.size(), 1);
+        QList<FakeApiServer::Request> sent = m_server->requests("POST", "/payments");
+        QCOMPARE(sent.size(), 1);
+        QCOMPARE(sent.first().headers.value("idempotency-key"), QByteArray("restored-key"));
+        
+        // Answered operations leave the file
+        QCOMPARE(m_sdk->outboundQueueDepth(), 0);
+        QVERIFY(queueEntries().isEmpty());
+    }
+    
+    void restoredOperationsRunInInteractiveLane() {
+        QJsonObject body = testPaymentDetails().toJson();
+        body["merchant_id"] = "MERCHANT-TEST";
+        
+        // Enough operations for the lane to report a latency
+        QList<QJsonObject> entries;
+        QDateTime now = QDateTime::currentDateTimeUtc();
+        for (int i = 0; i < 20; ++i) {
+            QJsonObject create;
+            create["type"] = "create_payment";
+            create["key"] = QString("restored-%1").arg(i);
+            create["endpoint"] = "payments";
+            create["method"] = "POST";
+            create["body"] = QString::fromUtf8(QJsonDocument(body).toJson(QJsonDocument::Compact));
+            create["idempotency_key"] = QString("restored-%1").arg(i);
+            create["queued_at"] = double(QDateTime::currentMSecsSinceEpoch());
+            entries.append(create);
+            
+            QString id = QString("P%1").arg(i);
+            m_server->enqueue("POST", "/payments", FakeApiServer::json(201, paymentJson(id, "created", now)));
+        }
+        writeQueue(entries);
+        
+        m_sdk->setOutboundQueuePath(queuePath());
+        QTRY_COMPARE(m_created.size(), 20);
+        
+        // Latency counts from the restore, not from the epoch
+        int latency = m_sdk->laneLatency(RequestPriority::Interactive, 1.0);
+        QVERIFY(latency >= 0 && latency < 60000);
+    }
+    
+    void keepsQueueWhileOperationsPending() {
+        m_server->setRoute("POST", "/payments", FakeApiServer::delayed(FakeApiServer::raw(503), 60000));
+        m_sdk->setOutboundQueuePath(queuePath());
+        m_sdk->createPayment(testPaymentDetails());
+        
+        QTest::ignoreMessage(QtWarningMsg, QRegularExpression("Outbound queue still holds"));
+        m_sdk->setOutboundQueuePath(QString());
+        
+        QCOMPARE(m_sdk->outboundQueueDepth(), 1);
+        QCOMPARE(queueEntries().size(), 1);
+    }
+    
+    void detachesEmptyQueue() {
+        m_sdk->setOutboundQueuePath(queuePath());
+        m_sdk->setOutboundQueuePath(QString());
+        
+        // Operations are no longer written anywhere
+        QDateTime now = QDateTime::currentDateTimeUtc();
+        m_server->enqueue("POST", "/payments", FakeApiServer::json(201, paymentJson("P1", "created", now)));
+        m_sdk->createPayment(testPaymentDetails());
+        QCOMPARE(m_sdk->outboundQueueDepth(), 0);
+        QTRY_COMPARE(m_created.size(), 1);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestOutboundQueue)
+#include "tst_outbound_queue.moc"
+#include "moc_asian_crypto_payment.cpp"
@@ -0,0 +1,179 @@
+/**
+ * Asian Cryptocurrency Payment System - Payment history walk and sync tests
+ */
+
+#include <QtTest>
+
+#include "test_support.h"
+
+using namespace AsianCryptoPay;
+
+class TestPaymentHistory : public QObject {
+    Q_OBJECT
+
+private:
+    FakeApiServer* m_server = nullptr;
+    AsianCryptoPayment* m_sdk = nullptr;
+    QList<int> m_errors;
+    
+    /**
+     * @brief A 200 reply whose body is cut off mid-document
+     */
+    static FakeApiServer::Response truncatedPage() {
+        FakeApiServer::Response response = FakeApiServer::raw(200, "{\"payments\": [{\"id\": \"P1\"");
+        response.headers["Content-Type"] = "application/json";
+        return response;
+    }
+    
+    /**
+     * @brief A last page holding the given payments
+     */
+    static QJsonObject lastPage(const QList<QJsonObject>& payments) {
+        QJsonArray array;
+        for (const QJsonObject& payment : payments) {
+            array.append(payment);
+        }
+        
+        QJsonObject page;
+        page["payments"] = array;
+        page["total"] = array.size();
+        page["has_more"] = false;
+        return page;
+    }
+
+private slots:
+    void initTestCase() {
+        QCoreApplication::setOrganizationName("AsianCryptoPayTests");
+    }
+    
+    void init() {
+        m_server = new FakeApiServer(this);
+        QVERIFY(m_server->listen());
+        
+        m_sdk = createTestSdk(*m_server, this);
+        m_sdk->resetPaymentSync();
+        m_errors.clear();
+        
+        connect(m_sdk, &AsianCryptoPayment::error, this, [this](int errorCode, const QString&) {
+            m_errors.append(errorCode);
+        });
+    }
+    
+    void cleanup() {
+        delete m_sdk;
+        delete m_server;
+    }
+    
+    void unreadablePageEndsHistoryWalk() {
+        m_server->setRoute("GET", "/payments", truncatedPage());
+        
+        int finished = 0;
+        connect(m_sdk, &AsianCryptoPayment::paymentHistoryFinished, this, [&finished](quint64, int) {
+            ++finished;
+        });
+        
+        RequestHandle handle = m_sdk->streamPaymentHistory(PaymentFilters().setLimit(10), 2);
+        QTRY_COMPARE(m_errors, QList<int>() << 500);
+        
+        // The walk is gone and its other page request with it
+        QVERIFY(!handle.cancel());
+        QTest::qWait(200);
+        QCOMPARE(m_errors.size(), 1);
+        QCOMPARE(finished, 0);
+        QCOMPARE(m_sdk->statistics().requestsSucceeded, quint64(0));
+        QCOMPARE(m_sdk->statistics().requestsFailed, quint64(1));
+    }
+    
+    void slowPageHoldsBackLaterPages() {
+        QDateTime now = QDateTime::currentDateTimeUtc();
+        QJsonObject page = lastPage({paymentJson("P1", "paid", now)});
+        page["has_more"] = true;
+        
+        // One page takes a while; the others come back at once
+        m_server->enqueue("GET", "/payments", FakeApiServer::delayed(FakeApiServer::json(200, page), 1000));
+        m_server->setRoute("GET", "/payments", FakeApiServer::json(200, page));
+        
+        RequestHandle handle = m_sdk->streamPaymentHistory(PaymentFilters().setLimit(10), 2);
+        QTest::qWait(500);
+        
+        // Only pages within two of the slow one are fetched meanwhile
+        QVERIFY(m_server->count("GET", "/payments") <= 3);
+        QVERIFY(handle.cancel());
+        QVERIFY(m_errors.isEmpty());
+    }
+    
+    void unreadablePageEndsSync() {
+        m_server->setRoute("GET", "/payments", truncatedPage());
+        
+        QList<int> finished;
+        connect(m_sdk, &AsianCryptoPayment::paymentSyncFinished, this, [&finished](int count) {
+            finished.append(count);
+        });
+        
+        RequestHandle first = m_sdk->syncPayments();
+        QTRY_COMPARE(m_errors, QList<int>() << 500);
+        
+        // The next sync starts afresh instead of joining the failed one
+        QDateTime now = QDateTime::currentDateTimeUtc();
+        m_server->setRoute("GET", "/payments", FakeApiServer::json(200, lastPage({paymentJson("P1", "paid", now)})));
+        
+        RequestHandle second = m_sdk->syncPayments();
+        QVERIFY(second.requestId() != first.requestId());
+        QTRY_COMPARE(finished, QList<int>() << 1);
+    }
+    
+    void syncMarkKeepsMilliseconds() {
+        QDateTime updatedAt = QDateTime::fromMSecsSinceEpoch(1767225600123, Qt::UTC);
+        m_server->setRoute("GET", "/payments",
+                           FakeApiServer::json(200, lastPage({paymentJson("P1", "paid", updatedAt)})));
+        
+        m_sdk->syncPayments();
+        QVERIFY(waitForSignal(m_sdk, &AsianCryptoPayment::paymentSyncFinished));
+        
+        // A restarted SDK reads the mark back exactly...
+        std::unique_ptr<AsianCryptoPayment> restarted(createTestSdk(*m_server));
+        QCOMPARE(restarted->paymentSyncMark(), updatedAt);
+        
+        // ...and asks for changes from that very millisecond
+        restarted->syncPayments();
+        QVERIFY(waitForSignal(restarted.get(), &AsianCryptoPayment::paymentSyncFinished));
+        QUrlQuery query = m_server->requests("GET", "/payments").last().query;
+        QCOMPARE(QDateTime::fromString(query.queryItemValue("updated_since", QUrl::FullyDecoded), Qt::ISODateWithMs),
+                 updatedAt);
+        QCOMPARE(query.queryItemValue("after_id"), QString("P1"));
+    }
+    
+    void syncMarkIsKeptPerMode() {
+        // Both modes start without a mark
+        bool mode = m_sdk->testMode();
+        m_sdk->setTestMode(!mode);
+        m_sdk->resetPaymentSync();
+        m_sdk->setTestMode(mode);
+        
+        QDateTime updatedAt = QDateTime::fromMSecsSinceEpoch(1767225600123, Qt::UTC);
+        m_server->setRoute("GET", "/payments",
+                           FakeApiServer::json(200, lastPage({paymentJson("P1", "paid", updatedAt)})));
+        m_sdk->syncPayments();
+        QVERIFY(waitForSignal(m_sdk, &AsianCryptoPayment::paymentSyncFinished));
+        
+        // The other mode starts from its own mark...
+        m_sdk->setTestMode(!mode);
+        QCOMPARE(m_sdk->paymentSyncMark(), QDateTime());
+        
+        // ...and the mode stays put while a sync runs
+        m_server->setRoute("GET", "/payments",
+                           FakeApiServer::delayed(FakeApiServer::json(200, lastPage({})), 500));
+        m_sdk->syncPayments();
+        QTest::ignoreMessage(QtWarningMsg, QRegularExpression("Payment sync running"));
+        m_sdk->setTestMode(mode);
+        QCOMPARE(m_sdk->testMode(), !mode);
+        QVERIFY(waitForSignal(m_sdk, &AsianCryptoPayment::paymentSyncFinished));
+        
+        m_sdk->setTestMode(mode);
+        QCOMPARE(m_sdk->paymentSyncMark(), updatedAt);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestPaymentHistory)
+#include "tst_payment_history.moc"
+#include "moc_asian_crypto_payment.cpp"
@@ -0,0 +1,137 @@
+/**
+ * Asian Cryptocurrency Payment System - PaymentListStreamParser tests
+ */
+
+#include <QtTest>
+
+#include "asian_crypto_payment.h"
+
+using namespace AsianCryptoPay;
+
+class TestPaymentListStreamParser : public QObject {
+    Q_OBJECT
+
+private:
+    static QByteArray page() {
+        return "{\"total\":3,\"payments\":["
+               "{\"id\":\"P1\",\"status\":\"pending\"},"
+               "{\"id\":\"P2\",\"description\":\"brace } bracket ] quote \\\" done\",\"metadata\":{\"payments\":[1,2]}},"
+               "{\"id\":\"P3\",\"metadata\":{\"nested\":{\"deep\":[{\"x\":1}]}}}"
+               "],\"has_more\":false}";
+    }
+    
+    static QStringList ids(const QList<QJsonObject>& elements) {
+        QStringList result;
+        for (const QJsonObject& element : elements) {
+            result.append(element["id"].toString());
+        }
+        return result;
+    }
+
+private slots:
+    void decodesWholePage() {
+        PaymentListStreamParser parser;
+        QVERIFY(!parser.hasStarted());
+        
+        parser.feed(page());
+        QVERIFY(parser.hasStarted());
+        QList<QJsonObject> elements = parser.takeElements();
+        QCOMPARE(ids(elements), QStringList() << "P1" << "P2" << "P3");
+        QCOMPARE(elements[1]["description"].toString(), QString("brace } bracket ] quote \" done"));
+        QCOMPARE(elements[1]["metadata"].toObject()["payments"].toArray().size(), 2);
+        
+        // The envelope keeps every other field, with the array emptied
+        QJsonObject envelope;
+        QVERIFY(parser.finish(envelope));
+        QCOMPARE(envelope["total"].toInt(), 3);
+        QCOMPARE(envelope["has_more"].toBool(), false);
+        QVERIFY(envelope["payments"].isArray());
+        QCOMPARE(envelope["payments"].toArray().size(), 0);
+    }
+    
+    void decodesBytewiseFeeds() {
+        PaymentListStreamParser parser;
+        QByteArray data = page();
+        int firstElementEnd = data.indexOf("},{\"id\":\"P2\"");
+        QStringList seen;
+        
+        // Elements come out as soon as their closing brace arrives
+        for (int i = 0; i < data.size(); ++i) {
+            parser.feed(data.mid(i, 1));
+            seen += ids(parser.takeElements());
+            
+            if (i == firstElementEnd - 1) {
+                QVERIFY(seen.isEmpty());
+            } else if (i == firstElementEnd) {
+                QCOMPARE(seen, QStringList() << "P1");
+            }
+        }
+        
+        QCOMPARE(seen, QStringList() << "P1" << "P2" << "P3");
+        
+        QJsonObject envelope;
+        QVERIFY(parser.finish(envelope));
+        QCOMPARE(envelope["total"].toInt(), 3);
+    }
+    
+    void takesElementsOnce() {
+        PaymentListStreamParser parser;
+        parser.feed(page());
+        
+        QCOMPARE(parser.takeElements().size(), 3);
+        QCOMPARE(parser.takeElements().size(), 0);
+    }
+    
+    void ignoresPaymentsKeyOutsideEnvelope() {
+        PaymentListStreamParser parser;
+        parser.feed("{\"meta\":{\"payments\":[{\"id\":\"X\"}]},\"payments\":[{\"id\":\"P1\"}]}");
+        
+        QCOMPARE(ids(parser.takeElements()), QStringList() << "P1");
+        
+        QJsonObject envelope;
+        QVERIFY(parser.finish(envelope));
+        QCOMPARE(envelope["meta"].toObject()["payments"].toArray().size(), 1);
+    }
+    
+    void handlesEmptyPage() {
+        PaymentListStreamParser parser;
+        parser.feed("{\"payments\":[],\"total\":0}");
+        
+        QVERIFY(parser.takeElements().isEmpty());
+        
+        QJsonObject envelope;
+        QVERIFY(parser.finish(envelope));
+        QCOMPARE(envelope["total"].toInt(), 0);
+    }
+    
+    void rejectsTruncatedReply() {
+        PaymentListStreamParser parser;
+        QByteArray data = page();
+        parser.feed(data.left(data.size() - 20));
+        
+        QJsonObject envelope;
+        QVERIFY(!parser.finish(envelope));
+    }
+    
+    void rejectsMalformedElement() {
+        PaymentListStreamParser parser;
+        parser.feed("{\"payments\":[{\"id\":\"P1\",}],\"total\":1}");
+        
+        QVERIFY(parser.takeElements().isEmpty());
+        
+        QJsonObject envelope;
+        QVERIFY(!parser.finish(envelope));
+    }
+    
+    void rejectsNonJson() {
+        PaymentListStreamParser parser;
+        parser.feed("<html>Bad Gateway</html>");
+        
+        QJsonObject envelope;
+        QVERIFY(!parser.finish(envelope));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestPaymentListStreamParser)
+#include "tst_payment_list_stream_parser.moc"
+#include "moc_asian_crypto_payment.cpp"
@@ -0,0 +1,122 @@
+/**
+ * Asian Cryptocurrency Payment System - Out-of-order update tests
+ */
+
+#include <QtTest>
+
+#include "test_support.h"
+
+using namespace AsianCryptoPay;
+
+class TestPaymentRevisions : public QObject {
+    Q_OBJECT
+
+private:
+    FakeApiServer* m_server = nullptr;
+    AsianCryptoPayment* m_sdk = nullptr;
+    QList<Payment> m_updates;
+    QDateTime m_now;
+    
+    /**
+     * @brief Deliver a signed payment.updated webhook
+     */
+    bool deliver(const QString& paymentId, qint64 version) {
+        QJsonObject event = paymentEvent("payment.updated", paymentJson(paymentId, "pending", m_now, version));
+        return m_sdk->processWebhookEvent(event, signWebhook(event, "webhook-secret"));
+    }
+    
+    /**
+     * @brief A batched status check reply holding one payment
+     */
+    static QJsonObject checkReply(const QJsonObject& payment) {
+        QJsonObject reply;
+        reply["payments"] = QJsonArray{payment};
+        reply["total"] = 1;
+        return reply;
+    }
+
+private slots:
+    void init() {
+        m_server = new FakeApiServer(this);
+        QVERIFY(m_server->listen());
+        
+        m_sdk = createTestSdk(*m_server, this);
+        m_sdk->setWebhookConfig("https://kiosk.example/webhooks", "webhook-secret");
+        m_updates.clear();
+        m_now = QDateTime::currentDateTimeUtc();
+        
+        connect(m_sdk, &AsianCryptoPayment::paymentStatusUpdated, this, [this](const Payment& payment) {
+            m_updates.append(payment);
+        });
+    }
+    
+    void cleanup() {
+        delete m_sdk;
+        delete m_server;
+    }
+    
+    void dropsStaleAndDuplicateUpdates() {
+        QVERIFY(deliver("P1", 2));
+        QVERIFY(deliver("P1", 1));
+        QVERIFY(deliver("P1", 2));
+        QVERIFY(deliver("P1", 3));
+        
+        QCOMPARE(m_updates.size(), 2);
+        QCOMPARE(m_updates.last().version(), qint64(3));
+        QCOMPARE(m_sdk->statistics().staleUpdates, quint64(1));
+        QCOMPARE(m_sdk->statistics().duplicateUpdates, quint64(1));
+    }
+    
+    void forgetsLeastRecentlySeenPaymentFirst() {
+        // Fill the 1024 remembered revisions, then see P0 again
+        for (int i = 0; i < 1024; ++i) {
+            QVERIFY(deliver(QString("P%1").arg(i), 2));
+        }
+        QVERIFY(deliver("P0", 2));
+        QCOMPARE(m_sdk->statistics().duplicateUpdates, quint64(1));
+        
+        // A new payment makes room by forgetting P1, not P0
+        QVERIFY(deliver("NEW", 2));
+        QVERIFY(deliver("P0", 1));
+        QCOMPARE(m_sdk->statistics().staleUpdates, quint64(1));
+        
+        QVERIFY(deliver("P1", 1));
+        QCOMPARE(m_updates.size(), 1026);
+        QCOMPARE(m_updates.last().id(), QString("P1"));
+    }
+    
+    void cancelledPaymentStaysCancelled() {
+        m_sdk->setPollingPolicy(PollingPolicy(50, 50, 1.0, 0));
+        
+        // Checks answer slowly, with the state from before the cancellation
+        m_server->setRoute("GET", "/payments", FakeApiServer::delayed(
+                FakeApiServer::json(200, checkReply(paymentJson("P1", "pending", m_now, 1))), 500));
+        m_server->setRoute("POST", "/payments/P1/cancel",
+                           FakeApiServer::json(200, paymentJson("P1", "cancelled", m_now, 2)));
+        m_server->enqueue("POST", "/payments", FakeApiServer::json(201, paymentJson("P1", "created", m_now, 1)));
+        
+        int cancelled = 0;
+        connect(m_sdk, &AsianCryptoPayment::paymentCancelled, this, [&cancelled](const Payment&) {
+            ++cancelled;
+        });
+        
+        m_sdk->createPayment(testPaymentDetails());
+        QTRY_VERIFY(m_server->count("GET", "/payments") >= 1);
+        m_sdk->cancelPayment("P1");
+        QTRY_COMPARE(cancelled, 1);
+        
+        // The late check does not undo the cancellation...
+        QTest::qWait(600);
+        QVERIFY(m_sdk->statistics().staleUpdates >= 1);
+        
+        // ...and its webhook is not reported a second time
+        QJsonObject event = paymentEvent("payment.cancelled", paymentJson("P1", "cancelled", m_now, 2));
+        QVERIFY(m_sdk->processWebhookEvent(event, signWebhook(event, "webhook-secret")));
+        QCOMPARE(m_sdk->statistics().duplicateUpdates, quint64(1));
+        QVERIFY(m_updates.isEmpty());
+    }
+};
+
+QTEST_GUILESS_MAIN(TestPaymentRevisions)
+#include "tst_payment_revisions.moc"
+#include "moc_asian_crypto_payment.cpp"
@@ -0,0 +1,91 @@
+/**
+ * Asian Cryptocurrency Payment System - Push channel and webhook event tests
+ */
+
+#include <QtTest>
+
+#include "test_support.h"
+
+using namespace AsianCryptoPay;
+
+class TestPushEvents : public QObject {
+    Q_OBJECT
+
+private:
+    FakeApiServer* m_server = nullptr;
+    AsianCryptoPayment* m_sdk = nullptr;
+    QList<Payment> m_updates;
+    
+    /**
+     * @brief Write an event to the open event streams
+     */
+    void pushEvent(const QJsonObject& event) {
+        m_server->sendEvent("data: " + QJsonDocument(event).toJson(QJsonDocument::Compact) + "\n\n");
+    }
+
+private slots:
+    void init() {
+        m_server = new FakeApiServer(this);
+        QVERIFY(m_server->listen());
+        
+        FakeApiServer::Response stream;
+        stream.eventStream = true;
+        m_server->setRoute("GET", "/events", stream);
+        
+        // Checks are left to the push channel
+        m_sdk = createTestSdk(*m_server, this);
+        m_sdk->setPollingPolicy(PollingPolicy(60000, 60000, 1.0, 0));
+        m_updates.clear();
+        
+        connect(m_sdk, &AsianCryptoPayment::paymentStatusUpdated, this, [this](const Payment& payment) {
+            m_updates.append(payment);
+        });
+    }
+    
+    void cleanup() {
+        delete m_sdk;
+        delete m_server;
+    }
+    
+    void pushEventsOnlyUpdateTrackedPayments() {
+        QDateTime now = QDateTime::currentDateTimeUtc();
+        m_server->enqueue("POST", "/payments", FakeApiServer::json(201, paymentJson("P1", "created", now, 1)));
+        
+        int created = 0;
+        connect(m_sdk, &AsianCryptoPayment::paymentCreated, this, [&created](const Payment&) {
+            ++created;
+        });
+        m_sdk->createPayment(testPaymentDetails());
+        QTRY_COMPARE(created, 1);
+        
+        m_sdk->setPushEndpoint(m_server->url() + "/events");
+        QTRY_COMPARE(m_server->streamCount(), 1);
+        
+        // A payment this kiosk never asked about is not taken from the stream
+        pushEvent(paymentEvent("payment.completed", paymentJson("P9", "completed", now, 5), 1));
+        pushEvent(paymentEvent("payment.completed", paymentJson("P1", "completed", now, 2), 2));
+        
+        QTRY_COMPARE(m_updates.size(), 1);
+        QCOMPARE(m_updates.first().id(), QString("P1"));
+        QCOMPARE(m_sdk->statistics().pushEvents, quint64(2));
+    }
+    
+    void signedWebhooksReportUntrackedPayments() {
+        m_sdk->setWebhookConfig("https://kiosk.example/webhooks", "webhook-secret");
+        
+        QDateTime now = QDateTime::currentDateTimeUtc();
+        QJsonObject event = paymentEvent("payment.completed", paymentJson("P9", "completed", now, 5));
+        
+        QTest::ignoreMessage(QtWarningMsg, "Invalid webhook signature");
+        QVERIFY(!m_sdk->processWebhookEvent(event, signWebhook(event, "other-secret")));
+        QVERIFY(m_updates.isEmpty());
+        
+        QVERIFY(m_sdk->processWebhookEvent(event, signWebhook(event, "webhook-secret")));
+        QCOMPARE(m_updates.size(), 1);
+        QCOMPARE(m_updates.first().id(), QString("P9"));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestPushEvents)
+#include "tst_push_events.moc"
+#include "moc_asian_crypto_payment.cpp"
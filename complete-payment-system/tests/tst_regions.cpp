@@ -0,0 +1,65 @@
+/**
+ * Asian Cryptocurrency Payment System - Regional endpoint failover tests
+ */
+
+#include <QtTest>
+
+#include "test_support.h"
+
+using namespace AsianCryptoPay;
+
+class TestRegions : public QObject {
+    Q_OBJECT
+
+private slots:
+    void probesAloneDoNotRestoreFailedRegion() {
+        FakeApiServer first;
+        FakeApiServer second;
+        QVERIFY(first.listen());
+        QVERIFY(second.listen());
+        
+        // The first region answers probes quickly, so it is preferred
+        second.setRoute("HEAD", "/", FakeApiServer::delayed(FakeApiServer::raw(200), 100));
+        
+        std::unique_ptr<AsianCryptoPayment> sdk(createTestSdk(first));
+        sdk->setRetryPolicy(AsianCryptoPayment::RequestType::GetPayment, RetryPolicy(3, 100, 100, 0));
+        sdk->setApiEndpoints(QStringList() << first.url() << second.url(), 1000);
+        
+        QStringList changes;
+        connect(sdk.get(), &AsianCryptoPayment::apiEndpointChanged, this, [&changes](const QString& endpoint) {
+            changes.append(endpoint);
+        });
+        QList<Payment> retrieved;
+        connect(sdk.get(), &AsianCryptoPayment::paymentRetrieved, this, [&retrieved](const Payment& payment) {
+            retrieved.append(payment);
+        });
+        QTRY_VERIFY(first.count("HEAD", "/") >= 1 && second.count("HEAD", "/") >= 1);
+        
+        // Requests fail on the first region and move to the second
+        QDateTime now = QDateTime::currentDateTimeUtc();
+        first.setRoute("GET", "/payments/P1", FakeApiServer::raw(503));
+        second.setRoute("GET", "/payments/P1", FakeApiServer::json(200, paymentJson("P1", "pending", now)));
+        sdk->getPayment("P1");
+        QTRY_COMPARE(retrieved.size(), 1);
+        QCOMPARE(changes, QStringList() << second.url());
+        
+        // One good probe of the first region is not enough to go back to it...
+        int probes = first.count("HEAD", "/");
+        QTRY_VERIFY_WITH_TIMEOUT(first.count("HEAD", "/") > probes, 3000);
+        QTest::qWait(100);
+        
+        second.setRoute("GET", "/payments/P2", FakeApiServer::raw(503));
+        sdk->getPayment("P2");
+        QTRY_VERIFY(second.count("GET", "/payments/P2") >= 2);
+        QTest::qWait(100);
+        QCOMPARE(changes, QStringList() << second.url());
+        QCOMPARE(first.count("GET", "/payments/P2"), 0);
+        
+        // ...a run of them is
+        QTRY_COMPARE_WITH_TIMEOUT(changes, QStringList() << second.url() << first.url(), 5000);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestRegions)
+#include "tst_regions.moc"
+#include "moc_asian_crypto_payment.cpp"
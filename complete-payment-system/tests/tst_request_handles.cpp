@@ -0,0 +1,145 @@
+/**
+ * Asian Cryptocurrency Payment System - Cancellation and deadline tests
+ */
+
+#include <QtTest>
+
+#include "test_support.h"
+
+using namespace AsianCryptoPay;
+
+class TestRequestHandles : public QObject {
+    Q_OBJECT
+
+private:
+    FakeApiServer* m_server = nullptr;
+    AsianCryptoPayment* m_sdk = nullptr;
+    QList<Payment> m_retrieved;
+    QList<int> m_errors;
+    
+    /**
+     * @brief Answer GET /payments/P1 after a delay
+     */
+    void delayPayment(int delayMs) {
+        QDateTime now = QDateTime::currentDateTimeUtc();
+        m_server->setRoute("GET", "/payments/P1",
+                           FakeApiServer::delayed(FakeApiServer::json(200, paymentJson("P1", "pending", now)), delayMs));
+    }
+
+private slots:
+    void init() {
+        m_server = new FakeApiServer(this);
+        QVERIFY(m_server->listen());
+        
+        m_sdk = createTestSdk(*m_server, this);
+        m_retrieved.clear();
+        m_errors.clear();
+        
+        connect(m_sdk, &AsianCryptoPayment::paymentRetrieved, this, [this](const Payment& payment) {
+            m_retrieved.append(payment);
+        });
+        connect(m_sdk, &AsianCryptoPayment::error, this, [this](int errorCode, const QString&) {
+            m_errors.append(errorCode);
+        });
+    }
+    
+    void cleanup() {
+        delete m_sdk;
+        delete m_server;
+    }
+    
+    void cancelAbortsRequest() {
+        delayPayment(500);
+        
+        RequestHandle handle = m_sdk->getPayment("P1");
+        QVERIFY(handle.isValid());
+        QVERIFY(handle.cancel());
+        QVERIFY(!handle.cancel());
+        
+        QTest::qWait(800);
+        QVERIFY(m_retrieved.isEmpty());
+        QVERIFY(m_errors.isEmpty());
+        QCOMPARE(m_sdk->statistics().requestsCancelled, quint64(1));
+    }
+    
+    void attachedCallersShareOneRequest() {
+        delayPayment(300);
+        
+        RequestHandle first = m_sdk->getPayment("P1");
+        RequestHandle second = m_sdk->getPayment("P1");
+        QVERIFY(second.isValid());
+        QVERIFY(second.requestId() != first.requestId());
+        
+        QTRY_COMPARE(m_retrieved.size(), 1);
+        QCOMPARE(m_server->count("GET", "/payments/P1"), 1);
+        QCOMPARE(m_sdk->statistics().coalescedRequests, quint64(1));
+        
+        // Both callers are done once the reply is in
+        QVERIFY(!first.cancel());
+        QVERIFY(!second.cancel());
+    }
+    
+    void repeatedCancelDetachesOnce() {
+        delayPayment(300);
+        
+        RequestHandle first = m_sdk->getPayment("P1");
+        RequestHandle second = m_sdk->getPayment("P1");
+        RequestHandle third = m_sdk->getPayment("P1");
+        
+        QVERIFY(second.cancel());
+        QVERIFY(!second.cancel());
+        QVERIFY(first.cancel());
+        
+        // The third caller still waits, so the request goes on
+        QTRY_COMPARE(m_retrieved.size(), 1);
+        QCOMPARE(m_sdk->statistics().requestsCancelled, quint64(0));
+        QVERIFY(!third.cancel());
+    }
+    
+    void lastCallerToCancelAbortsRequest() {
+        delayPayment(500);
+        
+        RequestHandle first = m_sdk->getPayment("P1");
+        RequestHandle second = m_sdk->getPayment("P1");
+        
+        QVERIFY(first.cancel());
+        QVERIFY(second.cancel());
+        
+        QTest::qWait(800);
+        QVERIFY(m_retrieved.isEmpty());
+        QCOMPARE(m_sdk->statistics().requestsCancelled, quint64(1));
+    }
+    
+    void attachedCallerKeepsItsDeadline() {
+        delayPayment(1000);
+        
+        RequestHandle first = m_sdk->getPayment("P1");
+        RequestHandle second = m_sdk->getPayment("P1", RequestOptions().setTimeout(100));
+        
+        // Only the impatient caller gives up
+        QTRY_COMPARE(m_errors, QList<int>() << DeadlineExceededError);
+        QVERIFY(m_retrieved.isEmpty());
+        QVERIFY(!second.cancel());
+        
+        QTRY_COMPARE_WITH_TIMEOUT(m_retrieved.size(), 1, 3000);
+        QCOMPARE(m_sdk->statistics().deadlinesExceeded, quint64(1));
+        QCOMPARE(m_server->count("GET", "/payments/P1"), 1);
+        Q_UNUSED(first);
+    }
+    
+    void originalDeadlineSparesAttachedCallers() {
+        delayPayment(1000);
+        
+        RequestHandle first = m_sdk->getPayment("P1", RequestOptions().setTimeout(100));
+        RequestHandle second = m_sdk->getPayment("P1");
+        
+        QTRY_COMPARE(m_errors, QList<int>() << DeadlineExceededError);
+        QTRY_COMPARE_WITH_TIMEOUT(m_retrieved.size(), 1, 3000);
+        QVERIFY(!first.cancel());
+        Q_UNUSED(second);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestRequestHandles)
+#include "tst_request_handles.moc"
+#include "moc_asian_crypto_payment.cpp"
@@ -0,0 +1,283 @@
+/**
+ * Asian Cryptocurrency Payment System - Request signing, retry and caching tests
+ */
+
+#include <QtTest>
+
+#include "test_support.h"
+
+using namespace AsianCryptoPay;
+
+class TestRequestPipeline : public QObject {
+    Q_OBJECT
+
+private:
+    FakeApiServer* m_server = nullptr;
+    AsianCryptoPayment* m_sdk = nullptr;
+    QString m_apiKey;
+    QList<Payment> m_created;
+    QList<Payment> m_retrieved;
+    QList<int> m_errors;
+
+private slots:
+    void init() {
+        m_server = new FakeApiServer(this);
+        QVERIFY(m_server->listen());
+        
+        m_apiKey = uniqueApiKey();
+        m_sdk = createTestSdk(*m_server, this, m_apiKey);
+        m_created.clear();
+        m_retrieved.clear();
+        m_errors.clear();
+        
+        connect(m_sdk, &AsianCryptoPayment::paymentCreated, this, [this](const Payment& payment) {
+            m_created.append(payment);
+        });
+        connect(m_sdk, &AsianCryptoPayment::paymentRetrieved, this, [this](const Payment& payment) {
+            m_retrieved.append(payment);
+        });
+        connect(m_sdk, &AsianCryptoPayment::error, this, [this](int errorCode, const QString&) {
+            m_errors.append(errorCode);
+        });
+    }
+    
+    void cleanup() {
+        delete m_sdk;
+        delete m_server;
+    }
+    
+    void signsTheBytesSent() {
+        QDateTime now = QDateTime::currentDateTimeUtc();
+        m_server->enqueue("POST", "/payments", FakeApiServer::json(201, paymentJson("P1", "created", now)));
+        
+        m_sdk->createPayment(testPaymentDetails());
+        QTRY_COMPARE(m_created.size(), 1);
+        
+        QList<FakeApiServer::Request> sent = m_server->requests("POST", "/payments");
+        QCOMPARE(sent.size(), 1);
+        
+        // The signature covers the timestamp and the body exactly as sent
+        const FakeApiServer::Request& request = sent.first();
+        QByteArray expected = QMessageAuthenticationCode::hash(request.headers.value("x-timestamp") + "." + request.body,
+                                                               m_apiKey.toUtf8(), QCryptographicHash::Sha256).toHex();
+        QVERIFY(!request.headers.value("x-timestamp").isEmpty());
+        QCOMPARE(request.headers.value("x-signature"), expected);
+        QCOMPARE(QJsonDocument::fromJson(request.body).object()["merchant_id"].toString(), QString("MERCHANT-TEST"));
+    }
+    
+    void retriedPostKeepsIdempotencyKey() {
+        QDateTime now = QDateTime::currentDateTimeUtc();
+        m_server->enqueue("POST", "/payments", FakeApiServer::raw(503));
+        m_server->enqueue("POST", "/payments", FakeApiServer::json(201, paymentJson("P1", "created", now)));
+        m_sdk->setRetryPolicy(AsianCryptoPayment::RequestType::CreatePayment, RetryPolicy(3, 10, 10, 0.0));
+        
+        m_sdk->createPayment(testPaymentDetails());
+        QTRY_COMPARE(m_created.size(), 1);
+        
+        // The server can recognise the retry as the same payment
+        QList<FakeApiServer::Request> sent = m_server->requests("POST", "/payments");
+        QCOMPARE(sent.size(), 2);
+        QVERIFY(!sent[0].headers.value("idempotency-key").isEmpty());
+        QCOMPARE(sent[1].headers.value("idempotency-key"), sent[0].headers.value("idempotency-key"));
+        QCOMPARE(sent[1].body, sent[0].body);
+        
+        QCOMPARE(m_sdk->statistics().retries, quint64(1));
+        QVERIFY(m_errors.isEmpty());
+    }
+    
+    void separatePaymentsGetSeparateKeys() {
+        QDateTime now = QDateTime::currentDateTimeUtc();
+        m_server->enqueue("POST", "/payments", FakeApiServer::json(201, paymentJson("P1", "created", now)));
+        m_server->enqueue("POST", "/payments", FakeApiServer::json(201, paymentJson("P2", "created", now)));
+        
+        m_sdk->createPayment(testPaymentDetails());
+        m_sdk->createPayment(testPaymentDetails());
+        QTRY_COMPARE(m_created.size(), 2);
+        
+        QList<FakeApiServer::Request> sent = m_server->requests("POST", "/payments");
+        QCOMPARE(sent.size(), 2);
+        QVERIFY(sent[0].headers.value("idempotency-key") != sent[1].headers.value("idempotency-key"));
+    }
+    
+    void conditionalGetServesCachedBody() {
+        QDateTime now = QDateTime::currentDateTimeUtc();
+        QMap<QByteArray, QByteArray> headers;
+        headers["ETag"] = "\"v1\"";
+        m_server->enqueue("GET", "/payments/P1", FakeApiServer::json(200, paymentJson("P1", "pending", now), headers));
+        m_server->enqueue("GET", "/payments/P1", FakeApiServer::raw(304));
+        
+        m_sdk->getPayment("P1");
+        QTRY_COMPARE(m_retrieved.size(), 1);
+        QVERIFY(m_server->requests("GET", "/payments/P1").first().headers.value("if-none-match").isEmpty());
+        
+        // The second fetch revalidates and decodes nothing new
+        m_sdk->getPayment("P1");
+        QTRY_COMPARE(m_retrieved.size(), 2);
+        QCOMPARE(m_server->requests("GET", "/payments/P1").last().headers.value("if-none-match"), QByteArray("\"v1\""));
+        QCOMPARE(m_retrieved[1].id(), QString("P1"));
+        QCOMPARE(m_retrieved[1].status(), PaymentStatus::Pending);
+        
+        RequestStatistics statistics = m_sdk->statistics();
+        QCOMPARE(statistics.responseCacheMisses, quint64(1));
+        QCOMPARE(statistics.responseCacheHits, quint64(1));
+        QVERIFY(m_errors.isEmpty());
+    }
+    
+    void notModifiedWithoutCacheEntryRefetches() {
+        QDateTime now = QDateTime::currentDateTimeUtc();
+        QMap<QByteArray, QByteArray> headers;
+        headers["ETag"] = "\"v1\"";
+        m_server->enqueue("GET", "/payments/P1", FakeApiServer::json(200, paymentJson("P1", "pending", now), headers));
+        m_server->enqueue("GET", "/payments/P1", FakeApiServer::delayed(FakeApiServer::raw(304), 300));
+        m_server->enqueue("GET", "/payments/P1", FakeApiServer::json(200, paymentJson("P1", "completed", now), headers));
+        
+        m_sdk->getPayment("P1");
+        QTRY_COMPARE(m_retrieved.size(), 1);
+        
+        // The cache is cleared while the revalidation is in flight
+        m_sdk->getPayment("P1");
+        QTRY_COMPARE(m_server->count("GET", "/payments/P1"), 2);
+        m_sdk->setTestMode(false);
+        
+        QTRY_COMPARE(m_retrieved.size(), 2);
+        QCOMPARE(m_retrieved[1].status(), PaymentStatus::Completed);
+        
+        QList<FakeApiServer::Request> sent = m_server->requests("GET", "/payments/P1");
+        QCOMPARE(sent.size(), 3);
+        QCOMPARE(sent[1].headers.value("if-none-match"), QByteArray("\"v1\""));
+        QVERIFY(sent[2].headers.value("if-none-match").isEmpty());
+        QVERIFY(m_errors.isEmpty());
+    }
+    
+    void repeatedNotModifiedWithoutCacheEntryFails() {
+        m_server->setRoute("GET", "/payments/P1", FakeApiServer::raw(304));
+        
+        m_sdk->getPayment("P1");
+        QTRY_COMPARE(m_errors.size(), 1);
+        QCOMPARE(m_server->count("GET", "/payments/P1"), 2);
+        QVERIFY(m_retrieved.isEmpty());
+    }
+    
+    void cacheEvictsLeastRecentlyUsed() {
+        const int capacity = 256;
+        QDateTime now = QDateTime::currentDateTimeUtc();
+        
+        // A generous server-side limit keeps the token bucket out of the way
+        for (int i = 0; i <= capacity; ++i) {
+            QString id = QString("P%1").arg(i);
+            QMap<QByteArray, QByteArray> headers;
+            headers["ETag"] = "\"" + id.toUtf8() + "\"";
+            headers["X-RateLimit-Limit"] = "100000";
+            m_server->setRoute("GET", "/payments/" + id, FakeApiServer::json(200, paymentJson(id, "pending", now), headers));
+        }
+        
+        // One at a time, so the entries are used in a known order
+        for (int i = 0; i < capacity; ++i) {
+            m_sdk->getPayment(QString("P%1").arg(i));
+            QVERIFY(waitForSignal(m_sdk, &AsianCryptoPayment::paymentRetrieved));
+        }
+        
+        // P0 is used again, so P1 is now the least recently used entry
+        m_sdk->getPayment("P0");
+        QVERIFY(waitForSignal(m_sdk, &AsianCryptoPayment::paymentRetrieved));
+        m_sdk->getPayment(QString("P%1").arg(capacity));
+        QVERIFY(waitForSignal(m_sdk, &AsianCryptoPayment::paymentRetrieved));
+        QCOMPARE(m_retrieved.size(), capacity + 2);
+        
+        m_server->clearRequests();
+        m_sdk->getPayment("P0");
+        m_sdk->getPayment("P1");
+        QTRY_COMPARE(m_retrieved.size(), capacity + 4);
+        
+        QCOMPARE(m_server->requests("GET", "/payments/P0").first().headers.value("if-none-match"), QByteArray("\"P0\""));
+        QVERIFY(m_server->requests("GET", "/payments/P1").first().headers.value("if-none-match").isEmpty());
+    }
+    
+    void conditionalGetServesCachedPaymentPage() {
+        QDateTime now = QDateTime::currentDateTimeUtc();
+        QJsonObject page;
+        page["payments"] = QJsonArray{paymentJson("P1", "pending", now), paymentJson("P2", "completed", now)};
+        page["total"] = 2;
+        page["has_more"] = false;
+        
+        QMap<QByteArray, QByteArray> headers;
+        headers["ETag"] = "\"page1\"";
+        m_server->enqueue("GET", "/payments", FakeApiServer::json(200, page, headers));
+        m_server->enqueue("GET", "/payments", FakeApiServer::raw(304));
+        
+        QList<QList<Payment>> pages;
+        QList<Payment> streamed;
+        connect(m_sdk, &AsianCryptoPayment::paymentsRetrieved, this, [&pages](const QList<Payment>& payments, int) {
+            pages.append(payments);
+        });
+        connect(m_sdk, &AsianCryptoPayment::paymentStreamed, this, [&streamed](const Payment& payment) {
+            streamed.append(payment);
+        });
+        
+        m_sdk->getPayments();
+        QTRY_COMPARE(pages.size(), 1);
+        QCOMPARE(pages[0].size(), 2);
+        
+        // The page streamed in, yet its revalidation serves the same payments
+        m_sdk->getPayments();
+        QTRY_COMPARE(pages.size(), 2);
+        QCOMPARE(m_server->requests("GET", "/payments").last().headers.value("if-none-match"), QByteArray("\"page1\""));
+        QCOMPARE(pages[1].size(), 2);
+        QCOMPARE(pages[1][0].id(), QString("P1"));
+        QCOMPARE(pages[1][1].status(), PaymentStatus::Completed);
+        QCOMPARE(streamed.size(), 4);
+        
+        RequestStatistics statistics = m_sdk->statistics();
+        QCOMPARE(statistics.responseCacheMisses, quint64(1));
+        QCOMPARE(statistics.responseCacheHits, quint64(1));
+        QVERIFY(m_errors.isEmpty());
+    }
+    
+    void cancelLeavesHeadroomToCreatePayment() {
+        // The POST budget is down to the createPayment headroom
+        QMap<QByteArray, QByteArray> headers;
+        headers["X-RateLimit-Remaining"] = "5";
+        
+        QDateTime now = QDateTime::currentDateTimeUtc();
+        m_server->enqueue("POST", "/payments", FakeApiServer::json(201, paymentJson("P1", "created", now, 1), headers));
+        m_sdk->createPayment(testPaymentDetails());
+        QTRY_COMPARE(m_created.size(), 1);
+        
+        m_server->setRoute("POST", "/payments/P1/cancel",
+                           FakeApiServer::json(200, paymentJson("P1", "cancelled", now, 2)));
+        m_server->enqueue("POST", "/payments", FakeApiServer::json(201, paymentJson("P2", "created", now, 1), headers));
+        m_sdk->cancelPayment("P1");
+        m_sdk->createPayment(testPaymentDetails());
+        
+        // The checkout goes out; the cancel, though interactive, waits
+        QTRY_COMPARE(m_created.size(), 2);
+        QCOMPARE(m_server->count("POST", "/payments/P1/cancel"), 0);
+        QTRY_COMPARE_WITH_TIMEOUT(m_server->count("POST", "/payments/P1/cancel"), 1, 5000);
+    }
+    
+    void rateLimitedReplyHoldsQueuedRequests() {
+        m_sdk->setLaneConcurrency(RequestPriority::Normal, 1);
+        
+        FakeApiServer::Response limited = FakeApiServer::raw(429);
+        limited.headers["Retry-After"] = "1";
+        
+        QDateTime now = QDateTime::currentDateTimeUtc();
+        m_server->enqueue("GET", "/payments/P1", FakeApiServer::delayed(limited, 200));
+        m_server->setRoute("GET", "/payments/P1", FakeApiServer::json(200, paymentJson("P1", "pending", now)));
+        m_server->setRoute("GET", "/payments/P2", FakeApiServer::json(200, paymentJson("P2", "pending", now)));
+        m_sdk->getPayment("P1");
+        m_sdk->getPayment("P2");
+        
+        // P2 waits for the lane slot and then for the class to unblock
+        QTRY_COMPARE(m_server->count("GET", "/payments/P1"), 1);
+        QTest::qWait(400);
+        QCOMPARE(m_server->count("GET", "/payments/P2"), 0);
+        
+        QTRY_COMPARE_WITH_TIMEOUT(m_retrieved.size(), 2, 5000);
+        QVERIFY(m_errors.isEmpty());
+    }
+};
+
+QTEST_GUILESS_MAIN(TestRequestPipeline)
+#include "tst_request_pipeline.moc"
+#include "moc_asian_crypto_payment.cpp"
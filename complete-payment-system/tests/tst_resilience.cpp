@@ -0,0 +1,173 @@
+/**
+ * Asian Cryptocurrency Payment System - Circuit breaker and hedging tests
+ */
+
+#include <QtTest>
+
+#include "test_support.h"
+
+using namespace AsianCryptoPay;
+
+class TestResilience : public QObject {
+    Q_OBJECT
+
+private:
+    /**
+     * @brief Open a breaker that needs two replies to trust its ratio
+     */
+    static CircuitBreaker openBreaker(qint64 now) {
+        CircuitBreaker breaker(0.5, 2, 100);
+        breaker.recordFailure(now, now);
+        breaker.recordFailure(now, now);
+        return breaker;
+    }
+
+private slots:
+    void opensOnFailureRatio() {
+        CircuitBreaker breaker = openBreaker(1000);
+        QCOMPARE(breaker.state(), CircuitBreaker::State::Open);
+        QVERIFY(!breaker.allowRequest(1050));
+        
+        // After the cool-down one probe goes out
+        QVERIFY(breaker.allowRequest(1100));
+        QCOMPARE(breaker.state(), CircuitBreaker::State::HalfOpen);
+        QVERIFY(!breaker.allowRequest(1101));
+    }
+    
+    void probeSuccessCloses() {
+        CircuitBreaker breaker = openBreaker(1000);
+        QVERIFY(breaker.allowRequest(1100));
+        
+        breaker.recordSuccess(1100, 1120);
+        QCOMPARE(breaker.state(), CircuitBreaker::State::Closed);
+    }
+    
+    void probeFailureReopens() {
+        CircuitBreaker breaker = openBreaker(1000);
+        QVERIFY(breaker.allowRequest(1100));
+        
+        breaker.recordFailure(1100, 1120);
+        QCOMPARE(breaker.state(), CircuitBreaker::State::Open);
+        QVERIFY(!breaker.allowRequest(1150));
+    }
+    
+    void lateSuccessDoesNotCloseHalfOpenCircuit() {
+        CircuitBreaker breaker = openBreaker(1000);
+        QVERIFY(breaker.allowRequest(1100));
+        
+        // Sent before the circuit opened; says nothing about the endpoint now
+        breaker.recordSuccess(990, 1110);
+        QCOMPARE(breaker.state(), CircuitBreaker::State::HalfOpen);
+        
+        breaker.recordSuccess(1100, 1120);
+        QCOMPARE(breaker.state(), CircuitBreaker::State::Closed);
+    }
+    
+    void lateFailuresDoNotReopenClosedCircuit() {
+        CircuitBreaker breaker = openBreaker(1000);
+        QVERIFY(breaker.allowRequest(1100));
+        breaker.recordSuccess(1100, 1120);
+        
+        breaker.recordFailure(1010, 1130);
+        breaker.recordFailure(1010, 1130);
+        QCOMPARE(breaker.state(), CircuitBreaker::State::Closed);
+    }
+    
+    void rateLimitedHedgeDoesNotWin() {
+        FakeApiServer server;
+        QVERIFY(server.listen());
+        
+        std::unique_ptr<AsianCryptoPayment> sdk(createTestSdk(server));
+        sdk->setHedgingEnabled(true);
+        
+        QList<Payment> retrieved;
+        QList<int> errors;
+        connect(sdk.get(), &AsianCryptoPayment::paymentRetrieved, this, [&retrieved](const Payment& payment) {
+            retrieved.append(payment);
+        });
+        connect(sdk.get(), &AsianCryptoPayment::error, this, [&errors](int errorCode, const QString&) {
+            errors.append(errorCode);
+        });
+        
+        // Fast replies give the endpoint a latency profile, which arms hedging
+        QDateTime now = QDateTime::currentDateTimeUtc();
+        for (int i = 0; i < 20; ++i) {
+            QString id = QString("W%1").arg(i);
+            server.enqueue("GET", "/payments/" + id, FakeApiServer::json(200, paymentJson(id, "pending", now)));
+            sdk->getPayment(id);
+            QTRY_COMPARE(retrieved.size(), i + 1);
+        }
+        
+        // The original answers slowly; its hedge is rate limited at once
+        server.enqueue("GET", "/payments/P1",
+                       FakeApiServer::delayed(FakeApiServer::json(200, paymentJson("P1", "pending", now)), 1000));
+        server.enqueue("GET", "/payments/P1", FakeApiServer::raw(429));
+        sdk->getPayment("P1");
+        
+        QTRY_COMPARE_WITH_TIMEOUT(retrieved.size(), 21, 5000);
+        QCOMPARE(retrieved.last().id(), QString("P1"));
+        QCOMPARE(server.count("GET", "/payments/P1"), 2);
+        QCOMPARE(sdk->statistics().hedgedRequests, quint64(1));
+        QCOMPARE(sdk->statistics().hedgeWins, quint64(0));
+        QVERIFY(errors.isEmpty());
+    }
+    
+    void errorSlotsMayQueueRequestsDuringDrain() {
+        FakeApiServer server;
+        QVERIFY(server.listen());
+        
+        std::unique_ptr<AsianCryptoPayment> sdk(createTestSdk(server));
+        sdk->setCircuitBreakerPolicy(0.5, 60000);
+        sdk->setRetryPolicy(AsianCryptoPayment::RequestType::GetPayment, RetryPolicy(1));
+        sdk->setLaneConcurrency(RequestPriority::Normal, 1);
+        
+        QList<Payment> retrieved;
+        QList<int> errors;
+        connect(sdk.get(), &AsianCryptoPayment::paymentRetrieved, this, [&retrieved](const Payment& payment) {
+            retrieved.append(payment);
+        });
+        
+        // The only normal slot is busy while the breaker opens
+        QDateTime now = QDateTime::currentDateTimeUtc();
+        server.enqueue("GET", "/payments/P0",
+                       FakeApiServer::delayed(FakeApiServer::json(200, paymentJson("P0", "pending", now)), 1500));
+        sdk->getPayment("P0");
+        
+        connect(sdk.get(), &AsianCryptoPayment::error, this, [&errors](int errorCode, const QString&) {
+            errors.append(errorCode);
+        });
+        for (int i = 0; i < 10; ++i) {
+            QString id = QString("F%1").arg(i);
+            server.setRoute("GET", "/payments/" + id, FakeApiServer::raw(500));
+            sdk->getPayment(id, RequestOptions().setPriority(RequestPriority::Interactive));
+        }
+        QTRY_COMPARE(errors.size(), 10);
+        
+        sdk->getPayment("Q1");
+        sdk->getPayment("Q2");
+        sdk->getPayment("Q3");
+        QCOMPARE(errors.size(), 10);
+        
+        // Rejections come out of the drain; a slot asks again from inside it
+        bool retried = false;
+        connect(sdk.get(), &AsianCryptoPayment::error, this, [&sdk, &retried](int errorCode, const QString&) {
+            if (errorCode == CircuitOpenError && !retried) {
+                retried = true;
+                sdk->getPayment("Q4");
+            }
+        });
+        
+        QTRY_COMPARE_WITH_TIMEOUT(retrieved.size(), 1, 5000);
+        QTRY_COMPARE(errors.size(), 14);
+        QCOMPARE(errors.mid(10), QList<int>() << CircuitOpenError << CircuitOpenError
+                                              << CircuitOpenError << CircuitOpenError);
+        QCOMPARE(sdk->statistics().circuitRejections, quint64(4));
+        for (const QString& id : QStringList{"Q1", "Q2", "Q3", "Q4"}) {
+            QCOMPARE(server.count("GET", "/payments/" + id), 0);
+        }
+    }
+};
+
+QTEST_GUILESS_MAIN(TestResilience)
+#include "tst_resilience.moc"
+#include "moc_asian_crypto_payment.cpp"
@@ -0,0 +1,143 @@
+/**
+ * Asian Cryptocurrency Payment System - Payment status polling tests
+ */
+
+#include <QtTest>
+
+#include "test_support.h"
+
+using namespace AsianCryptoPay;
+
+class TestStatusPolling : public QObject {
+    Q_OBJECT
+
+private:
+    FakeApiServer* m_server = nullptr;
+    AsianCryptoPayment* m_sdk = nullptr;
+    QList<Payment> m_created;
+    QList<Payment> m_updates;
+    
+    /**
+     * @brief Create payment P1 and wait for the SDK to start checking it
+     */
+    void createTrackedPayment(const QDateTime& expiresAt = QDateTime()) {
+        QDateTime now = QDateTime::currentDateTimeUtc();
+        m_server->enqueue("POST", "/payments",
+                          FakeApiServer::json(201, paymentJson("P1", "created", now, 1, expiresAt)));
+        m_sdk->createPayment(testPaymentDetails());
+        QTRY_COMPARE(m_created.size(), 1);
+    }
+    
+    static QJsonObject paymentList(const QList<QJsonObject>& payments) {
+        QJsonArray array;
+        for (const QJsonObject& payment : payments) {
+            array.append(payment);
+        }
+        
+        QJsonObject list;
+        list["payments"] = array;
+        list["total"] = array.size();
+        return list;
+    }
+
+private slots:
+    void init() {
+        m_server = new FakeApiServer(this);
+        QVERIFY(m_server->listen());
+        
+        m_sdk = createTestSdk(*m_server, this);
+        m_sdk->setPollingPolicy(PollingPolicy(50, 50, 1.0, 0));
+        m_created.clear();
+        m_updates.clear();
+        
+        connect(m_sdk, &AsianCryptoPayment::paymentCreated, this, [this](const Payment& payment) {
+            m_created.append(payment);
+        });
+        connect(m_sdk, &AsianCryptoPayment::paymentStatusUpdated, this, [this](const Payment& payment) {
+            m_updates.append(payment);
+        });
+    }
+    
+    void cleanup() {
+        delete m_sdk;
+        delete m_server;
+    }
+    
+    void emptyBatchFallsBackOnce() {
+        QDateTime now = QDateTime::currentDateTimeUtc();
+        m_server->setRoute("GET", "/payments", FakeApiServer::json(200, paymentList({})));
+        m_server->setRoute("GET", "/payments/P1", FakeApiServer::json(200, paymentJson("P1", "pending", now, 2)));
+        
+        createTrackedPayment();
+        
+        // The payment the batch left out is fetched on its own...
+        QTRY_VERIFY_WITH_TIMEOUT(m_server->count("GET", "/payments/P1") >= 1, 5000);
+        QTRY_COMPARE(m_updates.size(), 1);
+        QCOMPARE(m_updates.first().status(), PaymentStatus::Pending);
+        
+        // ...but the next check is batched again
+        QTRY_VERIFY_WITH_TIMEOUT(m_server->count("GET", "/payments") >= 2, 5000);
+        QCOMPARE(m_server->requests("GET", "/payments").last().query.queryItemValue("ids"), QString("P1"));
+    }
+    
+    void batchEncodesPaymentIds() {
+        QDateTime now = QDateTime::currentDateTimeUtc();
+        m_server->enqueue("POST", "/payments", FakeApiServer::json(201, paymentJson("P&1", "created", now)));
+        m_server->setRoute("GET", "/payments",
+                           FakeApiServer::json(200, paymentList({paymentJson("P&1", "pending", now, 2)})));
+        
+        m_sdk->createPayment(testPaymentDetails());
+        QTRY_COMPARE(m_created.size(), 1);
+        
+        // The id stays one value instead of splitting the query
+        QTRY_COMPARE(m_updates.size(), 1);
+        FakeApiServer::Request sent = m_server->requests("GET", "/payments").first();
+        QCOMPARE(sent.query.queryItemValue("ids", QUrl::FullyDecoded), QString("P&1"));
+        QCOMPARE(sent.query.queryItemValue("limit"), QString("1"));
+        QCOMPARE(m_server->count("GET", "/payments/P&1"), 0);
+    }
+    
+    void ignoredFilterDisablesBatching() {
+        QDateTime now = QDateTime::currentDateTimeUtc();
+        m_server->setRoute("GET", "/payments",
+                           FakeApiServer::json(200, paymentList({paymentJson("P9", "pending", now)})));
+        m_server->setRoute("GET", "/payments/P1", FakeApiServer::json(200, paymentJson("P1", "pending", now, 2)));
+        
+        createTrackedPayment();
+        
+        // A payment nobody asked for: every later check goes out on its own
+        QTRY_VERIFY_WITH_TIMEOUT(m_server->count("GET", "/payments/P1") >= 2, 5000);
+        QCOMPARE(m_server->count("GET", "/payments"), 1);
+    }
+    
+    void expiredPaymentGetsOneLastCheck() {
+        QDateTime now = QDateTime::currentDateTimeUtc();
+        m_server->setRoute("GET", "/payments",
+                           FakeApiServer::json(200, paymentList({paymentJson("P1", "pending", now, 2)})));
+        
+        createTrackedPayment(now.addSecs(-10));
+        
+        // The answer still comes through, but nothing is checked after it
+        QTRY_COMPARE(m_updates.size(), 1);
+        QCOMPARE(m_sdk->statistics().statusCheckedPayments, quint64(1));
+        QTest::qWait(1500);
+        QCOMPARE(m_server->count("GET", "/payments"), 1);
+    }
+    
+    void failedLastCheckEndsTracking() {
+        m_sdk->setRetryPolicy(AsianCryptoPayment::RequestType::PollPayments, RetryPolicy(1));
+        m_server->setRoute("GET", "/payments", FakeApiServer::raw(500));
+        
+        QDateTime now = QDateTime::currentDateTimeUtc();
+        createTrackedPayment(now.addSecs(2));
+        
+        QTRY_COMPARE_WITH_TIMEOUT(m_sdk->statistics().statusCheckedPayments, quint64(1), 10000);
+        int checks = m_server->count("GET", "/payments");
+        QTest::qWait(1500);
+        QCOMPARE(m_server->count("GET", "/payments"), checks);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestStatusPolling)
+#include "tst_status_polling.moc"
+#include "moc_asian_crypto_payment.cpp"
@@ -0,0 +1,121 @@
+/**
+ * Asian Cryptocurrency Payment System - Timing wheel tests
+ */
+
+#include <QtTest>
+#include <QRandomGenerator>
+
+#include "test_support.h"
+
+using namespace AsianCryptoPay;
+
+class TestTimerWheel : public QObject {
+    Q_OBJECT
+
+private:
+    /**
+     * @brief Take the keys of a reference model that are due by a tick
+     */
+    static QStringList takeDue(QHash<QString, qint64>& due, qint64 tick) {
+        QStringList taken;
+        for (auto it = due.begin(); it != due.end();) {
+            if (it.value() <= tick) {
+                taken.append(it.key());
+                it = due.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        
+        taken.sort();
+        return taken;
+    }
+    
+    static QStringList sorted(QStringList keys) {
+        keys.sort();
+        return keys;
+    }
+
+private slots:
+    void expiresOnTheTick() {
+        TimerWheel wheel(100);
+        wheel.schedule("A", 250);
+        wheel.schedule("B", 300);
+        
+        // Delays round up to whole ticks
+        QVERIFY(wheel.advance(299).isEmpty());
+        QCOMPARE(sorted(wheel.advance(300)), QStringList() << "A" << "B");
+        QCOMPARE(wheel.size(), 0);
+    }
+    
+    void rescheduleReplacesExpiry() {
+        TimerWheel wheel(1);
+        wheel.schedule("A", 10);
+        wheel.schedule("A", 5000);
+        
+        QVERIFY(wheel.advance(4999).isEmpty());
+        QVERIFY(wheel.contains("A"));
+        QCOMPARE(wheel.advance(5000), QStringList() << "A");
+        
+        wheel.schedule("B", 10);
+        wheel.cancel("B");
+        QVERIFY(wheel.advance(6000).isEmpty());
+    }
+    
+    void takesOnlyKeysDueWithinHorizon() {
+        TimerWheel wheel(1);
+        wheel.schedule("A", 5);
+        wheel.schedule("B", 20);
+        wheel.schedule("C", 40);
+        
+        QCOMPARE(sorted(wheel.takeDueWithin(20)), QStringList() << "A" << "B");
+        QCOMPARE(wheel.size(), 1);
+        QCOMPARE(wheel.advance(40), QStringList() << "C");
+    }
+    
+    void matchesReferenceModel() {
+        // Upper bounds of the delays each level holds, in ticks
+        const qint64 spans[] = {64, 64 * 64, 64 * 64 * 64, 64 * 64 * 64 * 64 - 1};
+        
+        for (quint32 seed = 1; seed <= 3; ++seed) {
+            QRandomGenerator random(seed);
+            TimerWheel wheel(1);
+            QHash<QString, qint64> due;
+            qint64 now = 0;
+            
+            for (int step = 0; step < 3000; ++step) {
+                QString key = QString("K%1").arg(random.bounded(300));
+                int operation = random.bounded(10);
+                
+                if (operation < 5) {
+                    // Delays spread over every level, so keys cascade down
+                    int level = random.bounded(4);
+                    qint64 low = level == 0 ? 1 : spans[level - 1];
+                    qint64 delay = low + qint64(random.generateDouble() * double(spans[level] - low));
+                    wheel.schedule(key, delay);
+                    due[key] = now + delay;
+                } else if (operation < 7) {
+                    wheel.cancel(key);
+                    due.remove(key);
+                } else {
+                    // Mostly short steps, now and then a jump that wraps
+                    // the lower levels several times
+                    now += random.bounded(8) == 0 ? random.bounded(300000) : random.bounded(100);
+                    QCOMPARE(sorted(wheel.advance(now)), takeDue(due, now));
+                }
+                
+                QCOMPARE(wheel.size(), due.size());
+                QCOMPARE(wheel.contains(key), due.contains(key));
+            }
+            
+            // Run past a full turn of the top level
+            now += spans[3] + 1;
+            QCOMPARE(sorted(wheel.advance(now)), takeDue(due, now));
+            QCOMPARE(wheel.size(), 0);
+        }
+    }
+};
+
+QTEST_GUILESS_MAIN(TestTimerWheel)
+#include "tst_timer_wheel.moc"
+#include "moc_asian_crypto_payment.cpp"
@@ -12,10 +12,12 @@
 #define ASIAN_CRYPTO_PAYMENT_H
 
 #include <QObject>
+#include <QCoreApplication>
 #include <QString>
 #include <QVariantMap>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
+#include <QWebSocket>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
@@ -24,12 +26,24 @@
 #include <QCryptographicHash>
 #include <QMessageAuthenticationCode>
 #include <QUuid>
+#include <QRandomGenerator>
 #include <QTimer>
+#include <QElapsedTimer>
+#include <QSet>
+#include <QHash>
+#include <QCache>
+#include <QFile>
+#include <QSaveFile>
+#include <QSettings>
+#include <QPointer>
+#include <QVector>
 #include <QPixmap>
 #include <QQmlEngine>
 #include <QJSEngine>
 #include <QDebug>
 #include <memory>
+#include <algorithm>
+#include <climits>
 
 namespace AsianCryptoPay {
 
@@ -124,6 +138,17 @@ inline PaymentStatus stringToPaymentStatus(const QString& status) {
     return PaymentStatus::Created;
 }
 
+/**
+ * @brief SDK error codes reported through AsianCryptoPayment::error
+ * 
+ * Values lie above the HTTP status and QNetworkReply::NetworkError ranges
+ * that the error signal otherwise carries.
+ */
+enum SdkError {
+    CircuitOpenError = 1001,    // Endpoint is failing; request rejected without being sent
+    DeadlineExceededError = 1002 // Operation did not finish before its deadline
+};
+
 /**
  * @brief Payment details class
  */
@@ -401,6 +426,7 @@ public:
         payment.m_createdAt = QDateTime::fromString(json["created_at"].toString(), Qt::ISODate);
         payment.m_updatedAt = QDateTime::fromString(json["updated_at"].toString(), Qt::ISODate);
         payment.m_expiresAt = QDateTime::fromString(json["expires_at"].toString(), Qt::ISODate);
+        payment.m_version = qint64(json["version"].toDouble());
         
         if (json.contains("metadata") && json["metadata"].isObject()) {
             payment.m_metadata = json["metadata"].toObject().toVariantMap();
@@ -505,6 +531,12 @@ public:
      */
     QDateTime updatedAt() const { return m_updatedAt; }
     
+    /**
+     * @brief Get server revision
+     * @return Revision that grows with every change, 0 if the server sent none
+     */
+    qint64 version() const { return m_version; }
+    
     /**
      * @brief Get expiration time
      * @return Expiration time
@@ -563,6 +595,9 @@ public:
         json["created_at"] = m_createdAt.toString(Qt::ISODate);
         json["updated_at"] = m_updatedAt.toString(Qt::ISODate);
         json["expires_at"] = m_expiresAt.toString(Qt::ISODate);
+        if (m_version > 0) {
+            json["version"] = double(m_version);
+        }
         
         if (!m_metadata.isEmpty()) {
             json["metadata"] = QJsonObject::fromVariantMap(m_metadata);
@@ -588,6 +623,7 @@ private:
     QDateTime m_createdAt;
     QDateTime m_updatedAt;
     QDateTime m_expiresAt;
+    qint64 m_version = 0;
     QVariantMap m_metadata;
 };
 
@@ -651,6 +687,23 @@ public:
         return *this;
     }
     
+    /**
+     * @brief Only return payments changed after a high-water mark
+     * 
+     * Results are ordered by updated_at and then id, and start after the
+     * payment identified by the mark; pages are walked by moving the mark
+     * instead of the offset.
+     * 
+     * @param updatedSince updated_at of the last payment already seen
+     * @param afterId ID of the last payment already seen
+     * @return Reference to this object for method chaining
+     */
+    PaymentFilters& setUpdatedSince(const QDateTime& updatedSince, const QString& afterId = QString()) {
+        m_updatedSince = updatedSince;
+        m_afterId = afterId;
+        return *this;
+    }
+    
     /**
      * @brief Get status filter
      * @return Payment status
@@ -681,6 +734,18 @@ public:
      */
     int offset() const { return m_offset; }
     
+    /**
+     * @brief Get high-water mark timestamp
+     * @return updated_at of the last payment already seen
+     */
+    QDateTime updatedSince() const { return m_updatedSince; }
+    
+    /**
+     * @brief Get high-water mark payment ID
+     * @return ID of the last payment already seen
+     */
+    QString afterId() const { return m_afterId; }
+    
     /**
      * @brief Build query string
      * @return Query string
@@ -708,6 +773,16 @@ public:
             params << QString("offset=%1").arg(m_offset);
         }
         
+        if (m_updatedSince.isValid()) {
+            params << "sort=updated_at";
+            params << QString("updated_since=%1").arg(QString::fromLatin1(
+                    QUrl::toPercentEncoding(m_updatedSince.toUTC().toString(Qt::ISODateWithMs))));
+            
+            if (!m_afterId.isEmpty()) {
+                params << QString("after_id=%1").arg(QString::fromLatin1(QUrl::toPercentEncoding(m_afterId)));
+            }
+        }
+        
         return params.join("&");
     }
     
@@ -717,860 +792,4110 @@ private:
     QDateTime m_toDate;
     int m_limit = 20;
     int m_offset = 0;
+    QDateTime m_updatedSince;
+    QString m_afterId;
 };
 
-// Forward declarations
-class CountryComplianceModule;
-class SecurityModule;
+/**
+ * @brief Scheduling lane of an API request
+ */
+enum class RequestPriority {
+    Interactive,   // Checkout operations a customer is waiting for
+    Normal,        // Lookups made for the kiosk UI
+    Background     // Status polling and history sync
+};
 
 /**
- * @brief Main SDK class for Asian Cryptocurrency Payment System
+ * @brief Per-call options for SDK operations
  */
-class AsianCryptoPayment : public QObject {
-    Q_OBJECT
-    
+class RequestOptions {
 public:
     /**
      * @brief Constructor
-     * @param apiKey Merchant API key
-     * @param merchantId Merchant ID
-     * @param countryCode Country code
-     * @param parent Parent QObject
      */
-    AsianCryptoPayment(const QString& apiKey, const QString& merchantId, CountryCode countryCode, QObject* parent = nullptr);
+    RequestOptions() {}
     
     /**
-     * @brief Destructor
+     * @brief Set a timeout relative to now
+     * 
+     * Covers the whole operation, including time spent queued for the rate
+     * limiter and any retries.
+     * 
+     * @param timeoutMs Timeout in milliseconds
+     * @return Reference to this object for method chaining
      */
-    ~AsianCryptoPayment();
+    RequestOptions& setTimeout(int timeoutMs) {
+        m_deadline = QDateTime::currentMSecsSinceEpoch() + timeoutMs;
+        return *this;
+    }
     
     /**
-     * @brief Set test mode
-     * @param testMode Whether to use test mode
+     * @brief Set an absolute deadline
+     * @param deadline Time by which the operation must finish
+     * @return Reference to this object for method chaining
      */
-    void setTestMode(bool testMode);
+    RequestOptions& setDeadline(const QDateTime& deadline) {
+        m_deadline = deadline.toMSecsSinceEpoch();
+        return *this;
+    }
     
     /**
-     * @brief Set custom API endpoint
-     * @param apiEndpoint Custom API endpoint
+     * @brief Get deadline
+     * @return Deadline in milliseconds since epoch, or 0 if none
      */
-    void setApiEndpoint(const QString& apiEndpoint);
+    qint64 deadline() const { return m_deadline; }
     
     /**
-     * @brief Set supported cryptocurrencies
-     * @param supportedCryptocurrencies List of supported cryptocurrencies
+     * @brief Override the scheduling lane of the operation
+     * 
+     * By default createPayment and cancelPayment are interactive,
+     * getPayments and status polling run in the background and all other
+     * operations are normal.
+     * 
+     * @param priority Scheduling lane
+     * @return Reference to this object for method chaining
      */
-    void setSupportedCryptocurrencies(const QStringList& supportedCryptocurrencies);
+    RequestOptions& setPriority(RequestPriority priority) {
+        m_priority = priority;
+        m_hasPriority = true;
+        return *this;
+    }
     
     /**
-     * @brief Set webhook configuration
-     * @param webhookEndpoint Webhook endpoint URL
-     * @param webhookSecret Webhook secret for signature verification
+     * @brief Check if a scheduling lane was set
+     * @return Whether setPriority() was called
      */
-    void setWebhookConfig(const QString& webhookEndpoint, const QString& webhookSecret);
+    bool hasPriority() const { return m_hasPriority; }
     
     /**
-     * @brief Get API key
-     * @return API key
+     * @brief Get scheduling lane
+     * @return Scheduling lane; only meaningful if hasPriority()
      */
-    QString apiKey() const { return m_apiKey; }
+    RequestPriority priority() const { return m_priority; }
     
+private:
+    qint64 m_deadline = 0;
+    RequestPriority m_priority = RequestPriority::Normal;
+    bool m_hasPriority = false;
+};
+
+/**
+ * @brief Token bucket tracking the request budget of one endpoint class
+ * 
+ * Refills continuously at the documented per-minute limit and is corrected
+ * from the X-RateLimit-* headers returned by the API. A number of tokens can
+ * be held back as headroom that only privileged requests may spend.
+ */
+class TokenBucket {
+public:
     /**
-     * @brief Get merchant ID
-     * @return Merchant ID
+     * @brief Constructor
+     * @param limitPerMinute Requests allowed per minute
+     * @param reserve Tokens reserved for privileged requests
      */
-    QString merchantId() const { return m_merchantId; }
+    TokenBucket(int limitPerMinute = 60, int reserve = 0)
+        : m_capacity(limitPerMinute)
+        , m_tokens(limitPerMinute)
+        , m_reserve(reserve)
+        , m_lastRefill(QDateTime::currentMSecsSinceEpoch()) {}
     
     /**
-     * @brief Get country code
-     * @return Country code
+     * @brief Take a token if one is available
+     * @param useReserve Whether the reserved headroom may be spent
+     * @param now Current time in milliseconds since epoch
+     * @return Whether a token was taken
      */
-    CountryCode countryCode() const { return m_countryCode; }
+    bool tryAcquire(bool useReserve, qint64 now) {
+        refill(now);
+        
+        if (now < m_blockedUntil || m_tokens < 1.0 + (useReserve ? 0 : m_reserve)) {
+            return false;
+        }
+        
+        m_tokens -= 1.0;
+        return true;
+    }
     
     /**
-     * @brief Get country code as string
-     * @return Two-letter country code string
+     * @brief Time until a token becomes available
+     * @param useReserve Whether the reserved headroom may be spent
+     * @param now Current time in milliseconds since epoch
+     * @return Milliseconds to wait, 0 if a token is available now
      */
-    QString countryCodeString() const { return countryCodeToString(m_countryCode); }
+    qint64 msUntilAvailable(bool useReserve, qint64 now) {
+        refill(now);
+        
+        double needed = 1.0 + (useReserve ? 0 : m_reserve) - m_tokens;
+        qint64 wait = needed > 0.0 ? qint64(needed * 60000.0 / m_capacity) + 1 : 0;
+        return qMax(wait, m_blockedUntil - now);
+    }
     
     /**
-     * @brief Get test mode
-     * @return Whether test mode is enabled
+     * @brief Correct the bucket from X-RateLimit-* response headers
+     * @param limit Requests allowed per window, or -1 if absent
+     * @param remaining Requests remaining in the window, or -1 if absent
+     * @param resetAt Window reset time in milliseconds since epoch, or 0 if absent
+     * @param now Current time in milliseconds since epoch
      */
-    bool testMode() const { return m_testMode; }
+    void update(int limit, int remaining, qint64 resetAt, qint64 now) {
+        refill(now);
+        
+        if (limit > 0) {
+            m_capacity = limit;
+            m_reserve = qMin(m_reserve, limit - 1);
+        }
+        
+        if (remaining >= 0) {
+            m_tokens = qMin(m_tokens, double(remaining));
+            
+            if (remaining == 0 && resetAt > now) {
+                m_blockedUntil = resetAt;
+            }
+        }
+    }
     
     /**
-     * @brief Get API endpoint
-     * @return API endpoint
+     * @brief Stop spending tokens until the given time (e.g. after HTTP 429)
+     * @param until Time in milliseconds since epoch
      */
-    QString apiEndpoint() const { return m_apiEndpoint; }
+    void blockUntil(qint64 until) {
+        m_tokens = 0.0;
+        m_blockedUntil = qMax(m_blockedUntil, until);
+    }
     
     /**
-     * @brief Get supported cryptocurrencies
-     * @return List of supported cryptocurrencies
+     * @brief Get the per-minute limit
+     * @return Requests allowed per minute
      */
-    QStringList supportedCryptocurrencies() const { return m_supportedCryptocurrencies; }
+    int limit() const { return int(m_capacity); }
     
     /**
-     * @brief Create a new cryptocurrency payment
-     * @param paymentDetails Payment details
+     * @brief Set the number of reserved tokens
+     * @param reserve Tokens reserved for privileged requests
      */
-    void createPayment(const PaymentDetails& paymentDetails);
+    void setReserve(int reserve) { m_reserve = qBound(0, reserve, int(m_capacity) - 1); }
     
+private:
+    double m_capacity;
+    double m_tokens;
+    int m_reserve;
+    qint64 m_lastRefill;
+    qint64 m_blockedUntil = 0;
+    
+    void refill(qint64 now) {
+        if (now > m_lastRefill) {
+            m_tokens = qMin(m_capacity, m_tokens + (now - m_lastRefill) * m_capacity / 60000.0);
+            m_lastRefill = now;
+        }
+    }
+};
+
+/**
+ * @brief Circuit breaker for one endpoint class
+ * 
+ * Trips open when the share of failures among the most recent replies
+ * reaches the threshold. While open, requests are rejected immediately;
+ * after the cool-down a single probe request is let through and its
+ * outcome decides whether the circuit closes again.
+ */
+class CircuitBreaker {
+public:
     /**
-     * @brief Get payment details by ID
-     * @param paymentId Payment ID
+     * @brief Circuit state
      */
-    void getPayment(const QString& paymentId);
+    enum class State {
+        Closed,
+        Open,
+        HalfOpen
+    };
     
     /**
-     * @brief Get list of payments
-     * @param filters Filter parameters
+     * @brief Constructor
+     * @param failureThreshold Failure ratio that opens the circuit (0.0 - 1.0)
+     * @param minimumRequests Replies needed before the ratio is trusted
+     * @param openMs Cool-down in milliseconds before a probe is allowed
      */
-    void getPayments(const PaymentFilters& filters = PaymentFilters());
+    CircuitBreaker(double failureThreshold = 0.5, int minimumRequests = 10, int openMs = 15000)
+        : m_failureThreshold(failureThreshold)
+        , m_minimumRequests(minimumRequests)
+        , m_openMs(openMs) {}
     
     /**
-     * @brief Cancel a payment
-     * @param paymentId Payment ID
+     * @brief Check whether a request may be sent
+     * @param now Current time in milliseconds since epoch
+     * @return Whether the request may be sent
      */
-    void cancelPayment(const QString& paymentId);
+    bool allowRequest(qint64 now) {
+        if (m_state == State::Open) {
+            if (now < m_openUntil) {
+                return false;
+            }
+            m_state = State::HalfOpen;
+            m_stateChangedAt = now;
+            m_probeSentAt = 0;
+        }
+        
+        if (m_state == State::HalfOpen) {
+            // One probe at a time; a lost probe is replaced after a cool-down
+            if (m_probeSentAt > 0 && now - m_probeSentAt < m_openMs) {
+                return false;
+            }
+            m_probeSentAt = now;
+        }
+        
+        return true;
+    }
     
     /**
-     * @brief Get current exchange rates
-     * @param baseCurrency Base currency
-     * @param cryptoCurrencies List of cryptocurrencies to get rates for
+     * @brief Record a successful reply
+     * 
+     * Replies to requests sent before the last state change describe the
+     * endpoint as it was then and are ignored, so a late success cannot
+     * close a half-open circuit in place of its probe.
+     * 
+     * @param sentAt Time the request was sent in milliseconds since epoch
+     * @param now Current time in milliseconds since epoch
      */
-    void getExchangeRates(const QString& baseCurrency, const QStringList& cryptoCurrencies = QStringList());
+    void recordSuccess(qint64 sentAt, qint64 now) {
+        if (sentAt < m_stateChangedAt) {
+            return;
+        }
+        
+        if (m_state == State::HalfOpen) {
+            m_state = State::Closed;
+            m_stateChangedAt = now;
+            m_outcomes.clear();
+            m_failures = 0;
+            return;
+        }
+        
+        record(false);
+    }
     
     /**
-     * @brief Verify webhook signature
-     * @param signature Webhook signature
-     * @param body Raw webhook body
-     * @return Whether signature is valid
+     * @brief Record a failed reply
+     * @param sentAt Time the request was sent in milliseconds since epoch
+     * @param now Current time in milliseconds since epoch
      */
-    bool verifyWebhookSignature(const QString& signature, const QString& body);
+    void recordFailure(qint64 sentAt, qint64 now) {
+        if (sentAt < m_stateChangedAt) {
+            return;
+        }
+        
+        if (m_state == State::HalfOpen) {
+            trip(now);
+            return;
+        }
+        
+        record(true);
+        
+        if (m_outcomes.size() >= m_minimumRequests &&
+                m_failures >= m_failureThreshold * m_outcomes.size()) {
+            trip(now);
+        }
+    }
     
     /**
-     * @brief Process webhook event
-     * @param event Webhook event
-     * @param signature Webhook signature
-     * @return Whether event was processed successfully
+     * @brief Get circuit state
+     * @return Circuit state
      */
-    bool processWebhookEvent(const QJsonObject& event, const QString& signature);
+    State state() const { return m_state; }
     
     /**
-     * @brief Download QR code image
-     * @param url QR code URL
+     * @brief Close the circuit and forget recorded outcomes
      */
-    void downloadQrCode(const QString& url);
+    void reset() {
+        m_state = State::Closed;
+        m_outcomes.clear();
+        m_failures = 0;
+    }
     
-signals:
+private:
+    double m_failureThreshold;
+    int m_minimumRequests;
+    int m_openMs;
+    State m_state = State::Closed;
+    qint64 m_openUntil = 0;
+    qint64 m_probeSentAt = 0;
+    qint64 m_stateChangedAt = 0;
+    QList<bool> m_outcomes;
+    int m_failures = 0;
+    
+    void record(bool failed) {
+        const int windowSize = 20;
+        
+        m_outcomes.append(failed);
+        m_failures += failed ? 1 : 0;
+        
+        if (m_outcomes.size() > windowSize) {
+            m_failures -= m_outcomes.takeFirst() ? 1 : 0;
+        }
+    }
+    
+    void trip(qint64 now) {
+        m_state = State::Open;
+        m_stateChangedAt = now;
+        m_openUntil = now + m_openMs;
+        m_outcomes.clear();
+        m_failures = 0;
+    }
+};
+
+/**
+ * @brief Incremental decoder for payment list replies
+ * 
+ * Fed with reply data as it arrives, it hands out each element of the
+ * top-level "payments" array as soon as the element is complete, so a
+ * large page is never held as one QJsonDocument. Everything outside the
+ * array (total, has_more, ...) is kept and parsed once the reply ends,
+ * with the array itself left empty.
+ */
+class PaymentListStreamParser {
+public:
     /**
-     * @brief Emitted when payment is created
-     * @param payment Payment object
+     * @brief Scan the next chunk of the reply
+     * @param data Reply bytes following those already fed
      */
-    void paymentCreated(const Payment& payment);
+    void feed(const QByteArray& data) {
+        m_started = true;
+        
+        for (char c : data) {
+            bool inElement = m_inArray && m_depth >= 3;
+            
+            if (m_inString) {
+                if (m_escaped) {
+                    m_escaped = false;
+                } else if (c == '\\') {
+                    m_escaped = true;
+                } else if (c == '"') {
+                    m_inString = false;
+                    m_readingKey = false;
+                } else if (m_readingKey) {
+                    m_key.append(c);
+                }
+                (inElement ? m_element : m_envelope).append(c);
+                continue;
+            }
+            
+            switch (c) {
+                case '"':
+                    m_inString = true;
+                    if (m_depth == 1) {
+                        m_key.clear();
+                        m_readingKey = true;
+                    }
+                    break;
+                case '{':
+                case '[':
+                    if (m_inArray && m_depth == 2) {
+                        m_element.clear();
+                        inElement = true;
+                    } else if (m_depth == 1 && c == '[' && m_key == "payments") {
+                        m_inArray = true;
+                    }
+                    m_depth++;
+                    break;
+                case '}':
+                case ']':
+                    m_depth--;
+                    if (inElement && m_depth == 2) {
+                        m_element.append(c);
+                        takeElement();
+                        continue;
+                    }
+                    if (m_inArray && m_depth == 1) {
+                        m_inArray = false;
+                    }
+                    break;
+                default:
+                    // Separators between array elements are dropped
+                    if (m_inArray && m_depth == 2) {
+                        continue;
+                    }
+                    break;
+            }
+            
+            (inElement ? m_element : m_envelope).append(c);
+        }
+    }
     
     /**
-     * @brief Emitted when payment is retrieved
-     * @param payment Payment object
+     * @brief Take the array elements completed so far
+     * @return Decoded elements, in reply order
      */
-    void paymentRetrieved(const Payment& payment);
+    QList<QJsonObject> takeElements() {
+        QList<QJsonObject> elements = m_elements;
+        m_elements.clear();
+        return elements;
+    }
     
     /**
-     * @brief Emitted when payments list is retrieved
-     * @param payments List of payments
-     * @param total Total number of payments
+     * @brief Decode the rest of the reply once all data has been fed
+     * @param envelope Top-level object with an empty "payments" array
+     * @return Whether the reply was valid JSON
      */
-    void paymentsRetrieved(const QList<Payment>& payments, int total);
+    bool finish(QJsonObject& envelope) const {
+        QJsonDocument doc = QJsonDocument::fromJson(m_envelope);
+        if (m_error || m_depth != 0 || !doc.isObject()) {
+            return false;
+        }
+        
+        envelope = doc.object();
+        return true;
+    }
     
     /**
-     * @brief Emitted when payment is cancelled
-     * @param payment Payment object
+     * @brief Check whether any data has been fed
+     * @return Whether feed() was called
      */
-    void paymentCancelled(const Payment& payment);
+    bool hasStarted() const { return m_started; }
     
+private:
+    QByteArray m_envelope;
+    QByteArray m_element;
+    QByteArray m_key;
+    QList<QJsonObject> m_elements;
+    int m_depth = 0;
+    bool m_inString = false;
+    bool m_escaped = false;
+    bool m_readingKey = false;
+    bool m_inArray = false;
+    bool m_started = false;
+    bool m_error = false;
+    
+    void takeElement() {
+        QJsonDocument doc = QJsonDocument::fromJson(m_element);
+        m_element.clear();
+        
+        if (!doc.isObject()) {
+            m_error = true;
+            return;
+        }
+        
+        m_elements.append(doc.object());
+    }
+};
+
+/**
+ * @brief Rolling record of recent reply latencies
+ */
+class LatencyTracker {
+public:
     /**
-     * @brief Emitted when exchange rates are retrieved
-     * @param baseCurrency Base currency
-     * @param rates Map of cryptocurrency to exchange rate
+     * @brief Add a latency sample
+     * @param latencyMs Latency in milliseconds
      */
-    void exchangeRatesRetrieved(const QString& baseCurrency, const QVariantMap& rates);
+    void addSample(int latencyMs) {
+        const int windowSize = 128;
+        
+        if (m_samples.size() < windowSize) {
+            m_samples.append(latencyMs);
+        } else {
+            m_samples[m_next] = latencyMs;
+        }
+        m_next = (m_next + 1) % windowSize;
+    }
     
     /**
-     * @brief Emitted when QR code is downloaded
-     * @param pixmap QR code image
+     * @brief Get a latency percentile
+     * @param percentile Percentile (0.0 - 1.0)
+     * @return Latency in milliseconds, or -1 if there are too few samples
      */
-    void qrCodeDownloaded(const QPixmap& pixmap);
+    int percentile(double percentile) const {
+        const int minimumSamples = 20;
+        
+        if (m_samples.size() < minimumSamples) {
+            return -1;
+        }
+        
+        QVector<int> sorted = m_samples;
+        std::sort(sorted.begin(), sorted.end());
+        return sorted.at(qMin(sorted.size() - 1, int(percentile * sorted.size())));
+    }
     
+private:
+    QVector<int> m_samples;
+    int m_next = 0;
+};
+
+/**
+ * @brief Hierarchical timing wheel for many coarse timers
+ * 
+ * Timers are kept in slots of one tick each. Level 0 covers 64 ticks and
+ * every further level 64 times the span of the one below, so four levels
+ * reach 64^4 ticks. Scheduling and cancelling are O(1); advancing by a tick
+ * empties one slot, and every 64 ticks the next slot of the level above is
+ * moved down. A single QTimer calling advance() replaces a timer per key.
+ */
+class TimerWheel {
+public:
     /**
-     * @brief Emitted when payment status is updated
-     * @param payment Payment object
+     * @brief Constructor
+     * @param tickMs Resolution in milliseconds
      */
-    void paymentStatusUpdated(const Payment& payment);
+    explicit TimerWheel(int tickMs = 1000)
+        : m_tickMs(qMax(1, tickMs))
+        , m_slots(levels * slotsPerLevel) {}
     
     /**
-     * @brief Emitted when error occurs
-     * @param errorCode Error code
-     * @param errorMessage Error message
+     * @brief Schedule a key, replacing its previous expiry
+     * @param key Key to schedule
+     * @param delayMs Delay from the current tick in milliseconds
      */
-    void error(int errorCode, const QString& errorMessage);
-    
-private slots:
-    void onNetworkReply(QNetworkReply* reply);
-    void onQrCodeDownloaded(QNetworkReply* reply);
-    void checkPaymentStatus();
+    void schedule(const QString& key, qint64 delayMs) {
+        cancel(key);
+        
+        const qint64 maxTicks = (qint64(1) << (levels * slotBits)) - 1;
+        qint64 ticks = qBound<qint64>(1, (delayMs + m_tickMs - 1) / m_tickMs, maxTicks);
+        place(key, m_currentTick + ticks);
+    }
     
-private:
-    // Configuration
-    QString m_apiKey;
-    QString m_merchantId;
-    CountryCode m_countryCode;
-    bool m_testMode = false;
-    QString m_apiEndpoint = "https://api.asiancryptopay.com";
-    QStringList m_supportedCryptocurrencies;
-    QVariantMap m_webhookConfig;
+    /**
+     * @brief Cancel a key
+     * @param key Key to cancel
+     */
+    void cancel(const QString& key) {
+        auto it = m_entries.find(key);
+        if (it == m_entries.end()) {
+            return;
+        }
+        
+        m_slots[it->slot].remove(key);
+        m_entries.erase(it);
+    }
     
-    // Network
-    QNetworkAccessManager* m_networkManager;
+    /**
+     * @brief Check whether a key is scheduled
+     * @param key Key to look up
+     * @return Whether the key is scheduled
+     */
+    bool contains(const QString& key) const { return m_entries.contains(key); }
     
-    // Modules
-    std::unique_ptr<CountryComplianceModule> m_countryModule;
-    std::unique_ptr<SecurityModule> m_securityModule;
+    /**
+     * @brief Get number of scheduled keys
+     * @return Number of scheduled keys
+     */
+    int size() const { return m_entries.size(); }
     
-    // Active payments
-    QMap<QString, Payment> m_activePayments;
-    QMap<QString, QTimer*> m_paymentTimers;
+    /**
+     * @brief Get resolution
+     * @return Tick length in milliseconds
+     */
+    int tickMs() const { return m_tickMs; }
     
-    // Request tracking
-    enum class RequestType {
-        CreatePayment,
-        GetPayment,
-        GetPayments,
-        CancelPayment,
-        GetExchangeRates,
-        DownloadQrCode
-    };
+    /**
+     * @brief Advance the wheel and take the keys that fell due
+     * @param elapsedMs Time since the wheel was created in milliseconds
+     * @return Expired keys, which are no longer scheduled
+     */
+    QStringList advance(qint64 elapsedMs) {
+        QStringList expired;
+        qint64 targetTick = elapsedMs / m_tickMs;
+        
+        while (m_currentTick < targetTick) {
+            ++m_currentTick;
+            
+            // Entering a new round of a level moves the matching slot of
+            // the level above down
+            for (int level = 1; level < levels; ++level) {
+                if ((m_currentTick & ((qint64(1) << (level * slotBits)) - 1)) != 0) {
+                    break;
+                }
+                cascade(level);
+            }
+            
+            QSet<QString> slot;
+            slot.swap(m_slots[slotIndex(0, m_currentTick)]);
+            for (const QString& key : slot) {
+                m_entries.remove(key);
+                expired.append(key);
+            }
+        }
+        
+        return expired;
+    }
     
-    struct RequestContext {
-        RequestType type;
-        QString id;
-        QVariantMap data;
+    /**
+     * @brief Take the keys due within a horizon ahead of the current tick
+     * 
+     * Lets callers fold checks that are almost due into a batch that is
+     * going out anyway. Only the lowest level is searched.
+     * 
+     * @param horizonMs Horizon in milliseconds
+     * @return Keys taken, which are no longer scheduled
+     */
+    QStringList takeDueWithin(qint64 horizonMs) {
+        QStringList taken;
+        qint64 ticks = qMin<qint64>(slotsPerLevel - 1, horizonMs / m_tickMs);
+        
+        for (qint64 tick = m_currentTick + 1; tick <= m_currentTick + ticks; ++tick) {
+            QSet<QString>& slot = m_slots[slotIndex(0, tick)];
+            
+            for (auto it = slot.begin(); it != slot.end();) {
+                if (m_entries.value(*it).expiry == tick) {
+                    m_entries.remove(*it);
+                    taken.append(*it);
+                    it = slot.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+        
+        return taken;
+    }
+    
+private:
+    static const int slotBits = 6;
+    static const int slotsPerLevel = 1 << slotBits;
+    static const int levels = 4;
+    
+    struct Entry {
+        qint64 expiry = 0;
+        int slot = 0;
     };
     
-    QMap<QNetworkReply*, RequestContext> m_pendingRequests;
+    int m_tickMs;
+    qint64 m_currentTick = 0;
+    QVector<QSet<QString>> m_slots;
+    QHash<QString, Entry> m_entries;
     
-    // Methods
-    void validatePaymentDetails(const PaymentDetails& paymentDetails);
-    QNetworkRequest createApiRequest(const QString& endpoint, const QJsonObject& data = QJsonObject());
-    void makeApiRequest(const QString& endpoint, const QString& method, const QJsonObject& data = QJsonObject());
-    void startPaymentStatusCheck(const Payment& payment);
-    void stopPaymentStatusCheck(const QString& paymentId);
+    static int slotIndex(int level, qint64 tick) {
+        return level * slotsPerLevel + int((tick >> (level * slotBits)) & (slotsPerLevel - 1));
+    }
+    
+    void place(const QString& key, qint64 expiry) {
+        // Lowest level whose span still reaches the expiry
+        qint64 delta = expiry - m_currentTick;
+        int level = 0;
+        while (level < levels - 1 && delta >= (qint64(1) << ((level + 1) * slotBits))) {
+            ++level;
+        }
+        
+        Entry entry;
+        entry.expiry = expiry;
+        entry.slot = slotIndex(level, expiry);
+        m_slots[entry.slot].insert(key);
+        m_entries.insert(key, entry);
+    }
+    
+    void cascade(int level) {
+        QSet<QString> slot;
+        slot.swap(m_slots[slotIndex(level, m_currentTick)]);
+        
+        for (const QString& key : slot) {
+            place(key, m_entries.value(key).expiry);
+        }
+    }
 };
 
 /**
- * @brief Security module for cryptographic operations
+ * @brief Retry policy for transient request failures
+ * 
+ * Retries are delayed with exponential backoff: the n-th retry waits
+ * baseDelayMs * 2^(n-1), capped at maxDelayMs, of which a random share
+ * given by jitter is dropped so kiosks that failed together do not
+ * retry together.
  */
-class SecurityModule {
-public:
+struct RetryPolicy {
     /**
      * @brief Constructor
-     * @param apiKey API key for signature generation
+     * @param maxAttempts Total attempts, including the first one
+     * @param baseDelayMs Delay before the first retry in milliseconds
+     * @param maxDelayMs Upper bound for a single delay in milliseconds
+     * @param jitter Fraction of each delay that is randomised (0.0 - 1.0)
+     */
+    RetryPolicy(int maxAttempts = 3, int baseDelayMs = 500, int maxDelayMs = 8000, double jitter = 0.5)
+        : maxAttempts(maxAttempts)
+        , baseDelayMs(baseDelayMs)
+        , maxDelayMs(maxDelayMs)
+        , jitter(jitter) {}
+    
+    int maxAttempts;
+    int baseDelayMs;
+    int maxDelayMs;
+    double jitter;
+};
+
+/**
+ * @brief Schedule for payment status checks
+ * 
+ * The first check follows initialIntervalMs after the payment is created,
+ * when the customer is most likely to pay, and each further interval is
+ * backoffFactor times longer, up to maxIntervalMs. Within expiryWindowMs
+ * of the payment's expiry the interval drops back to initialIntervalMs.
+ * One last check is made just after expiry; then polling stops. A
+ * Retry-After header on a status reply delays the next check accordingly.
+ */
+struct PollingPolicy {
+    /**
+     * @brief Constructor
+     * @param initialIntervalMs Interval before the first check in milliseconds
+     * @param maxIntervalMs Upper bound for the interval in milliseconds
+     * @param backoffFactor Growth of the interval after each check
+     * @param expiryWindowMs Time before expiry with fast checks in milliseconds
+     */
+    PollingPolicy(int initialIntervalMs = 2000, int maxIntervalMs = 15000, double backoffFactor = 1.5,
+                  int expiryWindowMs = 30000)
+        : initialIntervalMs(initialIntervalMs)
+        , maxIntervalMs(maxIntervalMs)
+        , backoffFactor(backoffFactor)
+        , expiryWindowMs(expiryWindowMs) {}
+    
+    int initialIntervalMs;
+    int maxIntervalMs;
+    double backoffFactor;
+    int expiryWindowMs;
+};
+
+/**
+ * @brief Counters describing the SDK's network activity
+ */
+struct RequestStatistics {
+    quint64 requestsSent = 0;           // Requests handed to the network, retries included
+    quint64 requestsSucceeded = 0;      // Requests that received a successful reply
+    quint64 requestsFailed = 0;         // Requests reported through error()
+    quint64 retries = 0;                // Retries scheduled after transient failures
+    quint64 retriesExhausted = 0;       // Requests that used up their retry budget
+    quint64 rateLimitedResponses = 0;   // HTTP 429 responses received
+    quint64 coalescedRequests = 0;      // getPayment calls served by a request in flight
+    quint64 circuitRejections = 0;      // Requests failed fast by an open circuit
+    quint64 hedgedRequests = 0;         // Hedge requests sent for slow GETs
+    quint64 hedgeWins = 0;              // Hedge requests that answered first
+    quint64 deadlinesExceeded = 0;      // Operations failed with DeadlineExceededError
+    quint64 requestsCancelled = 0;      // Operations cancelled through a RequestHandle
+    quint64 keepAlivePings = 0;         // HEAD requests sent to keep idle connections open
+    quint64 coldConnectionRequests = 0; // Successful requests that had to open a new TLS connection
+    quint64 coldConnectionLatencyMs = 0; // Total latency of those requests
+    quint64 warmConnectionRequests = 0; // Successful requests served on an open connection
+    quint64 warmConnectionLatencyMs = 0; // Total latency of those requests
+    quint64 http2Requests = 0;          // Successful requests answered over HTTP/2
+    quint64 http2Fallbacks = 0;         // Switches to HTTP/1.1 after HTTP/2 protocol failures
+    quint64 responseCacheHits = 0;      // GETs answered 304 and served from the response cache
+    quint64 responseCacheMisses = 0;    // GETs that returned a full body
+    quint64 requestBodyBytes = 0;       // Request bodies before compression
+    quint64 requestWireBytes = 0;       // Request bodies as sent
+    quint64 responseBodyBytes = 0;      // Response bodies after decompression
+    quint64 responseWireBytes = 0;      // Response bodies as received
+    quint64 operationsDeferred = 0;     // Payment operations parked in the outbound queue
+    quint64 regionProbes = 0;           // Round-trip probes sent to regional endpoints
+    quint64 regionFailovers = 0;        // Switches away from a regional endpoint that failed
+    quint64 statusChecks = 0;           // Payment status checks, one per payment per poll
+    quint64 statusCheckedPayments = 0;  // Payments whose status checks have ended
+    quint64 completionsDetected = 0;    // Completed payments noticed by status checks
+    quint64 completionDetectionMs = 0;  // Total time from completion (updated_at) to noticing it
+    quint64 pushEvents = 0;             // Payment events received over the push channel
+    quint64 pushDeliveryMs = 0;         // Total time from the server sending them to their arrival
+    quint64 pushReconnects = 0;         // Push channel connection attempts after the first
+    quint64 duplicateUpdates = 0;       // Payment updates dropped as already reported
+    quint64 staleUpdates = 0;           // Payment updates dropped as older than the state reported
+};
+
+// Forward declarations
+class CountryComplianceModule;
+class SecurityModule;
+class AsianCryptoPayment;
+
+/**
+ * @brief Handle to an operation started by AsianCryptoPayment
+ * 
+ * Cancelling aborts the underlying network request without emitting
+ * error(). Callers that attached to a shared getPayment request only
+ * detach from it; the request is aborted once nobody is left.
+ */
+class RequestHandle {
+public:
+    /**
+     * @brief Constructor for an invalid handle
      */
-    SecurityModule(const QString& apiKey) : m_apiKey(apiKey) {}
+    RequestHandle() {}
     
     /**
-     * @brief Generate signature for API request
-     * @param payload Request payload
-     * @param timestamp Request timestamp
-     * @return Signature
+     * @brief Constructor
+     * @param owner SDK instance running the operation
+     * @param requestId Request ID
      */
-    QString generateSignature(const QString& payload, const QString& timestamp) {
-        QString message = timestamp + "." + payload;
-        return hmacSha256(m_apiKey, message);
-    }
+    RequestHandle(AsianCryptoPayment* owner, quint64 requestId);
     
     /**
-     * @brief Verify webhook signature
-     * @param signature Webhook signature
-     * @param payload Webhook payload
-     * @param secret Webhook secret
-     * @return Whether signature is valid
+     * @brief Get request ID
+     * @return Request ID, 0 for an invalid handle
      */
-    bool verifySignature(const QString& signature, const QString& payload, const QString& secret) {
-        QString expectedSignature = hmacSha256(secret, payload);
-        return expectedSignature == signature;
-    }
+    quint64 requestId() const { return m_requestId; }
     
-private:
-    QString m_apiKey;
+    /**
+     * @brief Check whether the handle refers to an operation
+     * @return Whether the operation was started
+     */
+    bool isValid() const { return m_requestId != 0; }
     
     /**
-     * @brief Generate HMAC-SHA256 signature
-     * @param key Secret key
-     * @param message Message to sign
-     * @return HMAC-SHA256 signature
+     * @brief Cancel the operation
+     * @return Whether an operation still running was cancelled
      */
-    QString hmacSha256(const QString& key, const QString& message) {
-        return QMessageAuthenticationCode::hash(
-            message.toUtf8(),
-            key.toUtf8(),
-            QCryptographicHash::Sha256
-        ).toHex();
-    }
+    bool cancel();
+    
+private:
+    QPointer<AsianCryptoPayment> m_owner;
+    quint64 m_requestId = 0;
 };
 
 /**
- * @brief Interface for country-specific compliance modules
+ * @brief Main SDK class for Asian Cryptocurrency Payment System
  */
-class CountryComplianceModule {
+class AsianCryptoPayment : public QObject {
+    Q_OBJECT
+    
 public:
-    virtual ~CountryComplianceModule() {}
+    /**
+     * @brief API operations, used to configure per-operation behaviour
+     */
+    enum class RequestType {
+        CreatePayment,
+        GetPayment,
+        GetPayments,
+        CancelPayment,
+        GetExchangeRates,
+        DownloadQrCode,
+        PollPayments
+    };
     
     /**
-     * @brief Validate payment according to country-specific regulations
-     * @param paymentDetails Payment details
-     * @throws std::invalid_argument if validation fails
+     * @brief Constructor
+     * @param apiKey Merchant API key
+     * @param merchantId Merchant ID
+     * @param countryCode Country code
+     * @param parent Parent QObject
      */
-    virtual void validatePayment(const PaymentDetails& paymentDetails) = 0;
+    AsianCryptoPayment(const QString& apiKey, const QString& merchantId, CountryCode countryCode, QObject* parent = nullptr);
     
     /**
-     * @brief Get country name
-     * @return Country name
+     * @brief Destructor
      */
-    virtual QString countryName() const = 0;
+    ~AsianCryptoPayment();
     
     /**
-     * @brief Get currency code
-     * @return Currency code
+     * @brief Set test mode
+     * 
+     * Test and live mode keep separate payment sync marks. The mode cannot
+     * change while syncPayments() is running; the call is then ignored.
+     * 
+     * @param testMode Whether to use test mode
      */
-    virtual QString currencyCode() const = 0;
+    void setTestMode(bool testMode);
     
     /**
-     * @brief Get regulator name
-     * @return Regulator name
+     * @brief Set custom API endpoint
+     * @param apiEndpoint Custom API endpoint
      */
-    virtual QString regulator() const = 0;
+    void setApiEndpoint(const QString& apiEndpoint);
     
     /**
-     * @brief Get KYC threshold
-     * @return KYC threshold
+     * @brief Set regional API endpoints
+     * 
+     * Each endpoint is probed with a HEAD request every probeIntervalMs and
+     * requests go to the healthy endpoint with the lowest smoothed round
+     * trip; the first one is used until probes have answered. An endpoint
+     * whose requests fail repeatedly is skipped until three probes in a row
+     * or a request sent to it succeed, and requests that failed on it are
+     * retried at once on the new endpoint with their original idempotency
+     * keys.
+     * 
+     * @param apiEndpoints API endpoints serving the same merchant data
+     * @param probeIntervalMs Interval between round-trip probes in milliseconds
      */
-    virtual double kycThreshold() const = 0;
-};
-
-/**
- * @brief Malaysia compliance module
- */
-class MalaysiaComplianceModule : public CountryComplianceModule {
-public:
-    void validatePayment(const PaymentDetails& paymentDetails) override {
-        if (currencyCode() == paymentDetails.currency()) {
-            if (paymentDetails.amount() >= kycThreshold() && 
-                    paymentDetails.customerName().isEmpty()) {
-                throw std::invalid_argument("KYC information required for payments above " + 
-                        QString::number(kycThreshold()).toStdString() + " " + currencyCode().toStdString());
-            }
-        }
-    }
+    void setApiEndpoints(const QStringList& apiEndpoints, int probeIntervalMs = 30000);
     
-    QString countryName() const override { return "Malaysia"; }
-    QString currencyCode() const override { return "MYR"; }
-    QString regulator() const override { return "Securities Commission Malaysia (SC)"; }
-    double kycThreshold() const override { return 3000.0; }
-};
-
-/**
- * @brief Singapore compliance module
- */
-class SingaporeComplianceModule : public CountryComplianceModule {
-public:
-    void validatePayment(const PaymentDetails& paymentDetails) override {
-        if (currencyCode() == paymentDetails.currency()) {
-            if (paymentDetails.amount() >= kycThreshold() && 
-                    (paymentDetails.customerName().isEmpty() || paymentDetails.customerEmail().isEmpty())) {
-                throw std::invalid_argument("KYC information (name and email) required for payments above " + 
-                        QString::number(kycThreshold()).toStdString() + " " + currencyCode().toStdString());
-            }
-            
-            // Travel Rule compliance
-            if (paymentDetails.amount() >= 1000.0) {
-                qDebug() << "Travel Rule applies to this transaction";
-                // Additional Travel Rule implementation would go here
-            }
-        }
-    }
+    /**
+     * @brief Set supported cryptocurrencies
+     * @param supportedCryptocurrencies List of supported cryptocurrencies
+     */
+    void setSupportedCryptocurrencies(const QStringList& supportedCryptocurrencies);
     
-    QString countryName() const override { return "Singapore"; }
-    QString currencyCode() const override { return "SGD"; }
-    QString regulator() const override { return "Monetary Authority of Singapore (MAS)"; }
-    double kycThreshold() const override { return 1000.0; }
-};
-
-/**
- * @brief Indonesia compliance module
- */
-class IndonesiaComplianceModule : public CountryComplianceModule {
-public:
-    void validatePayment(const PaymentDetails& paymentDetails) override {
-        if (currencyCode() == paymentDetails.currency()) {
-            if (paymentDetails.amount() >= kycThreshold() && 
-                    paymentDetails.customerName().isEmpty()) {
-                throw std::invalid_argument("KYC information required for payments above " + 
-                        QString::number(kycThreshold()).toStdString() + " " + currencyCode().toStdString());
-            }
-        }
-    }
+    /**
+     * @brief Set webhook configuration
+     * @param webhookEndpoint Webhook endpoint URL
+     * @param webhookSecret Webhook secret for signature verification
+     */
+    void setWebhookConfig(const QString& webhookEndpoint, const QString& webhookSecret);
     
-    QString countryName() const override { return "Indonesia"; }
-    QString currencyCode() const override { return "IDR"; }
-    QString regulator() const override { return "Commodity Futures Trading Regulatory Agency (Bappebti)"; }
+    /**
+     * @brief Set createPayment headroom
+     * 
+     * Number of POST /payments slots per minute that other POST requests
+     * may not use, so checkouts still go out when the budget runs low.
+     * 
+     * @param reservedRequests Reserved requests per minute
+     */
+    void setCreatePaymentHeadroom(int reservedRequests);
+    
+    /**
+     * @brief Set retry policy for an operation
+     * 
+     * POST requests carry an Idempotency-Key that stays the same across
+     * retries, so a retried createPayment cannot create a second invoice.
+     * 
+     * @param type Operation the policy applies to
+     * @param policy Retry policy; maxAttempts of 1 disables retries
+     */
+    void setRetryPolicy(RequestType type, const RetryPolicy& policy);
+    
+    /**
+     * @brief Set the schedule for payment status checks
+     * 
+     * Applies to checks scheduled from now on. statusChecks divided by
+     * statusCheckedPayments in statistics() gives the checks per payment,
+     * completionDetectionMs divided by completionsDetected the mean time to
+     * notice a completed payment.
+     * 
+     * @param policy Polling policy
+     */
+    void setPollingPolicy(const PollingPolicy& policy);
+    
+    /**
+     * @brief Receive payment status changes over a push channel
+     * 
+     * A ws:// or wss:// endpoint opens a WebSocket on which the active
+     * payments are subscribed to. An http:// or https:// endpoint opens a
+     * single Server-Sent Events stream instead, for networks that block
+     * WebSockets; it carries all of the merchant's payment events. Push
+     * events are not signed, so on either channel only those of payments
+     * this instance is checking are used; the rest need a signed webhook.
+     * 
+     * Status changes arrive as soon as the server sees them. While the
+     * channel is healthy, status checks only run once a minute as a safety
+     * net; when it drops or goes quiet, checks return to the polling policy
+     * and a poll goes out at once. Reconnects resume after the last event
+     * sequence received, so no change is missed.
+     * 
+     * @param pushEndpoint WebSocket or event stream URL; empty disables push
+     */
+    void setPushEndpoint(const QString& pushEndpoint);
+    
+    /**
+     * @brief Check whether the push channel is delivering events
+     * @return Whether the channel is connected and subscribed
+     */
+    bool pushHealthy() const { return m_pushHealthy; }
+    
+    /**
+     * @brief Configure the per-endpoint circuit breakers
+     * @param failureThreshold Failure ratio among recent replies that opens the circuit
+     * @param openMs Milliseconds to fail fast before probing the endpoint again
+     */
+    void setCircuitBreakerPolicy(double failureThreshold, int openMs);
+    
+    /**
+     * @brief Enable hedged GET requests
+     * 
+     * When enabled, a GET that has not been answered within the p95 latency
+     * of its endpoint is sent a second time; the first reply wins and the
+     * other request is aborted.
+     * 
+     * @param enabled Whether to hedge GET requests
+     */
+    void setHedgingEnabled(bool enabled);
+    
+    /**
+     * @brief Configure the warm connection pool
+     * 
+     * Connections to the API endpoint are opened at construction and after
+     * setApiEndpoint(), so the first request does not pay for DNS, TCP and
+     * TLS. While no request is sent for keepAliveIntervalMs, each warm
+     * connection is pinged with a HEAD request to keep it open. Pings are
+     * charged to the rate budget of other requests, and they stop once no
+     * API request has been made for keepAliveIdleMs; the next request
+     * opens the connections again.
+     * 
+     * @param warmConnections Number of connections to keep open (Qt allows up to 6 per host)
+     * @param keepAliveIntervalMs Idle time before pinging; 0 disables pings
+     * @param keepAliveIdleMs Idle time after which pinging stops; 0 pings indefinitely
+     */
+    void setConnectionPoolPolicy(int warmConnections, int keepAliveIntervalMs, int keepAliveIdleMs = 300000);
+    
+    /**
+     * @brief Enable HTTP/2 for API requests
+     * 
+     * When enabled, HTTP/2 is offered to the API endpoint and all requests
+     * are multiplexed over one connection instead of queueing behind the
+     * per-host HTTP/1.1 connection limit. Servers that do not negotiate
+     * HTTP/2 are used over HTTP/1.1 as before; after an HTTP/2 protocol
+     * failure the SDK falls back to HTTP/1.1 and resends the request.
+     * 
+     * @param enabled Whether to offer HTTP/2
+     */
+    void setHttp2Enabled(bool enabled);
+    
+    /**
+     * @brief Compress large request bodies
+     * 
+     * Bodies of at least the given size are sent with Content-Encoding:
+     * deflate when that makes them smaller. Only enable this for servers
+     * that accept compressed requests. Responses are always requested
+     * with gzip/deflate and decompressed as they arrive.
+     * 
+     * @param bytes Minimum body size to compress; 0 disables compression
+     */
+    void setRequestCompressionThreshold(int bytes);
+    
+    /**
+     * @brief Cap the number of requests a scheduling lane may have in flight
+     * 
+     * Queued requests are sent in lane order, so interactive requests never
+     * wait behind normal or background ones for rate limit tokens. Capping
+     * the lower lanes keeps connections free for checkout traffic; by
+     * default normal requests may use 3 and background requests 2 of the 6
+     * connections Qt opens per host.
+     * 
+     * @param priority Scheduling lane
+     * @param maxInFlight Maximum requests in flight; 0 removes the cap
+     */
+    void setLaneConcurrency(RequestPriority priority, int maxInFlight);
+    
+    /**
+     * @brief Get end-to-end latency of a scheduling lane
+     * @param priority Scheduling lane
+     * @param percentile Percentile (0.0 - 1.0)
+     * @return Latency from submission to reply in milliseconds, including
+     *         time spent queued, or -1 if there are too few samples
+     */
+    int laneLatency(RequestPriority priority, double percentile) const {
+        return m_laneLatencies.value(priority).percentile(percentile);
+    }
+    
+    /**
+     * @brief Enable the durable outbound queue for payment operations
+     * 
+     * createPayment and cancelPayment are written to the given file before
+     * they are sent and removed once the server has answered. Operations
+     * that fail because the API cannot be reached are kept instead of
+     * being reported through error(), and are resent through the normal
+     * rate limits when connectivity returns, including after a restart.
+     * Operations on the same payment are sent one at a time, in order.
+     * Results arrive through the usual signals.
+     * 
+     * An empty path is refused while operations are still queued, since
+     * they could no longer be kept on disk; wait until
+     * outboundQueueDepth() is 0.
+     * 
+     * @param filePath Queue file; an empty path disables the queue
+     */
+    void setOutboundQueuePath(const QString& filePath);
+    
+    /**
+     * @brief Get the number of payment operations waiting in the outbound queue
+     * @return Queue depth, including operations currently in flight
+     */
+    int outboundQueueDepth() const { return m_outboundOperations.size(); }
+    
+    /**
+     * @brief Get the age of the oldest operation in the outbound queue
+     * @return Age in milliseconds, or 0 if the queue is empty
+     */
+    qint64 outboundQueueOldestAge() const;
+    
+    /**
+     * @brief Get network statistics
+     * @return Counters accumulated since construction or the last reset
+     */
+    RequestStatistics statistics() const { return m_statistics; }
+    
+    /**
+     * @brief Reset network statistics
+     */
+    void resetStatistics() { m_statistics = RequestStatistics(); }
+    
+    /**
+     * @brief Get API key
+     * @return API key
+     */
+    QString apiKey() const { return m_apiKey; }
+    
+    /**
+     * @brief Get merchant ID
+     * @return Merchant ID
+     */
+    QString merchantId() const { return m_merchantId; }
+    
+    /**
+     * @brief Get country code
+     * @return Country code
+     */
+    CountryCode countryCode() const { return m_countryCode; }
+    
+    /**
+     * @brief Get country code as string
+     * @return Two-letter country code string
+     */
+    QString countryCodeString() const { return countryCodeToString(m_countryCode); }
+    
+    /**
+     * @brief Get test mode
+     * @return Whether test mode is enabled
+     */
+    bool testMode() const { return m_testMode; }
+    
+    /**
+     * @brief Get API endpoint
+     * @return API endpoint requests are currently sent to
+     */
+    QString apiEndpoint() const { return m_apiEndpoint; }
+    
+    /**
+     * @brief Get supported cryptocurrencies
+     * @return List of supported cryptocurrencies
+     */
+    QStringList supportedCryptocurrencies() const { return m_supportedCryptocurrencies; }
+    
+    /**
+     * @brief Create a new cryptocurrency payment
+     * @param paymentDetails Payment details
+     * @param options Per-call options such as a deadline
+     * @return Handle to cancel the operation
+     */
+    RequestHandle createPayment(const PaymentDetails& paymentDetails, const RequestOptions& options = RequestOptions());
+    
+    /**
+     * @brief Get payment details by ID
+     * 
+     * Calls made while a request for the same payment is still in flight
+     * share that request, its deadline and its single paymentRetrieved
+     * emission.
+     * 
+     * @param paymentId Payment ID
+     * @param options Per-call options such as a deadline
+     * @return Handle to cancel the operation
+     */
+    RequestHandle getPayment(const QString& paymentId, const RequestOptions& options = RequestOptions());
+    
+    /**
+     * @brief Get list of payments
+     * @param filters Filter parameters
+     * @param options Per-call options such as a deadline
+     * @return Handle to cancel the operation
+     */
+    RequestHandle getPayments(const PaymentFilters& filters = PaymentFilters(), const RequestOptions& options = RequestOptions());
+    
+    /**
+     * @brief Walk every page of the payment list matching the filters
+     * 
+     * Pages are requested ahead of the one being delivered and emitted in
+     * order through paymentHistoryPage(), followed by
+     * paymentHistoryFinished() once has_more/total show the end was
+     * reached. A failed page stops the walk and is reported through error().
+     * 
+     * @param filters Filter parameters; limit sets the page size and offset the starting point
+     * @param concurrency Number of pages requested or waiting for delivery at a time (requests are further
+     *                    capped by the background lane)
+     * @param options Per-call options applied to every page request
+     * @return Handle to cancel the remaining pages
+     */
+    RequestHandle streamPaymentHistory(const PaymentFilters& filters = PaymentFilters(), int concurrency = 2,
+                                       const RequestOptions& options = RequestOptions());
+    
+    /**
+     * @brief Fetch the payments that changed since the last sync
+     * 
+     * Keeps a high-water mark (updated_at and id of the last payment
+     * received) that is advanced after every page and persisted with
+     * QSettings per merchant and mode, so catching up after a restart only
+     * downloads the changes. Pages are emitted through paymentsSynced(),
+     * followed by paymentSyncFinished(). A sync already running is joined.
+     * 
+     * @param pageSize Number of changes requested per page
+     * @return Handle to cancel the sync; the mark keeps the progress made
+     */
+    RequestHandle syncPayments(int pageSize = 100);
+    
+    /**
+     * @brief Move the sync high-water mark
+     * @param updatedSince Time to sync from; an invalid time makes the next
+     *                     sync download the whole history
+     */
+    void resetPaymentSync(const QDateTime& updatedSince = QDateTime());
+    
+    /**
+     * @brief Get the sync high-water mark
+     * @return updated_at of the last payment synced, or an invalid time if none
+     */
+    QDateTime paymentSyncMark();
+    
+    /**
+     * @brief Cancel a payment
+     * @param paymentId Payment ID
+     * @param options Per-call options such as a deadline
+     * @return Handle to cancel the operation
+     */
+    RequestHandle cancelPayment(const QString& paymentId, const RequestOptions& options = RequestOptions());
+    
+    /**
+     * @brief Get current exchange rates
+     * @param baseCurrency Base currency
+     * @param cryptoCurrencies List of cryptocurrencies to get rates for
+     * @param options Per-call options such as a deadline
+     * @return Handle to cancel the operation
+     */
+    RequestHandle getExchangeRates(const QString& baseCurrency, const QStringList& cryptoCurrencies = QStringList(),
+                                   const RequestOptions& options = RequestOptions());
+    
+    /**
+     * @brief Verify webhook signature
+     * @param signature Webhook signature
+     * @param body Raw webhook body
+     * @return Whether signature is valid
+     */
+    bool verifyWebhookSignature(const QString& signature, const QString& body);
+    
+    /**
+     * @brief Process webhook event
+     * @param event Webhook event
+     * @param signature Webhook signature
+     * @return Whether event was processed successfully
+     */
+    bool processWebhookEvent(const QJsonObject& event, const QString& signature);
+    
+    /**
+     * @brief Download QR code image
+     * @param url QR code URL
+     * @param options Per-call options such as a deadline
+     * @return Handle to cancel the operation
+     */
+    RequestHandle downloadQrCode(const QString& url, const RequestOptions& options = RequestOptions());
+    
+    /**
+     * @brief Cancel an operation
+     * 
+     * Aborts the network request and forgets the operation; no signal is
+     * emitted for it afterwards.
+     * 
+     * @param requestId Request ID from a RequestHandle
+     * @return Whether an operation still running was cancelled
+     */
+    bool cancelRequest(quint64 requestId);
+    
+signals:
+    /**
+     * @brief Emitted when payment is created
+     * @param payment Payment object
+     */
+    void paymentCreated(const Payment& payment);
+    
+    /**
+     * @brief Emitted when payment is retrieved
+     * 
+     * Answers getPayment() calls; status checks do not emit it. A reply
+     * older than the state already reported for a tracked payment carries
+     * that newer state instead.
+     * 
+     * @param payment Payment object
+     */
+    void paymentRetrieved(const Payment& payment);
+    
+    /**
+     * @brief Emitted when payments list is retrieved
+     * @param payments List of payments
+     * @param total Total number of payments
+     */
+    void paymentsRetrieved(const QList<Payment>& payments, int total);
+    
+    /**
+     * @brief Emitted for each payment of a getPayments page as it arrives
+     * 
+     * Precedes paymentsRetrieved() for the same page. A page that fails
+     * part-way and is retried is streamed again from the start.
+     * 
+     * @param payment Payment
+     */
+    void paymentStreamed(const Payment& payment);
+    
+    /**
+     * @brief Emitted for each page of a payment history walk, in order
+     * @param streamId Request ID of the handle returned by streamPaymentHistory()
+     * @param payments Payments of the page
+     */
+    void paymentHistoryPage(quint64 streamId, const QList<Payment>& payments);
+    
+    /**
+     * @brief Emitted when a payment history walk has delivered every page
+     * @param streamId Request ID of the handle returned by streamPaymentHistory()
+     * @param count Number of payments delivered
+     */
+    void paymentHistoryFinished(quint64 streamId, int count);
+    
+    /**
+     * @brief Emitted for each page of changes fetched by syncPayments()
+     * @param payments Changed payments, oldest change first
+     */
+    void paymentsSynced(const QList<Payment>& payments);
+    
+    /**
+     * @brief Emitted when syncPayments() has caught up
+     * @param count Number of changed payments received
+     */
+    void paymentSyncFinished(int count);
+    
+    /**
+     * @brief Emitted when requests move to another regional endpoint
+     * @param apiEndpoint API endpoint now in use
+     */
+    void apiEndpointChanged(const QString& apiEndpoint);
+    
+    /**
+     * @brief Emitted when the push channel becomes healthy or falls back to polling
+     * @param healthy Whether status changes arrive over the push channel
+     */
+    void pushChannelChanged(bool healthy);
+    
+    /**
+     * @brief Emitted when payment is cancelled
+     * @param payment Payment object
+     */
+    void paymentCancelled(const Payment& payment);
+    
+    /**
+     * @brief Emitted when exchange rates are retrieved
+     * @param baseCurrency Base currency
+     * @param rates Map of cryptocurrency to exchange rate
+     */
+    void exchangeRatesRetrieved(const QString& baseCurrency, const QVariantMap& rates);
+    
+    /**
+     * @brief Emitted when QR code is downloaded
+     * @param pixmap QR code image
+     */
+    void qrCodeDownloaded(const QPixmap& pixmap);
+    
+    /**
+     * @brief Emitted when payment status is updated
+     * 
+     * Status checks, webhooks and the push channel are merged per payment
+     * by version, then updated_at, then status progress, so each change is
+     * emitted once and a late delivery never moves a payment back.
+     * 
+     * @param payment Payment object
+     */
+    void paymentStatusUpdated(const Payment& payment);
+    
+    /**
+     * @brief Emitted when error occurs
+     * @param errorCode Error code
+     * @param errorMessage Error message
+     */
+    void error(int errorCode, const QString& errorMessage);
+    
+private slots:
+    void onNetworkReply(QNetworkReply* reply);
+    void onQrCodeDownloaded(QNetworkReply* reply);
+    void onStreamedReplyData(QNetworkReply* reply);
+    void checkPaymentStatus();
+    void pollDuePayments();
+    void drainRequestQueues();
+    void connectPushChannel();
+    void onPushConnected();
+    void onPushDisconnected();
+    void onPushMessage(const QString& message);
+    void onPushStreamData();
+    void onPushStreamFinished();
+    void checkPushHealth();
+    
+private:
+    // Configuration
+    QString m_apiKey;
+    QString m_merchantId;
+    CountryCode m_countryCode;
+    bool m_testMode = false;
+    QString m_apiEndpoint = "https://api.asiancryptopay.com";
+    QStringList m_supportedCryptocurrencies;
+    QVariantMap m_webhookConfig;
+    
+    // Network; the manager is shared by every instance in the process
+    QNetworkAccessManager* m_networkManager;
+    
+    // Request templates, rebuilt only when the configuration changes
+    QNetworkRequest m_requestTemplate;
+    QString m_apiEndpointPrefix;
+    
+    // Modules
+    std::unique_ptr<CountryComplianceModule> m_countryModule;
+    std::unique_ptr<SecurityModule> m_securityModule;
+    
+    // Active payments; status checks share one timer through the wheel
+    struct StatusCheckState {
+        int checks = 0;
+        qint64 notBefore = 0;
+    };
+    
+    // Last state reported per payment, kept after tracking ends so late
+    // deliveries can still be recognised
+    struct PaymentRevision {
+        qint64 version = 0;
+        QDateTime updatedAt;
+        PaymentStatus status = PaymentStatus::Created;
+    };
+    
+    QMap<QString, Payment> m_activePayments;
+    QCache<QString, PaymentRevision> m_paymentRevisions{1024};
+    PollingPolicy m_pollingPolicy;
+    QHash<QString, StatusCheckState> m_statusCheckStates;
+    TimerWheel m_statusChecks;
+    QElapsedTimer m_statusCheckClock;
+    QTimer* m_statusCheckTimer;
+    
+    // Push channel; status checks slow down while it is healthy
+    static const int pushPingIntervalMs = 10000;
+    QWebSocket* m_pushSocket = nullptr;
+    QNetworkReply* m_pushStreamReply = nullptr;
+    QByteArray m_pushStreamBuffer;
+    QString m_pushEndpoint;
+    QTimer* m_pushReconnectTimer;
+    QTimer* m_pushPingTimer;
+    qint64 m_pushSequence = 0;
+    qint64 m_pushLastPong = 0;
+    int m_pushReconnectAttempts = 0;
+    bool m_pushHealthy = false;
+    
+    // Batched status polling
+    QSet<QString> m_duePaymentChecks;
+    QTimer* m_pollBatchTimer;
+    bool m_batchPollingSupported = true;
+    
+    // Request tracking
+    // Request serialized once, ready to be signed and sent
+    struct PreparedRequest {
+        QString endpoint;
+        QByteArray method;
+        QByteArray body;
+        QByteArray encodedBody;
+        QByteArray idempotencyKey;
+    };
+    
+    // Validators and decoded body of a GET response, keyed by URL; streamed
+    // list pages keep their payments apart from the envelope
+    struct CachedResponse {
+        QByteArray etag;
+        QByteArray lastModified;
+        QJsonObject response;
+        QList<Payment> payments;
+    };
+    
+    // Endpoint classes with separate documented rate limits
+    enum class EndpointClass {
+        PaymentsPost,
+        PaymentsGet,
+        ExchangeRates,
+        Other
+    };
+    
+    // Fixed method and rate limit class of each operation, so replies are
+    // dispatched on the type they were created with
+    struct Route {
+        const char* method;
+        EndpointClass endpointClass;
+    };
+    
+    static Route routeFor(RequestType type) {
+        switch (type) {
+            case RequestType::CreatePayment:
+            case RequestType::CancelPayment:
+                return {"POST", EndpointClass::PaymentsPost};
+            case RequestType::GetPayment:
+            case RequestType::GetPayments:
+            case RequestType::PollPayments:
+                return {"GET", EndpointClass::PaymentsGet};
+            case RequestType::GetExchangeRates:
+                return {"GET", EndpointClass::ExchangeRates};
+            case RequestType::DownloadQrCode:
+                break;
+        }
+        return {"GET", EndpointClass::Other};
+    }
+    
+    // Names of the operations in the outbound queue file, which outlive
+    // the numbering of RequestType
+    static QString outboundTypeName(RequestType type) {
+        switch (type) {
+            case RequestType::CreatePayment: return "create_payment";
+            case RequestType::CancelPayment: return "cancel_payment";
+            default: return QString();
+        }
+    }
+    
+    static bool outboundTypeFromName(const QString& name, RequestType& type) {
+        if (name == "create_payment") {
+            type = RequestType::CreatePayment;
+        } else if (name == "cancel_payment") {
+            type = RequestType::CancelPayment;
+        } else {
+            return false;
+        }
+        return true;
+    }
+    
+    struct RequestContext {
+        RequestType type;
+        QString id;
+        PreparedRequest request;
+        EndpointClass endpointClass = EndpointClass::Other;
+        int rateLimitedCount = 0;
+        int attempt = 1;
+        quint64 requestId = 0;
+        qint64 sentAt = 0;
+        qint64 submittedAt = 0;
+        qint64 deadline = 0;
+        RequestPriority priority = RequestPriority::Normal;
+        bool hedge = false;
+        bool refetched = false;
+        QString region;             // API endpoint the request went to
+        quint64 historyId = 0;      // History walk a page belongs to
+        int offset = 0;             // Offset of that history page
+        quint64 syncId = 0;         // Sync a page belongs to
+        bool statusCheck = false;   // Fetched to check a tracked payment
+        QStringList paymentIds;     // Payments a batched poll asks for
+    };
+    
+    QHash<QNetworkReply*, RequestContext> m_pendingRequests;
+    QMap<quint64, QList<QNetworkReply*>> m_inflightReplies;
+    QSet<quint64> m_liveRequests;
+    QMap<quint64, QSet<quint64>> m_requestAttachments;  // Handles waiting on a coalesced request
+    QHash<quint64, quint64> m_attachedHandles;          // Attached handle -> request it waits on
+    quint64 m_nextRequestId = 1;
+    QMap<QString, quint64> m_inflightPaymentFetches;
+    
+    // Rate limiting; budgets are shared by instances using the same API key
+    QMap<EndpointClass, TokenBucket>& m_rateLimits;
+    QMap<EndpointClass, QList<RequestContext>> m_requestQueues;
+    QTimer* m_schedulerTimer;
+    
+    // Scheduling lanes
+    QMap<RequestPriority, int> m_laneLimits;
+    QMap<RequestPriority, int> m_laneInFlight;
+    QMap<RequestPriority, LatencyTracker> m_laneLatencies;
+    
+    // Retries and statistics
+    QMap<RequestType, RetryPolicy> m_retryPolicies;
+    RequestStatistics m_statistics;
+    
+    // Failure isolation and tail latency
+    QMap<EndpointClass, CircuitBreaker> m_circuitBreakers;
+    QMap<EndpointClass, LatencyTracker> m_latencies;
+    bool m_hedgingEnabled = false;
+    
+    // Warm connections
+    QTimer* m_prewarmTimer;
+    QTimer* m_keepAliveTimer;
+    int m_warmConnections = 2;
+    int m_keepAliveIntervalMs = 30000;
+    int m_keepAliveIdleMs = 300000;
+    qint64 m_lastNetworkActivity = 0;
+    qint64 m_lastApiRequestAt = 0;
+    
+    // Regional endpoints; m_apiEndpoint is the active one
+    struct ApiRegion {
+        QString endpoint;
+        double rttMs = -1;          // Smoothed probe round trip, -1 until measured
+        int failures = 0;           // Consecutive transient request failures
+        int cleanProbes = 0;        // Consecutive good probes since it was marked unhealthy
+        qint64 unhealthySince = 0;  // When it was marked unhealthy, 0 while healthy
+        qint64 unhealthyUntil = 0;  // Not routed to before this time
+    };
+    
+    QVector<ApiRegion> m_regions;
+    int m_activeRegion = 0;
+    int m_regionProbeIntervalMs = 30000;
+    QTimer* m_regionProbeTimer;
+    QHash<QNetworkReply*, QString> m_regionProbes;
+    
+    // HTTP/2 transport
+    bool m_http2Enabled = false;
+    bool m_http2FellBack = false;
+    
+    // Conditional GET cache; the least recently used entries are evicted
+    QCache<QString, CachedResponse> m_responseCache{256};
+    
+    // getPayments pages decoded while they arrive
+    struct StreamedPage {
+        PaymentListStreamParser parser;
+        QList<Payment> payments;
+        quint64 bytes = 0;
+        bool announce = true;
+    };
+    
+    QHash<QNetworkReply*, StreamedPage> m_streamedPages;
+    
+    // Payment history walks; pages are keyed by offset
+    struct PaymentHistory {
+        PaymentFilters filters;
+        RequestOptions options;
+        int concurrency = 2;
+        int nextOffset = 0;
+        int deliverOffset = 0;
+        int endOffset = INT_MAX;
+        int delivered = 0;
+        QMap<int, quint64> pageRequests;
+        QMap<int, QList<Payment>> readyPages;
+    };
+    
+    QMap<quint64, PaymentHistory> m_paymentHistories;
+    
+    // Incremental sync; the mark is loaded from QSettings on first use
+    bool m_syncMarkLoaded = false;
+    QDateTime m_syncUpdatedAt;
+    QString m_syncAfterId;
+    quint64 m_syncId = 0;
+    quint64 m_syncPageRequest = 0;
+    int m_syncPageSize = 100;
+    int m_syncCount = 0;
+    
+    // Request compression
+    int m_requestCompressionThreshold = 0;
+    
+    // Durable outbound queue; operations sharing a key are sent in sequence
+    struct OutboundOperation {
+        QString key;
+        qint64 queuedAt = 0;
+        bool parked = false;
+        RequestContext context;
+    };
+    
+    QString m_outboundQueuePath;
+    QMap<quint64, OutboundOperation> m_outboundOperations;
+    quint64 m_nextOutboundSequence = 1;
+    QTimer* m_outboundTimer;
+    
+    // Methods
+    static QNetworkAccessManager* sharedNetworkManager();
+    static QMap<EndpointClass, TokenBucket>& sharedRateLimits(const QString& apiKey);
+    void validatePaymentDetails(const PaymentDetails& paymentDetails);
+    void rebuildRequestTemplate();
+    void prewarmConnections();
+    bool http2Active() const { return m_http2Enabled && !m_http2FellBack; }
+    bool fallBackFromHttp2(QNetworkReply* reply, RequestContext& context);
+    bool decodeResponse(QNetworkReply* reply, const RequestContext& context, QJsonObject& response);
+    void cacheResponse(QNetworkReply* reply, const RequestContext& context, const QJsonObject& response,
+                       const QList<Payment>& payments = QList<Payment>());
+    QList<Payment> feedStreamedPage(StreamedPage& page, const QByteArray& data);
+    static QString paymentsEndpoint(const PaymentFilters& filters);
+    void requestHistoryPages(quint64 historyId);
+    void handleHistoryPage(const RequestContext& context, const QList<Payment>& payments, const QJsonObject& response);
+    void deliverHistoryPages(quint64 historyId);
+    void abortPaymentHistory(quint64 historyId);
+    void requestSyncPage();
+    void handleSyncPage(const RequestContext& context, const QList<Payment>& payments, const QJsonObject& response);
+    void loadSyncMark();
+    void saveSyncMark();
+    QString syncSettingsGroup() const;
+    bool submitOutboundOperation(const RequestContext& context);
+    bool parkOutboundOperation(const RequestContext& context);
+    void completeOutboundOperation(quint64 requestId);
+    void drainOutboundQueue();
+    void loadOutboundQueue();
+    void saveOutboundQueue();
+    void sendKeepAlive();
+    void probeRegions();
+    void handleRegionProbe(QNetworkReply* reply);
+    void recordRegionOutcome(const QString& endpoint, bool failed, qint64 sentAt, qint64 now);
+    void updateActiveRegion();
+    PreparedRequest prepareApiRequest(const QString& endpoint, const QString& method, const QJsonObject& data) const;
+    QNetworkRequest createApiRequest(const PreparedRequest& prepared, RequestPriority priority = RequestPriority::Normal);
+    QNetworkReply* sendPreparedRequest(const PreparedRequest& prepared, RequestPriority priority = RequestPriority::Normal);
+    quint64 makeApiRequest(RequestType type, const QString& endpoint, const QString& paymentId = QString(),
+                           const QJsonObject& data = QJsonObject(), const RequestOptions& options = RequestOptions());
+    RequestContext newRequestContext(RequestType type, const QString& endpoint, const QString& paymentId,
+                                     const QJsonObject& data, const RequestOptions& options);
+    quint64 submitRequest(RequestContext& context);
+    void enqueueRequest(const RequestContext& context, bool retry = false);
+    void dispatchRequest(const RequestContext& context);
+    void scheduleQueueDrain();
+    static RequestPriority defaultPriority(RequestType type);
+    bool laneHasCapacity(RequestPriority priority) const;
+    bool handleRateLimitHeaders(QNetworkReply* reply, RequestContext& context);
+    bool retryRequest(QNetworkReply* reply, RequestContext& context);
+    bool refetchUncachedResponse(QNetworkReply* reply, RequestContext& context);
+    static bool isTransientFailure(QNetworkReply* reply);
+    void failRequest(const RequestContext& context, int errorCode, const QString& errorMessage);
+    void sendHedgeRequest(quint64 requestId);
+    bool resolveHedgedReply(QNetworkReply* reply, const RequestContext& context);
+    void armDeadline(quint64 requestId, qint64 deadline);
+    void expireRequest(quint64 requestId);
+    bool releaseHandle(quint64 handleId, quint64& abandonedRequest);
+    void abandonRequest(quint64 requestId);
+    void finishRequest(quint64 requestId);
+    void startPaymentStatusCheck(const Payment& payment);
+    void stopPaymentStatusCheck(const QString& paymentId);
+    Payment applyPolledPayment(const Payment& payment);
+    bool acceptPaymentRevision(const Payment& payment);
+    RequestHandle fetchPayment(const QString& paymentId, bool statusCheck, const RequestOptions& options);
+    void scheduleStatusCheck(const QString& paymentId);
+    void checkAllPaymentsNow();
+    void setPushHealthy(bool healthy);
+    void sendPushSubscription(const QString& type, const QStringList& paymentIds);
+    bool pushChannelOpen() const;
+    void closePushChannel();
+    bool dispatchPaymentEvent(const QJsonObject& event, bool verified);
+    void applyPollHint(QNetworkReply* reply, const RequestContext& context);
+    void handlePollReply(const QStringList& paymentIds, const QJsonObject& response);
+    void pollPaymentsIndividually(const QStringList& paymentIds);
+};
+
+inline RequestHandle::RequestHandle(AsianCryptoPayment* owner, quint64 requestId)
+    : m_owner(owner)
+    , m_requestId(requestId) {}
+
+inline bool RequestHandle::cancel() {
+    return m_owner && m_owner->cancelRequest(m_requestId);
+}
+
+/**
+ * @brief Security module for cryptographic operations
+ */
+class SecurityModule {
+public:
+    /**
+     * @brief Constructor
+     * @param apiKey API key for signature generation
+     */
+    SecurityModule(const QString& apiKey)
+        : m_apiKey(apiKey)
+        , m_requestMac(QCryptographicHash::Sha256, apiKey.toUtf8()) {}
+    
+    /**
+     * @brief Generate signature for API request
+     * @param payload Request payload
+     * @param timestamp Request timestamp
+     * @return Signature
+     */
+    QString generateSignature(const QString& payload, const QString& timestamp) {
+        QString message = timestamp + "." + payload;
+        return hmacSha256(m_apiKey, message);
+    }
+    
+    /**
+     * @brief Generate signature for a serialized API request body
+     * 
+     * Signs the exact bytes that are sent, reusing the keyed HMAC state
+     * instead of building an intermediate message string.
+     * 
+     * @param payload Serialized request body
+     * @param timestamp Request timestamp
+     * @return Hex-encoded signature
+     */
+    QByteArray generateSignature(const QByteArray& payload, const QByteArray& timestamp) {
+        m_requestMac.reset();
+        m_requestMac.addData(timestamp);
+        m_requestMac.addData(".", 1);
+        m_requestMac.addData(payload);
+        return m_requestMac.result().toHex();
+    }
+    
+    /**
+     * @brief Verify webhook signature
+     * @param signature Webhook signature
+     * @param payload Webhook payload
+     * @param secret Webhook secret
+     * @return Whether signature is valid
+     */
+    bool verifySignature(const QString& signature, const QString& payload, const QString& secret) {
+        QString expectedSignature = hmacSha256(secret, payload);
+        return expectedSignature == signature;
+    }
+    
+private:
+    QString m_apiKey;
+    QMessageAuthenticationCode m_requestMac;
+    
+    /**
+     * @brief Generate HMAC-SHA256 signature
+     * @param key Secret key
+     * @param message Message to sign
+     * @return HMAC-SHA256 signature
+     */
+    QString hmacSha256(const QString& key, const QString& message) {
+        return QMessageAuthenticationCode::hash(
+            message.toUtf8(),
+            key.toUtf8(),
+            QCryptographicHash::Sha256
+        ).toHex();
+    }
+};
+
+/**
+ * @brief Interface for country-specific compliance modules
+ */
+class CountryComplianceModule {
+public:
+    virtual ~CountryComplianceModule() {}
+    
+    /**
+     * @brief Validate payment according to country-specific regulations
+     * @param paymentDetails Payment details
+     * @throws std::invalid_argument if validation fails
+     */
+    virtual void validatePayment(const PaymentDetails& paymentDetails) = 0;
+    
+    /**
+     * @brief Get country name
+     * @return Country name
+     */
+    virtual QString countryName() const = 0;
+    
+    /**
+     * @brief Get currency code
+     * @return Currency code
+     */
+    virtual QString currencyCode() const = 0;
+    
+    /**
+     * @brief Get regulator name
+     * @return Regulator name
+     */
+    virtual QString regulator() const = 0;
+    
+    /**
+     * @brief Get KYC threshold
+     * @return KYC threshold
+     */
+    virtual double kycThreshold() const = 0;
+};
+
+/**
+ * @brief Malaysia compliance module
+ */
+class MalaysiaComplianceModule : public CountryComplianceModule {
+public:
+    void validatePayment(const PaymentDetails& paymentDetails) override {
+        if (currencyCode() == paymentDetails.currency()) {
+            if (paymentDetails.amount() >= kycThreshold() && 
+                    paymentDetails.customerName().isEmpty()) {
+                throw std::invalid_argument("KYC information required for payments above " + 
+                        QString::number(kycThreshold()).toStdString() + " " + currencyCode().toStdString());
+            }
+        }
+    }
+    
+    QString countryName() const override { return "Malaysia"; }
+    QString currencyCode() const override { return "MYR"; }
+    QString regulator() const override { return "Securities Commission Malaysia (SC)"; }
+    double kycThreshold() const override { return 3000.0; }
+};
+
+/**
+ * @brief Singapore compliance module
+ */
+class SingaporeComplianceModule : public CountryComplianceModule {
+public:
+    void validatePayment(const PaymentDetails& paymentDetails) override {
+        if (currencyCode() == paymentDetails.currency()) {
+            if (paymentDetails.amount() >= kycThreshold() && 
+                    (paymentDetails.customerName().isEmpty() || paymentDetails.customerEmail().isEmpty())) {
+                throw std::invalid_argument("KYC information (name and email) required for payments above " + 
+                        QString::number(kycThreshold()).toStdString() + " " + currencyCode().toStdString());
+            }
+            
+            // Travel Rule compliance
+            if (paymentDetails.amount() >= 1000.0) {
+                qDebug() << "Travel Rule applies to this transaction";
+                // Additional Travel Rule implementation would go here
+            }
+        }
+    }
+    
+    QString countryName() const override { return "Singapore"; }
+    QString currencyCode() const override { return "SGD"; }
+    QString regulator() const override { return "Monetary Authority of Singapore (MAS)"; }
+    double kycThreshold() const override { return 1000.0; }
+};
+
+/**
+ * @brief Indonesia compliance module
+ */
+class IndonesiaComplianceModule : public CountryComplianceModule {
+public:
+    void validatePayment(const PaymentDetails& paymentDetails) override {
+        if (currencyCode() == paymentDetails.currency()) {
+            if (paymentDetails.amount() >= kycThreshold() && 
+                    paymentDetails.customerName().isEmpty()) {
+                throw std::invalid_argument("KYC information required for payments above " + 
+                        QString::number(kycThreshold()).toStdString() + " " + currencyCode().toStdString());
+            }
+        }
+    }
+    
+    QString countryName() const override { return "Indonesia"; }
+    QString currencyCode() const override { return "IDR"; }
+    QString regulator() const override { return "Commodity Futures Trading Regulatory Agency (Bappebti)"; }
     double kycThreshold() const override { return 2000000.0; }
 };
 
-/**
- * @brief Thailand compliance module
- */
-class ThailandComplianceModule : public CountryComplianceModule {
-public:
-    void validatePayment(const PaymentDetails& paymentDetails) override {
-        if (currencyCode() == paymentDetails.currency()) {
-            if (paymentDetails.amount() >= kycThreshold() && 
-                    paymentDetails.customerName().isEmpty()) {
-                throw std::invalid_argument("KYC information required for payments above " + 
-                        QString::number(kycThreshold()).toStdString() + " " + currencyCode().toStdString());
+/**
+ * @brief Thailand compliance module
+ */
+class ThailandComplianceModule : public CountryComplianceModule {
+public:
+    void validatePayment(const PaymentDetails& paymentDetails) override {
+        if (currencyCode() == paymentDetails.currency()) {
+            if (paymentDetails.amount() >= kycThreshold() && 
+                    paymentDetails.customerName().isEmpty()) {
+                throw std::invalid_argument("KYC information required for payments above " + 
+                        QString::number(kycThreshold()).toStdString() + " " + currencyCode().toStdString());
+            }
+        }
+    }
+    
+    QString countryName() const override { return "Thailand"; }
+    QString currencyCode() const override { return "THB"; }
+    QString regulator() const override { return "Securities and Exchange Commission (SEC)"; }
+    double kycThreshold() const override { return 50000.0; }
+};
+
+/**
+ * @brief Brunei compliance module
+ */
+class BruneiComplianceModule : public CountryComplianceModule {
+public:
+    void validatePayment(const PaymentDetails& paymentDetails) override {
+        if (currencyCode() == paymentDetails.currency()) {
+            if (paymentDetails.amount() >= kycThreshold() && 
+                    paymentDetails.customerName().isEmpty()) {
+                throw std::invalid_argument("KYC information required for payments above " + 
+                        QString::number(kycThreshold()).toStdString() + " " + currencyCode().toStdString());
+            }
+        }
+    }
+    
+    QString countryName() const override { return "Brunei"; }
+    QString currencyCode() const override { return "BND"; }
+    QString regulator() const override { return "Autoriti Monetari Brunei Darussalam (AMBD)"; }
+    double kycThreshold() const override { return 5000.0; }
+};
+
+/**
+ * @brief Cambodia compliance module
+ */
+class CambodiaComplianceModule : public CountryComplianceModule {
+public:
+    void validatePayment(const PaymentDetails& paymentDetails) override {
+        if (currencyCode() == paymentDetails.currency()) {
+            if (paymentDetails.amount() >= kycThreshold() && 
+                    paymentDetails.customerName().isEmpty()) {
+                throw std::invalid_argument("KYC information required for payments above " + 
+                        QString::number(kycThreshold()).toStdString() + " " + currencyCode().toStdString());
+            }
+        }
+    }
+    
+    QString countryName() const override { return "Cambodia"; }
+    QString currencyCode() const override { return "KHR"; }
+    QString regulator() const override { return "National Bank of Cambodia (NBC)"; }
+    double kycThreshold() const override { return 4000000.0; }
+};
+
+/**
+ * @brief Vietnam compliance module
+ */
+class VietnamComplianceModule : public CountryComplianceModule {
+public:
+    void validatePayment(const PaymentDetails& paymentDetails) override {
+        if (currencyCode() == paymentDetails.currency()) {
+            if (paymentDetails.amount() >= kycThreshold() && 
+                    paymentDetails.customerName().isEmpty()) {
+                throw std::invalid_argument("KYC information required for payments above " + 
+                        QString::number(kycThreshold()).toStdString() + " " + currencyCode().toStdString());
+            }
+        }
+    }
+    
+    QString countryName() const override { return "Vietnam"; }
+    QString currencyCode() const override { return "VND"; }
+    QString regulator() const override { return "State Bank of Vietnam (SBV)"; }
+    double kycThreshold() const override { return 20000000.0; }
+};
+
+/**
+ * @brief Laos compliance module
+ */
+class LaosComplianceModule : public CountryComplianceModule {
+public:
+    void validatePayment(const PaymentDetails& paymentDetails) override {
+        if (currencyCode() == paymentDetails.currency()) {
+            if (paymentDetails.amount() >= kycThreshold() && 
+                    paymentDetails.customerName().isEmpty()) {
+                throw std::invalid_argument("KYC information required for payments above " + 
+                        QString::number(kycThreshold()).toStdString() + " " + currencyCode().toStdString());
+            }
+        }
+    }
+    
+    QString countryName() const override { return "Laos"; }
+    QString currencyCode() const override { return "LAK"; }
+    QString regulator() const override { return "Bank of the Lao PDR (BOL)"; }
+    double kycThreshold() const override { return 9000000.0; }
+};
+
+/**
+ * @brief Create country-specific compliance module
+ * @param countryCode Country code
+ * @return CountryComplianceModule instance
+ */
+inline std::unique_ptr<CountryComplianceModule> createCountryModule(CountryCode countryCode) {
+    switch (countryCode) {
+        case CountryCode::Malaysia:
+            return std::make_unique<MalaysiaComplianceModule>();
+        case CountryCode::Singapore:
+            return std::make_unique<SingaporeComplianceModule>();
+        case CountryCode::Indonesia:
+            return std::make_unique<IndonesiaComplianceModule>();
+        case CountryCode::Thailand:
+            return std::make_unique<ThailandComplianceModule>();
+        case CountryCode::Brunei:
+            return std::make_unique<BruneiComplianceModule>();
+        case CountryCode::Cambodia:
+            return std::make_unique<CambodiaComplianceModule>();
+        case CountryCode::Vietnam:
+            return std::make_unique<VietnamComplianceModule>();
+        case CountryCode::Laos:
+            return std::make_unique<LaosComplianceModule>();
+        default:
+            return std::make_unique<MalaysiaComplianceModule>();
+    }
+}
+
+/**
+ * @brief AsianCryptoPayment implementation
+ */
+AsianCryptoPayment::AsianCryptoPayment(const QString& apiKey, const QString& merchantId, CountryCode countryCode, QObject* parent)
+    : QObject(parent)
+    , m_apiKey(apiKey)
+    , m_merchantId(merchantId)
+    , m_countryCode(countryCode)
+    , m_networkManager(sharedNetworkManager())
+    , m_countryModule(createCountryModule(countryCode))
+    , m_securityModule(std::make_unique<SecurityModule>(apiKey))
+    , m_rateLimits(sharedRateLimits(apiKey))
+{
+    // Default supported cryptocurrencies
+    m_supportedCryptocurrencies << "BTC" << "ETH" << "USDT" << "USDC" << "BNB";
+    
+    rebuildRequestTemplate();
+    
+    // Retry budgets; batch polls are not retried because the next poll follows anyway
+    m_retryPolicies[RequestType::CreatePayment] = RetryPolicy(4, 500, 8000);
+    m_retryPolicies[RequestType::CancelPayment] = RetryPolicy(3, 500, 8000);
+    m_retryPolicies[RequestType::GetPayment] = RetryPolicy(3, 500, 4000);
+    m_retryPolicies[RequestType::GetPayments] = RetryPolicy(3, 1000, 8000);
+    m_retryPolicies[RequestType::GetExchangeRates] = RetryPolicy(2, 500, 2000);
+    m_retryPolicies[RequestType::PollPayments] = RetryPolicy(1);
+    
+    // Lower lanes leave connections free for checkout traffic
+    m_laneLimits[RequestPriority::Interactive] = 0;
+    m_laneLimits[RequestPriority::Normal] = 3;
+    m_laneLimits[RequestPriority::Background] = 2;
+    
+    m_schedulerTimer = new QTimer(this);
+    m_schedulerTimer->setSingleShot(true);
+    connect(m_schedulerTimer, &QTimer::timeout, this, &AsianCryptoPayment::drainRequestQueues);
+    
+    m_pollBatchTimer = new QTimer(this);
+    m_pollBatchTimer->setSingleShot(true);
+    connect(m_pollBatchTimer, &QTimer::timeout, this, &AsianCryptoPayment::pollDuePayments);
+    
+    m_statusCheckClock.start();
+    m_statusCheckTimer = new QTimer(this);
+    m_statusCheckTimer->setTimerType(Qt::CoarseTimer);
+    connect(m_statusCheckTimer, &QTimer::timeout, this, &AsianCryptoPayment::checkPaymentStatus);
+    
+    // Connections are opened once the event loop runs, so an endpoint set
+    // right after construction is the one that gets warmed
+    m_prewarmTimer = new QTimer(this);
+    m_prewarmTimer->setSingleShot(true);
+    connect(m_prewarmTimer, &QTimer::timeout, this, &AsianCryptoPayment::prewarmConnections);
+    m_prewarmTimer->start(0);
+    
+    m_keepAliveTimer = new QTimer(this);
+    connect(m_keepAliveTimer, &QTimer::timeout, this, &AsianCryptoPayment::sendKeepAlive);
+    m_keepAliveTimer->start(m_keepAliveIntervalMs);
+    m_lastApiRequestAt = QDateTime::currentMSecsSinceEpoch();
+    
+    m_outboundTimer = new QTimer(this);
+    connect(m_outboundTimer, &QTimer::timeout, this, &AsianCryptoPayment::drainOutboundQueue);
+    
+    m_pushReconnectTimer = new QTimer(this);
+    m_pushReconnectTimer->setSingleShot(true);
+    connect(m_pushReconnectTimer, &QTimer::timeout, this, &AsianCryptoPayment::connectPushChannel);
+    
+    m_pushPingTimer = new QTimer(this);
+    connect(m_pushPingTimer, &QTimer::timeout, this, &AsianCryptoPayment::checkPushHealth);
+    
+    m_regionProbeTimer = new QTimer(this);
+    connect(m_regionProbeTimer, &QTimer::timeout, this, &AsianCryptoPayment::probeRegions);
+    m_regions.append(ApiRegion{m_apiEndpoint});
+    
+    qDebug() << "SDK initialized for country:" << m_countryModule->countryName();
+}
+
+AsianCryptoPayment::~AsianCryptoPayment() {
+    // Closing the push channel must not call back into a half-destroyed object
+    if (m_pushSocket) {
+        m_pushSocket->disconnect(this);
+    }
+    if (m_pushStreamReply) {
+        m_pushStreamReply->disconnect(this);
+        m_pushStreamReply->abort();
+        m_pushStreamReply->deleteLater();
+    }
+    
+    // The shared network manager outlives this instance; drop its replies
+    QSet<QNetworkReply*> replies;
+    for (const QList<QNetworkReply*>& requestReplies : m_inflightReplies) {
+        for (QNetworkReply* reply : requestReplies) {
+            replies.insert(reply);
+        }
+    }
+    for (auto it = m_regionProbes.constBegin(); it != m_regionProbes.constEnd(); ++it) {
+        replies.insert(it.key());
+    }
+    
+    for (QNetworkReply* reply : replies) {
+        reply->disconnect(this);
+        reply->abort();
+        reply->deleteLater();
+    }
+}
+
+QNetworkAccessManager* AsianCryptoPayment::sharedNetworkManager() {
+    // Lives as long as the application, so a new instance reuses the open
+    // connections, TLS sessions and host lookups of the ones before it.
+    // Instances must therefore live in the application's thread.
+    static QPointer<QNetworkAccessManager> manager;
+    
+    if (!manager) {
+        manager = new QNetworkAccessManager(QCoreApplication::instance());
+    }
+    
+    return manager;
+}
+
+QMap<AsianCryptoPayment::EndpointClass, TokenBucket>& AsianCryptoPayment::sharedRateLimits(const QString& apiKey) {
+    // The server counts requests per API key, whichever instance sends them
+    static QMap<QString, QMap<EndpointClass, TokenBucket>> rateLimits;
+    
+    QMap<EndpointClass, TokenBucket>& limits = rateLimits[apiKey];
+    
+    // Documented per-minute limits, corrected later from X-RateLimit-* headers
+    if (limits.isEmpty()) {
+        limits[EndpointClass::PaymentsPost] = TokenBucket(60, 5);
+        limits[EndpointClass::PaymentsGet] = TokenBucket(120);
+        limits[EndpointClass::ExchangeRates] = TokenBucket(300);
+        limits[EndpointClass::Other] = TokenBucket(60);
+    }
+    
+    return limits;
+}
+
+void AsianCryptoPayment::setTestMode(bool testMode) {
+    if (testMode == m_testMode) {
+        return;
+    }
+    
+    if (m_syncId != 0) {
+        qWarning() << "Payment sync running; test mode stays" << (m_testMode ? "on" : "off");
+        return;
+    }
+    
+    m_testMode = testMode;
+    m_responseCache.clear();
+    rebuildRequestTemplate();
+    
+    // Each mode keeps its own sync mark, read again on next use
+    m_syncMarkLoaded = false;
+    m_syncUpdatedAt = QDateTime();
+    m_syncAfterId.clear();
+}
+
+void AsianCryptoPayment::setApiEndpoint(const QString& apiEndpoint) {
+    setApiEndpoints(QStringList() << apiEndpoint);
+}
+
+void AsianCryptoPayment::setApiEndpoints(const QStringList& apiEndpoints, int probeIntervalMs) {
+    if (apiEndpoints.isEmpty()) {
+        return;
+    }
+    
+    m_regions.clear();
+    m_regionProbes.clear();
+    for (const QString& endpoint : apiEndpoints) {
+        m_regions.append(ApiRegion{endpoint});
+    }
+    
+    m_regionProbeIntervalMs = qMax(1000, probeIntervalMs);
+    m_activeRegion = 0;
+    m_apiEndpoint = m_regions.first().endpoint;
+    m_responseCache.clear();
+    rebuildRequestTemplate();
+    m_prewarmTimer->start(0);
+    
+    // A single endpoint has nothing to choose from
+    if (m_regions.size() > 1) {
+        m_regionProbeTimer->start(m_regionProbeIntervalMs);
+        QTimer::singleShot(0, this, &AsianCryptoPayment::probeRegions);
+    } else {
+        m_regionProbeTimer->stop();
+    }
+}
+
+void AsianCryptoPayment::setConnectionPoolPolicy(int warmConnections, int keepAliveIntervalMs, int keepAliveIdleMs) {
+    m_warmConnections = qMax(0, warmConnections);
+    m_keepAliveIntervalMs = qMax(0, keepAliveIntervalMs);
+    m_keepAliveIdleMs = qMax(0, keepAliveIdleMs);
+    m_lastApiRequestAt = QDateTime::currentMSecsSinceEpoch();
+    
+    if (m_keepAliveIntervalMs > 0) {
+        m_keepAliveTimer->start(m_keepAliveIntervalMs);
+    } else {
+        m_keepAliveTimer->stop();
+    }
+    
+    m_prewarmTimer->start(0);
+}
+
+void AsianCryptoPayment::setRequestCompressionThreshold(int bytes) {
+    m_requestCompressionThreshold = qMax(0, bytes);
+}
+
+void AsianCryptoPayment::setOutboundQueuePath(const QString& filePath) {
+    if (filePath.isEmpty() && !m_outboundOperations.isEmpty()) {
+        qWarning() << "Outbound queue still holds" << m_outboundOperations.size() << "operations; keeping"
+                   << m_outboundQueuePath;
+        return;
+    }
+    
+    m_outboundQueuePath = filePath;
+    
+    // Pending operations move to the new file; otherwise pick up its contents
+    if (m_outboundOperations.isEmpty()) {
+        loadOutboundQueue();
+    } else {
+        saveOutboundQueue();
+    }
+}
+
+qint64 AsianCryptoPayment::outboundQueueOldestAge() const {
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    qint64 oldest = now;
+    
+    for (const OutboundOperation& operation : m_outboundOperations) {
+        oldest = qMin(oldest, operation.queuedAt);
+    }
+    
+    return now - oldest;
+}
+
+void AsianCryptoPayment::setHttp2Enabled(bool enabled) {
+    m_http2Enabled = enabled;
+    m_http2FellBack = false;
+    rebuildRequestTemplate();
+    m_prewarmTimer->start(0);
+}
+
+void AsianCryptoPayment::prewarmConnections() {
+    QUrl url(m_apiEndpoint);
+    if (!url.isValid() || url.host().isEmpty()) {
+        return;
+    }
+    
+    // A single multiplexed connection carries all traffic; a HEAD request
+    // opens it with HTTP/2 offered during the TLS handshake
+    if (http2Active()) {
+        if (m_warmConnections > 0) {
+            QNetworkRequest request(m_requestTemplate);
+            request.setUrl(url);
+            
+            QNetworkReply* reply = m_networkManager->head(request);
+            connect(reply, &QNetworkReply::finished, reply, &QObject::deleteLater);
+        }
+        m_lastNetworkActivity = QDateTime::currentMSecsSinceEpoch();
+        return;
+    }
+    
+    // Each call opens another channel to the host, up to Qt's per-host limit;
+    // DNS, TCP and TLS are then done before the first request needs them
+    for (int i = 0; i < m_warmConnections; ++i) {
+        if (url.scheme() == "https") {
+            m_networkManager->connectToHostEncrypted(url.host(), quint16(url.port(443)));
+        } else {
+            m_networkManager->connectToHost(url.host(), quint16(url.port(80)));
+        }
+    }
+    
+    m_lastNetworkActivity = QDateTime::currentMSecsSinceEpoch();
+}
+
+void AsianCryptoPayment::sendKeepAlive() {
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    
+    // Connections in use need no ping
+    if (now - m_lastNetworkActivity < m_keepAliveIntervalMs) {
+        return;
+    }
+    
+    // A kiosk nobody uses lets its connections go; dispatchRequest() starts
+    // the timer again with the next request
+    if (m_keepAliveIdleMs > 0 && now - m_lastApiRequestAt >= m_keepAliveIdleMs) {
+        m_keepAliveTimer->stop();
+        return;
+    }
+    
+    // Parallel HEAD requests spread over the warm connections so the server
+    // does not close them as idle; the replies are dropped unread. They
+    // carry the usual API headers and spend the budget of other requests
+    PreparedRequest prepared;
+    prepared.method = "HEAD";
+    QNetworkRequest request = createApiRequest(prepared, RequestPriority::Background);
+    
+    int connections = http2Active() ? qMin(1, m_warmConnections) : m_warmConnections;
+    for (int i = 0; i < connections; ++i) {
+        if (!m_rateLimits[EndpointClass::Other].tryAcquire(false, now)) {
+            break;
+        }
+        
+        QNetworkReply* reply = m_networkManager->head(request);
+        connect(reply, &QNetworkReply::finished, reply, &QObject::deleteLater);
+        m_statistics.keepAlivePings++;
+    }
+    
+    m_lastNetworkActivity = now;
+}
+
+void AsianCryptoPayment::probeRegions() {
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    
+    // HEAD on the base URL; after the first probe the connection is reused,
+    // so the time measured is the network round trip
+    for (const ApiRegion& region : m_regions) {
+        QNetworkRequest request(m_requestTemplate);
+        request.setUrl(QUrl(region.endpoint));
+        
+        QNetworkReply* reply = m_networkManager->head(request);
+        reply->setProperty("probe_sent_at", now);
+        m_regionProbes.insert(reply, region.endpoint);
+        m_statistics.regionProbes++;
+        
+        connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+            handleRegionProbe(reply);
+        });
+        
+        // A probe that does not answer within the interval counts as failed
+        QTimer::singleShot(m_regionProbeIntervalMs, reply, &QNetworkReply::abort);
+    }
+}
+
+void AsianCryptoPayment::handleRegionProbe(QNetworkReply* reply) {
+    QString endpoint = m_regionProbes.take(reply);
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    qint64 roundTrip = now - reply->property("probe_sent_at").toLongLong();
+    
+    const int probesToRecover = 3;
+    
+    // Any HTTP answer below 500 means the region is up, whatever HEAD returns
+    int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    bool reachable = statusCode > 0 && statusCode < 500;
+    
+    for (ApiRegion& region : m_regions) {
+        if (region.endpoint != endpoint) {
+            continue;
+        }
+        
+        if (!reachable) {
+            region.cleanProbes = 0;
+            region.unhealthySince = region.unhealthySince > 0 ? region.unhealthySince : now;
+            region.unhealthyUntil = now + m_regionProbeIntervalMs;
+            continue;
+        }
+        
+        region.rttMs = region.rttMs < 0 ? roundTrip : 0.7 * region.rttMs + 0.3 * roundTrip;
+        
+        // A HEAD answer only shows the host is up, not that requests work:
+        // an unhealthy region needs a run of good probes or a real success
+        if (region.unhealthySince > 0 && ++region.cleanProbes < probesToRecover) {
+            region.unhealthyUntil = now + m_regionProbeIntervalMs;
+            continue;
+        }
+        
+        region.failures = 0;
+        region.cleanProbes = 0;
+        region.unhealthySince = 0;
+        region.unhealthyUntil = 0;
+    }
+    
+    reply->deleteLater();
+    updateActiveRegion();
+}
+
+void AsianCryptoPayment::recordRegionOutcome(const QString& endpoint, bool failed, qint64 sentAt, qint64 now) {
+    const int maxFailures = 2;
+    
+    if (m_regions.size() < 2) {
+        return;
+    }
+    
+    // The endpoint list may have been replaced while the request was out
+    for (ApiRegion& entry : m_regions) {
+        if (entry.endpoint != endpoint) {
+            continue;
+        }
+        
+        if (!failed) {
+            entry.failures = 0;
+            
+            // Only a request sent after the region was marked down shows it recovered
+            if (entry.unhealthySince > 0 && sentAt >= entry.unhealthySince) {
+                entry.cleanProbes = 0;
+                entry.unhealthySince = 0;
+                entry.unhealthyUntil = 0;
+                updateActiveRegion();
+            }
+            return;
+        }
+        
+        // Skip the region until probes or a request show it has recovered
+        if (++entry.failures >= maxFailures) {
+            entry.cleanProbes = 0;
+            entry.unhealthySince = entry.unhealthySince > 0 ? entry.unhealthySince : now;
+            entry.unhealthyUntil = now + m_regionProbeIntervalMs;
+            updateActiveRegion();
+        }
+        return;
+    }
+}
+
+void AsianCryptoPayment::updateActiveRegion() {
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    
+    // Fastest healthy region; unmeasured ones only when nothing was measured
+    int best = -1;
+    for (int i = 0; i < m_regions.size(); ++i) {
+        const ApiRegion& region = m_regions.at(i);
+        if (region.unhealthyUntil > now) {
+            continue;
+        }
+        if (best < 0 || (region.rttMs >= 0 && (m_regions.at(best).rttMs < 0 || region.rttMs < m_regions.at(best).rttMs))) {
+            best = i;
+        }
+    }
+    
+    if (best < 0 || best == m_activeRegion) {
+        return;
+    }
+    
+    // A healthy region is only left for a clearly faster one, so regions
+    // with similar round trips do not take turns
+    const ApiRegion& active = m_regions.at(m_activeRegion);
+    bool activeHealthy = active.unhealthyUntil <= now;
+    if (activeHealthy && active.rttMs >= 0 && m_regions.at(best).rttMs > 0.8 * active.rttMs) {
+        return;
+    }
+    
+    if (!activeHealthy) {
+        m_statistics.regionFailovers++;
+    }
+    
+    qWarning() << "Switching API endpoint from" << m_apiEndpoint << "to" << m_regions.at(best).endpoint;
+    
+    m_activeRegion = best;
+    m_apiEndpoint = m_regions.at(best).endpoint;
+    rebuildRequestTemplate();
+    m_prewarmTimer->start(0);
+    
+    // Failures seen on the previous region say nothing about this one
+    for (auto it = m_circuitBreakers.begin(); it != m_circuitBreakers.end(); ++it) {
+        it->reset();
+    }
+    
+    emit apiEndpointChanged(m_apiEndpoint);
+}
+
+void AsianCryptoPayment::setSupportedCryptocurrencies(const QStringList& supportedCryptocurrencies) {
+    m_supportedCryptocurrencies = supportedCryptocurrencies;
+}
+
+void AsianCryptoPayment::setWebhookConfig(const QString& webhookEndpoint, const QString& webhookSecret) {
+    m_webhookConfig["endpoint"] = webhookEndpoint;
+    m_webhookConfig["secret"] = webhookSecret;
+}
+
+void AsianCryptoPayment::setCreatePaymentHeadroom(int reservedRequests) {
+    m_rateLimits[EndpointClass::PaymentsPost].setReserve(reservedRequests);
+}
+
+void AsianCryptoPayment::setRetryPolicy(RequestType type, const RetryPolicy& policy) {
+    m_retryPolicies[type] = policy;
+}
+
+void AsianCryptoPayment::setPollingPolicy(const PollingPolicy& policy) {
+    m_pollingPolicy = policy;
+}
+
+void AsianCryptoPayment::setPushEndpoint(const QString& pushEndpoint) {
+    m_pushEndpoint = pushEndpoint;
+    m_pushReconnectAttempts = 0;
+    m_pushReconnectTimer->stop();
+    
+    // An open channel reconnects to the new endpoint once it has closed
+    if (pushChannelOpen()) {
+        closePushChannel();
+    } else {
+        connectPushChannel();
+    }
+}
+
+void AsianCryptoPayment::setCircuitBreakerPolicy(double failureThreshold, int openMs) {
+    for (EndpointClass endpointClass : m_rateLimits.keys()) {
+        m_circuitBreakers[endpointClass] = CircuitBreaker(failureThreshold, 10, openMs);
+    }
+}
+
+void AsianCryptoPayment::setHedgingEnabled(bool enabled) {
+    m_hedgingEnabled = enabled;
+}
+
+RequestHandle AsianCryptoPayment::createPayment(const PaymentDetails& paymentDetails, const RequestOptions& options) {
+    try {
+        // Validate payment details
+        validatePaymentDetails(paymentDetails);
+        
+        // Apply country-specific validations
+        m_countryModule->validatePayment(paymentDetails);
+        
+        // Prepare payment data
+        QJsonObject paymentData = paymentDetails.toJson();
+        paymentData["merchant_id"] = m_merchantId;
+        paymentData["country_code"] = countryCodeToString(m_countryCode);
+        paymentData["test_mode"] = m_testMode;
+        
+        // Make API request
+        return RequestHandle(this, makeApiRequest(RequestType::CreatePayment, "payments", QString(), paymentData,
+                                                  options));
+    } catch (const std::exception& e) {
+        emit error(400, QString::fromStdString(e.what()));
+    }
+    
+    return RequestHandle();
+}
+
+RequestHandle AsianCryptoPayment::getPayment(const QString& paymentId, const RequestOptions& options) {
+    return fetchPayment(paymentId, false, options);
+}
+
+RequestHandle AsianCryptoPayment::fetchPayment(const QString& paymentId, bool statusCheck, const RequestOptions& options) {
+    if (paymentId.isEmpty()) {
+        emit error(400, "Payment ID is required");
+        return RequestHandle();
+    }
+    
+    // Later callers attach to the outstanding request; its reply is decoded
+    // once and delivered to every listener through paymentRetrieved. Each
+    // gets a handle of its own, with its own deadline
+    if (m_inflightPaymentFetches.contains(paymentId)) {
+        quint64 requestId = m_inflightPaymentFetches[paymentId];
+        quint64 handleId = m_nextRequestId++;
+        
+        QSet<quint64>& handles = m_requestAttachments[requestId];
+        if (handles.isEmpty()) {
+            handles.insert(requestId);
+        }
+        handles.insert(handleId);
+        m_attachedHandles[handleId] = requestId;
+        m_statistics.coalescedRequests++;
+        
+        armDeadline(handleId, options.deadline());
+        return RequestHandle(this, handleId);
+    }
+    
+    QString endpoint = "payments/" + paymentId;
+    RequestContext context = newRequestContext(RequestType::GetPayment, endpoint, paymentId, QJsonObject(), options);
+    context.statusCheck = statusCheck;
+    quint64 requestId = submitRequest(context);
+    
+    // The request may already have failed fast (e.g. open circuit)
+    if (m_liveRequests.contains(requestId)) {
+        m_inflightPaymentFetches[paymentId] = requestId;
+    }
+    
+    return RequestHandle(this, requestId);
+}
+
+RequestHandle AsianCryptoPayment::getPayments(const PaymentFilters& filters, const RequestOptions& options) {
+    return RequestHandle(this, makeApiRequest(RequestType::GetPayments, paymentsEndpoint(filters), QString(),
+                                              QJsonObject(), options));
+}
+
+QString AsianCryptoPayment::paymentsEndpoint(const PaymentFilters& filters) {
+    QString endpoint = "payments";
+    
+    // Add query parameters if filters are provided
+    QString queryString = filters.buildQueryString();
+    if (!queryString.isEmpty()) {
+        endpoint += "?" + queryString;
+    }
+    
+    return endpoint;
+}
+
+RequestHandle AsianCryptoPayment::streamPaymentHistory(const PaymentFilters& filters, int concurrency,
+                                                       const RequestOptions& options) {
+    quint64 historyId = m_nextRequestId++;
+    
+    PaymentHistory& history = m_paymentHistories[historyId];
+    history.filters = filters;
+    history.options = options;
+    history.concurrency = qMax(1, concurrency);
+    history.nextOffset = filters.offset();
+    history.deliverOffset = filters.offset();
+    
+    requestHistoryPages(historyId);
+    return RequestHandle(this, historyId);
+}
+
+void AsianCryptoPayment::requestHistoryPages(quint64 historyId) {
+    auto it = m_paymentHistories.find(historyId);
+    
+    // Pages are only fetched within reach of the one being delivered, so a
+    // slow page holds back the rest instead of piling them up in memory
+    while (it != m_paymentHistories.end() && it->pageRequests.size() < it->concurrency &&
+            it->nextOffset < it->endOffset &&
+            it->nextOffset < it->deliverOffset + qint64(it->concurrency) * qMax(1, it->filters.limit())) {
+        int offset = it->nextOffset;
+        it->nextOffset += qMax(1, it->filters.limit());
+        
+        PaymentFilters filters = it->filters;
+        filters.setOffset(offset);
+        
+        RequestContext context = newRequestContext(RequestType::GetPayments, paymentsEndpoint(filters), QString(),
+                                                   QJsonObject(), it->options);
+        context.historyId = historyId;
+        context.offset = offset;
+        quint64 requestId = submitRequest(context);
+        
+        // A request that fails straight away ends the walk
+        it = m_paymentHistories.find(historyId);
+        if (it != m_paymentHistories.end() && m_liveRequests.contains(requestId)) {
+            it->pageRequests[offset] = requestId;
+        }
+    }
+}
+
+void AsianCryptoPayment::handleHistoryPage(const RequestContext& context, const QList<Payment>& payments,
+                                           const QJsonObject& response) {
+    quint64 historyId = context.historyId;
+    int offset = context.offset;
+    
+    auto it = m_paymentHistories.find(historyId);
+    if (it == m_paymentHistories.end()) {
+        return;
+    }
+    
+    it->pageRequests.remove(offset);
+    it->readyPages[offset] = payments;
+    
+    bool hasMore = response.contains("has_more") ? response["has_more"].toBool()
+                                                 : offset + payments.size() < response["total"].toInt();
+    
+    // Once a page marks the end, pages requested beyond it are dropped
+    if (!hasMore || payments.isEmpty()) {
+        it->endOffset = qMin(it->endOffset, offset + qMax(1, it->filters.limit()));
+        
+        for (auto page = it->pageRequests.begin(); page != it->pageRequests.end();) {
+            if (page.key() >= it->endOffset) {
+                quint64 requestId = page.value();
+                page = it->pageRequests.erase(page);
+                abandonRequest(requestId);
+            } else {
+                ++page;
+            }
+        }
+    }
+    
+    deliverHistoryPages(historyId);
+}
+
+void AsianCryptoPayment::deliverHistoryPages(quint64 historyId) {
+    auto it = m_paymentHistories.find(historyId);
+    
+    while (it != m_paymentHistories.end() && it->readyPages.contains(it->deliverOffset)) {
+        QList<Payment> payments = it->readyPages.take(it->deliverOffset);
+        it->deliverOffset += qMax(1, it->filters.limit());
+        it->delivered += payments.size();
+        
+        if (!payments.isEmpty()) {
+            emit paymentHistoryPage(historyId, payments);
+        }
+        
+        // A slot may have cancelled the walk
+        it = m_paymentHistories.find(historyId);
+    }
+    
+    if (it == m_paymentHistories.end()) {
+        return;
+    }
+    
+    if (it->deliverOffset >= it->endOffset) {
+        int count = it->delivered;
+        m_paymentHistories.erase(it);
+        emit paymentHistoryFinished(historyId, count);
+        return;
+    }
+    
+    requestHistoryPages(historyId);
+}
+
+RequestHandle AsianCryptoPayment::syncPayments(int pageSize) {
+    if (m_syncId != 0) {
+        return RequestHandle(this, m_syncId);
+    }
+    
+    loadSyncMark();
+    m_syncId = m_nextRequestId++;
+    m_syncPageSize = qMax(1, pageSize);
+    m_syncCount = 0;
+    
+    quint64 syncId = m_syncId;
+    requestSyncPage();
+    return RequestHandle(this, syncId);
+}
+
+void AsianCryptoPayment::resetPaymentSync(const QDateTime& updatedSince) {
+    m_syncMarkLoaded = true;
+    m_syncUpdatedAt = updatedSince;
+    m_syncAfterId.clear();
+    saveSyncMark();
+}
+
+QDateTime AsianCryptoPayment::paymentSyncMark() {
+    loadSyncMark();
+    return m_syncUpdatedAt;
+}
+
+void AsianCryptoPayment::requestSyncPage() {
+    // Without a mark the first sync starts at the beginning of the history
+    PaymentFilters filters;
+    filters.setUpdatedSince(m_syncUpdatedAt.isValid() ? m_syncUpdatedAt : QDateTime::fromMSecsSinceEpoch(0, Qt::UTC),
+                            m_syncAfterId);
+    filters.setLimit(m_syncPageSize);
+    
+    RequestContext context = newRequestContext(RequestType::GetPayments, paymentsEndpoint(filters), QString(),
+                                               QJsonObject(), RequestOptions());
+    context.syncId = m_syncId;
+    m_syncPageRequest = submitRequest(context);
+}
+
+void AsianCryptoPayment::handleSyncPage(const RequestContext& context, const QList<Payment>& payments,
+                                        const QJsonObject& response) {
+    if (context.syncId != m_syncId) {
+        return;
+    }
+    
+    // Results are ordered by (updated_at, id), so the last one is the new mark
+    if (!payments.isEmpty()) {
+        m_syncUpdatedAt = payments.last().updatedAt();
+        m_syncAfterId = payments.last().id();
+        m_syncCount += payments.size();
+        saveSyncMark();
+        
+        emit paymentsSynced(payments);
+        
+        // A slot may have cancelled the sync
+        if (context.syncId != m_syncId) {
+            return;
+        }
+    }
+    
+    if (response["has_more"].toBool() && !payments.isEmpty()) {
+        requestSyncPage();
+        return;
+    }
+    
+    int count = m_syncCount;
+    m_syncId = 0;
+    m_syncPageRequest = 0;
+    emit paymentSyncFinished(count);
+}
+
+QString AsianCryptoPayment::syncSettingsGroup() const {
+    return QString("AsianCryptoPay/sync/%1/%2").arg(m_merchantId, m_testMode ? "test" : "live");
+}
+
+void AsianCryptoPayment::loadSyncMark() {
+    if (m_syncMarkLoaded) {
+        return;
+    }
+    
+    QSettings settings;
+    settings.beginGroup(syncSettingsGroup());
+    m_syncUpdatedAt = QDateTime::fromString(settings.value("updated_at").toString(), Qt::ISODateWithMs);
+    m_syncAfterId = settings.value("after_id").toString();
+    settings.endGroup();
+    
+    m_syncMarkLoaded = true;
+}
+
+void AsianCryptoPayment::saveSyncMark() {
+    QSettings settings;
+    settings.beginGroup(syncSettingsGroup());
+    settings.setValue("updated_at", m_syncUpdatedAt.isValid() ? m_syncUpdatedAt.toUTC().toString(Qt::ISODateWithMs) : QString());
+    settings.setValue("after_id", m_syncAfterId);
+    settings.endGroup();
+}
+
+void AsianCryptoPayment::abortPaymentHistory(quint64 historyId) {
+    if (!m_paymentHistories.contains(historyId)) {
+        return;
+    }
+    
+    PaymentHistory history = m_paymentHistories.take(historyId);
+    for (quint64 requestId : history.pageRequests.values()) {
+        abandonRequest(requestId);
+    }
+}
+
+RequestHandle AsianCryptoPayment::cancelPayment(const QString& paymentId, const RequestOptions& options) {
+    if (paymentId.isEmpty()) {
+        emit error(400, "Payment ID is required");
+        return RequestHandle();
+    }
+    
+    QString endpoint = "payments/" + paymentId + "/cancel";
+    return RequestHandle(this, makeApiRequest(RequestType::CancelPayment, endpoint, paymentId, QJsonObject(), options));
+}
+
+RequestHandle AsianCryptoPayment::getExchangeRates(const QString& baseCurrency, const QStringList& cryptoCurrencies,
+                                                   const RequestOptions& options) {
+    if (baseCurrency.isEmpty()) {
+        emit error(400, "Base currency is required");
+        return RequestHandle();
+    }
+    
+    QStringList currencies = cryptoCurrencies.isEmpty() ? m_supportedCryptocurrencies : cryptoCurrencies;
+    
+    QString endpoint = "exchange-rates?base_currency=" + baseCurrency + "&currencies=" + currencies.join(",");
+    return RequestHandle(this, makeApiRequest(RequestType::GetExchangeRates, endpoint, QString(), QJsonObject(),
+                                              options));
+}
+
+bool AsianCryptoPayment::cancelRequest(quint64 requestId) {
+    if (m_paymentHistories.contains(requestId)) {
+        abortPaymentHistory(requestId);
+        m_statistics.requestsCancelled++;
+        return true;
+    }
+    
+    if (m_syncId != 0 && requestId == m_syncId) {
+        m_syncId = 0;
+        abandonRequest(m_syncPageRequest);
+        m_statistics.requestsCancelled++;
+        return true;
+    }
+    
+    quint64 abandoned = 0;
+    if (!releaseHandle(requestId, abandoned)) {
+        return false;
+    }
+    
+    if (abandoned != 0) {
+        abandonRequest(abandoned);
+        m_statistics.requestsCancelled++;
+    }
+    return true;
+}
+
+bool AsianCryptoPayment::verifyWebhookSignature(const QString& signature, const QString& body) {
+    if (!m_webhookConfig.contains("secret")) {
+        qWarning() << "Webhooks not initialized";
+        return false;
+    }
+    
+    QString secret = m_webhookConfig["secret"].toString();
+    return m_securityModule->verifySignature(signature, body, secret);
+}
+
+bool AsianCryptoPayment::processWebhookEvent(const QJsonObject& event, const QString& signature) {
+    if (m_webhookConfig.isEmpty()) {
+        qWarning() << "Webhooks not initialized";
+        return false;
+    }
+    
+    // Verify signature
+    QJsonDocument doc(event);
+    QString eventString = doc.toJson(QJsonDocument::Compact);
+    bool isValid = verifyWebhookSignature(signature, eventString);
+    
+    if (!isValid) {
+        qWarning() << "Invalid webhook signature";
+        return false;
+    }
+    
+    // Process event
+    try {
+        dispatchPaymentEvent(event, true);
+        return true;
+    } catch (const std::exception& e) {
+        qWarning() << "Failed to process webhook event:" << e.what();
+        return false;
+    }
+}
+
+bool AsianCryptoPayment::dispatchPaymentEvent(const QJsonObject& event, bool verified) {
+    if (!event.contains("data") || !event["data"].isObject()) {
+        return false;
+    }
+    
+    QString eventType = event["type"].toString();
+    Payment payment = Payment::fromJson(event["data"].toObject());
+    
+    // Push events are not signed, so they may only update payments this
+    // kiosk is checking; anything else needs a verified webhook
+    if (!verified && !m_statusCheckStates.contains(payment.id())) {
+        return false;
+    }
+    
+    // Tracked payments take the polling path; for the rest, a change already
+    // reported through another channel is dropped here
+    if (m_activePayments.contains(payment.id())) {
+        applyPolledPayment(payment);
+        return true;
+    }
+    if (!acceptPaymentRevision(payment)) {
+        return true;
+    }
+    
+    if (eventType == "payment.created") {
+        emit paymentCreated(payment);
+    } else if (eventType == "payment.updated") {
+        emit paymentStatusUpdated(payment);
+    } else if (eventType == "payment.completed") {
+        emit paymentStatusUpdated(payment);
+        stopPaymentStatusCheck(payment.id());
+    } else if (eventType == "payment.cancelled") {
+        emit paymentStatusUpdated(payment);
+        stopPaymentStatusCheck(payment.id());
+    } else if (eventType == "payment.expired") {
+        emit paymentStatusUpdated(payment);
+        stopPaymentStatusCheck(payment.id());
+    }
+    
+    return true;
+}
+
+RequestHandle AsianCryptoPayment::downloadQrCode(const QString& url, const RequestOptions& options) {
+    if (url.isEmpty()) {
+        emit error(400, "QR code URL is required");
+        return RequestHandle();
+    }
+    
+    QNetworkRequest request(url);
+    QNetworkReply* reply = m_networkManager->get(request);
+    
+    // Tracked for cancellation and deadlines only; the reply is handled by
+    // onQrCodeDownloaded rather than the API reply path
+    quint64 requestId = m_nextRequestId++;
+    reply->setProperty("request_id", requestId);
+    m_liveRequests.insert(requestId);
+    m_inflightReplies[requestId].append(reply);
+    armDeadline(requestId, options.deadline());
+    
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        onQrCodeDownloaded(reply);
+    });
+    
+    return RequestHandle(this, requestId);
+}
+
+void AsianCryptoPayment::validatePaymentDetails(const PaymentDetails& paymentDetails) {
+    if (paymentDetails.amount() <= 0.0) {
+        throw std::invalid_argument("Payment amount must be greater than zero");
+    }
+    
+    if (paymentDetails.currency().isEmpty()) {
+        throw std::invalid_argument("Currency is required");
+    }
+    
+    if (paymentDetails.cryptoCurrency().isEmpty()) {
+        throw std::invalid_argument("Cryptocurrency is required");
+    }
+    
+    if (!m_supportedCryptocurrencies.contains(paymentDetails.cryptoCurrency())) {
+        throw std::invalid_argument("Unsupported cryptocurrency. Must be one of: " + 
+                m_supportedCryptocurrencies.join(", ").toStdString());
+    }
+}
+
+void AsianCryptoPayment::rebuildRequestTemplate() {
+    m_apiEndpointPrefix = m_apiEndpoint + "/";
+    
+    // Headers that only change with configuration are encoded once here
+    // and shared by every request copied from the template
+    m_requestTemplate = QNetworkRequest();
+    m_requestTemplate.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    m_requestTemplate.setRawHeader("X-Merchant-ID", m_merchantId.toUtf8());
+    m_requestTemplate.setRawHeader("X-Test-Mode", m_testMode ? "true" : "false");
+    m_requestTemplate.setRawHeader("User-Agent", "AsianCryptoPayment-Qt/1.0.0");
+    
+    // HTTP/2 is negotiated through ALPN; servers without it answer over HTTP/1.1
+    m_requestTemplate.setAttribute(QNetworkRequest::Http2AllowedAttribute, http2Active());
+}
+
+AsianCryptoPayment::PreparedRequest AsianCryptoPayment::prepareApiRequest(const QString& endpoint, const QString& method, const QJsonObject& data) const {
+    PreparedRequest prepared;
+    prepared.endpoint = endpoint;
+    prepared.method = method.toLatin1();
+    
+    // Serialize once; the same bytes are signed and sent
+    if (!data.isEmpty()) {
+        prepared.body = QJsonDocument(data).toJson(QJsonDocument::Compact);
+    }
+    
+    // Large bodies go out deflated; the signature still covers the JSON.
+    // qCompress output is a zlib stream behind a 4-byte length prefix.
+    if (m_requestCompressionThreshold > 0 && prepared.body.size() >= m_requestCompressionThreshold) {
+        QByteArray deflated = qCompress(prepared.body).mid(4);
+        
+        if (deflated.size() < prepared.body.size()) {
+            prepared.encodedBody = deflated;
+        }
+    }
+    
+    // One key per logical request, reused by every retry of it
+    if (prepared.method == "POST") {
+        prepared.idempotencyKey = QUuid::createUuid().toByteArray(QUuid::WithoutBraces);
+    }
+    
+    return prepared;
+}
+
+QNetworkRequest AsianCryptoPayment::createApiRequest(const PreparedRequest& prepared, RequestPriority priority) {
+    QNetworkRequest request(m_requestTemplate);
+    request.setUrl(QUrl(m_apiEndpointPrefix + prepared.endpoint));
+    
+    // Qt also orders its own per-host queue by request priority
+    if (priority != RequestPriority::Normal) {
+        request.setPriority(priority == RequestPriority::Interactive ? QNetworkRequest::HighPriority
+                                                                     : QNetworkRequest::LowPriority);
+    }
+    
+    QByteArray timestamp = QByteArray::number(QDateTime::currentMSecsSinceEpoch());
+    request.setRawHeader("X-Timestamp", timestamp);
+    
+    if (!prepared.body.isEmpty()) {
+        request.setRawHeader("X-Signature", m_securityModule->generateSignature(prepared.body, timestamp));
+    }
+    
+    if (!prepared.idempotencyKey.isEmpty()) {
+        request.setRawHeader("Idempotency-Key", prepared.idempotencyKey);
+    }
+    
+    if (!prepared.encodedBody.isEmpty()) {
+        request.setRawHeader("Content-Encoding", "deflate");
+    }
+    
+    // Revalidate cached responses; an unchanged resource comes back as 304
+    if (prepared.method == "GET") {
+        const CachedResponse* cached = m_responseCache.object(prepared.endpoint);
+        
+        if (cached) {
+            if (!cached->etag.isEmpty()) {
+                request.setRawHeader("If-None-Match", cached->etag);
+            }
+            if (!cached->lastModified.isEmpty()) {
+                request.setRawHeader("If-Modified-Since", cached->lastModified);
             }
         }
     }
     
-    QString countryName() const override { return "Thailand"; }
-    QString currencyCode() const override { return "THB"; }
-    QString regulator() const override { return "Securities and Exchange Commission (SEC)"; }
-    double kycThreshold() const override { return 50000.0; }
-};
+    return request;
+}
 
-/**
- * @brief Brunei compliance module
- */
-class BruneiComplianceModule : public CountryComplianceModule {
-public:
-    void validatePayment(const PaymentDetails& paymentDetails) override {
-        if (currencyCode() == paymentDetails.currency()) {
-            if (paymentDetails.amount() >= kycThreshold() && 
-                    paymentDetails.customerName().isEmpty()) {
-                throw std::invalid_argument("KYC information required for payments above " + 
-                        QString::number(kycThreshold()).toStdString() + " " + currencyCode().toStdString());
+QNetworkReply* AsianCryptoPayment::sendPreparedRequest(const PreparedRequest& prepared, RequestPriority priority) {
+    QNetworkRequest request = createApiRequest(prepared, priority);
+    const QByteArray& body = prepared.encodedBody.isEmpty() ? prepared.body : prepared.encodedBody;
+    
+    m_statistics.requestBodyBytes += quint64(prepared.body.size());
+    m_statistics.requestWireBytes += quint64(body.size());
+    
+    if (prepared.method == "GET") {
+        return m_networkManager->get(request);
+    } else if (prepared.method == "POST") {
+        return m_networkManager->post(request, body);
+    } else if (prepared.method == "PUT") {
+        return m_networkManager->put(request, body);
+    } else if (prepared.method == "DELETE") {
+        return m_networkManager->deleteResource(request);
+    }
+    
+    return nullptr;
+}
+
+quint64 AsianCryptoPayment::makeApiRequest(RequestType type, const QString& endpoint, const QString& paymentId,
+                                           const QJsonObject& data, const RequestOptions& options) {
+    RequestContext context = newRequestContext(type, endpoint, paymentId, data, options);
+    return submitRequest(context);
+}
+
+AsianCryptoPayment::RequestContext AsianCryptoPayment::newRequestContext(RequestType type, const QString& endpoint,
+                                                                         const QString& paymentId,
+                                                                         const QJsonObject& data,
+                                                                         const RequestOptions& options) {
+    Route route = routeFor(type);
+    
+    RequestContext context;
+    context.type = type;
+    context.id = paymentId;
+    context.request = prepareApiRequest(endpoint, QString::fromLatin1(route.method), data);
+    context.endpointClass = route.endpointClass;
+    context.deadline = options.deadline();
+    context.priority = options.hasPriority() ? options.priority() : defaultPriority(context.type);
+    return context;
+}
+
+quint64 AsianCryptoPayment::submitRequest(RequestContext& context) {
+    context.requestId = m_nextRequestId++;
+    context.submittedAt = QDateTime::currentMSecsSinceEpoch();
+    
+    m_liveRequests.insert(context.requestId);
+    armDeadline(context.requestId, context.deadline);
+    
+    if (!submitOutboundOperation(context)) {
+        enqueueRequest(context);
+    }
+    
+    return context.requestId;
+}
+
+void AsianCryptoPayment::enqueueRequest(const RequestContext& context, bool retry) {
+    // Cancelled or expired while waiting for a retry
+    if (!m_liveRequests.contains(context.requestId)) {
+        return;
+    }
+    
+    QList<RequestContext>& queue = m_requestQueues[context.endpointClass];
+    bool privileged = context.type == RequestType::CreatePayment;
+    
+    // Send straight away when nothing is waiting and the budget allows it
+    if (queue.isEmpty() && !retry && laneHasCapacity(context.priority) &&
+            m_rateLimits[context.endpointClass].tryAcquire(privileged, QDateTime::currentMSecsSinceEpoch())) {
+        dispatchRequest(context);
+        return;
+    }
+    
+    // Queues are ordered by lane; throttled requests keep their place at
+    // the front of their lane, new ones join its back
+    int index = 0;
+    while (index < queue.size() && (queue.at(index).priority < context.priority ||
+            (!retry && queue.at(index).priority == context.priority))) {
+        ++index;
+    }
+    queue.insert(index, context);
+    
+    if (retry) {
+        scheduleQueueDrain();
+    } else {
+        drainRequestQueues();
+    }
+}
+
+RequestPriority AsianCryptoPayment::defaultPriority(RequestType type) {
+    switch (type) {
+        case RequestType::CreatePayment:
+        case RequestType::CancelPayment:
+            return RequestPriority::Interactive;
+        case RequestType::GetPayments:
+        case RequestType::PollPayments:
+            return RequestPriority::Background;
+        default:
+            return RequestPriority::Normal;
+    }
+}
+
+bool AsianCryptoPayment::laneHasCapacity(RequestPriority priority) const {
+    int limit = m_laneLimits.value(priority);
+    return limit <= 0 || m_laneInFlight.value(priority) < limit;
+}
+
+void AsianCryptoPayment::setLaneConcurrency(RequestPriority priority, int maxInFlight) {
+    m_laneLimits[priority] = qMax(0, maxInFlight);
+    drainRequestQueues();
+}
+
+void AsianCryptoPayment::dispatchRequest(const RequestContext& context) {
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    
+    if (!m_liveRequests.contains(context.requestId)) {
+        return;
+    }
+    
+    // Callers attached to a coalesced request may still wait for it
+    if (context.deadline > 0 && now >= context.deadline) {
+        expireRequest(context.requestId);
+        
+        if (!m_liveRequests.contains(context.requestId)) {
+            return;
+        }
+    }
+    
+    if (!m_circuitBreakers[context.endpointClass].allowRequest(now)) {
+        m_statistics.circuitRejections++;
+        if (parkOutboundOperation(context)) {
+            return;
+        }
+        failRequest(context, CircuitOpenError, "Service temporarily unavailable; request not sent");
+        return;
+    }
+    
+    QNetworkReply* reply = sendPreparedRequest(context.request, context.priority);
+    if (!reply) {
+        return;
+    }
+    
+    // Hedges ride on the original request's lane slot
+    if (!context.hedge) {
+        m_laneInFlight[context.priority]++;
+    }
+    
+    RequestContext& sent = m_pendingRequests[reply];
+    sent = context;
+    sent.sentAt = now;
+    sent.region = m_apiEndpoint;
+    m_inflightReplies[context.requestId].append(reply);
+    m_statistics.requestsSent++;
+    m_lastNetworkActivity = now;
+    m_lastApiRequestAt = now;
+    
+    if (m_keepAliveIntervalMs > 0 && !m_keepAliveTimer->isActive()) {
+        m_keepAliveTimer->start(m_keepAliveIntervalMs);
+    }
+    
+    // Replies are connected one by one; the shared manager's finished()
+    // also reports those of other instances
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        onNetworkReply(reply);
+    });
+    
+    // A TLS handshake on behalf of this reply means no warm connection was free
+    connect(reply, &QNetworkReply::encrypted, this, [reply]() {
+        reply->setProperty("cold_connection", true);
+    });
+    
+    // Pages are decoded as they arrive instead of after the last byte
+    if (context.type == RequestType::GetPayments) {
+        StreamedPage& page = m_streamedPages[reply];
+        page.announce = context.historyId == 0 && context.syncId == 0;
+        connect(reply, &QNetworkReply::readyRead, this, [this, reply]() {
+            onStreamedReplyData(reply);
+        });
+    }
+    
+    // Hedge slow reads once the endpoint's p95 latency has passed;
+    // streamed pages are not hedged so their payments are emitted once
+    if (m_hedgingEnabled && !context.hedge && context.request.method == "GET" &&
+            context.type != RequestType::GetPayments) {
+        int hedgeDelay = m_latencies[context.endpointClass].percentile(0.95);
+        
+        if (hedgeDelay >= 0) {
+            quint64 requestId = context.requestId;
+            QTimer::singleShot(hedgeDelay, this, [this, requestId]() {
+                sendHedgeRequest(requestId);
+            });
+        }
+    }
+}
+
+void AsianCryptoPayment::sendHedgeRequest(quint64 requestId) {
+    QList<QNetworkReply*> replies = m_inflightReplies.value(requestId);
+    if (replies.size() != 1 || !m_pendingRequests.contains(replies.first())) {
+        return;
+    }
+    
+    RequestContext hedge = m_pendingRequests[replies.first()];
+    hedge.hedge = true;
+    
+    // Hedges are optional: skip them on a troubled endpoint or a tight budget
+    if (m_circuitBreakers[hedge.endpointClass].state() != CircuitBreaker::State::Closed ||
+            !m_rateLimits[hedge.endpointClass].tryAcquire(false, QDateTime::currentMSecsSinceEpoch())) {
+        return;
+    }
+    
+    m_statistics.hedgedRequests++;
+    dispatchRequest(hedge);
+}
+
+bool AsianCryptoPayment::resolveHedgedReply(QNetworkReply* reply, const RequestContext& context) {
+    auto it = m_inflightReplies.find(context.requestId);
+    if (it == m_inflightReplies.end()) {
+        return false;
+    }
+    
+    it.value().removeOne(reply);
+    QList<QNetworkReply*> siblings = it.value();
+    
+    if (siblings.isEmpty()) {
+        m_inflightReplies.erase(it);
+        return false;
+    }
+    
+    // Only a success or a definitive client error answers the request; a
+    // transient failure, a rate limit or a broken connection leaves the
+    // answer to the copy still in flight
+    int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    bool definitive = (statusCode >= 200 && statusCode < 300) || statusCode == 304 ||
+                      (statusCode >= 400 && statusCode < 500 && statusCode != 408 && statusCode != 429);
+    if (!definitive) {
+        return true;
+    }
+    
+    // The first usable reply wins; the other copy is aborted
+    m_inflightReplies.erase(it);
+    for (QNetworkReply* sibling : siblings) {
+        m_pendingRequests.remove(sibling);
+        sibling->abort();
+    }
+    
+    if (context.hedge) {
+        m_statistics.hedgeWins++;
+    }
+    
+    return false;
+}
+
+void AsianCryptoPayment::failRequest(const RequestContext& context, int errorCode, const QString& errorMessage) {
+    finishRequest(context.requestId);
+    
+    if (context.historyId != 0) {
+        abortPaymentHistory(context.historyId);
+    }
+    
+    // The mark keeps the progress; the next sync resumes from it
+    if (context.syncId != 0 && context.syncId == m_syncId) {
+        m_syncId = 0;
+    }
+    
+    m_statistics.requestsFailed++;
+    emit error(errorCode, errorMessage);
+}
+
+void AsianCryptoPayment::finishRequest(quint64 requestId) {
+    m_liveRequests.remove(requestId);
+    for (quint64 handleId : m_requestAttachments.take(requestId)) {
+        m_attachedHandles.remove(handleId);
+    }
+    completeOutboundOperation(requestId);
+    
+    for (auto it = m_inflightPaymentFetches.begin(); it != m_inflightPaymentFetches.end(); ++it) {
+        if (it.value() == requestId) {
+            m_inflightPaymentFetches.erase(it);
+            break;
+        }
+    }
+}
+
+void AsianCryptoPayment::armDeadline(quint64 requestId, qint64 deadline) {
+    if (deadline <= 0) {
+        return;
+    }
+    
+    qint64 remaining = qBound<qint64>(0, deadline - QDateTime::currentMSecsSinceEpoch(), INT_MAX);
+    QTimer::singleShot(int(remaining), this, [this, requestId]() {
+        expireRequest(requestId);
+    });
+}
+
+void AsianCryptoPayment::expireRequest(quint64 requestId) {
+    quint64 abandoned = 0;
+    if (!releaseHandle(requestId, abandoned)) {
+        return;
+    }
+    
+    if (abandoned != 0) {
+        abandonRequest(abandoned);
+        
+        // An expired page ends its history walk or sync
+        for (auto it = m_paymentHistories.begin(); it != m_paymentHistories.end(); ++it) {
+            if (it->pageRequests.values().contains(abandoned)) {
+                abortPaymentHistory(it.key());
+                break;
             }
         }
+        
+        if (m_syncId != 0 && abandoned == m_syncPageRequest) {
+            m_syncId = 0;
+        }
     }
     
-    QString countryName() const override { return "Brunei"; }
-    QString currencyCode() const override { return "BND"; }
-    QString regulator() const override { return "Autoriti Monetari Brunei Darussalam (AMBD)"; }
-    double kycThreshold() const override { return 5000.0; }
-};
+    m_statistics.deadlinesExceeded++;
+    m_statistics.requestsFailed++;
+    emit error(DeadlineExceededError, "Request deadline exceeded");
+}
 
-/**
- * @brief Cambodia compliance module
- */
-class CambodiaComplianceModule : public CountryComplianceModule {
-public:
-    void validatePayment(const PaymentDetails& paymentDetails) override {
-        if (currencyCode() == paymentDetails.currency()) {
-            if (paymentDetails.amount() >= kycThreshold() && 
-                    paymentDetails.customerName().isEmpty()) {
-                throw std::invalid_argument("KYC information required for payments above " + 
-                        QString::number(kycThreshold()).toStdString() + " " + currencyCode().toStdString());
+bool AsianCryptoPayment::releaseHandle(quint64 handleId, quint64& abandonedRequest) {
+    quint64 requestId = m_attachedHandles.value(handleId, handleId);
+    if (!m_liveRequests.contains(requestId)) {
+        return false;
+    }
+    
+    // A caller sharing a coalesced request only detaches from it, once; the
+    // request is abandoned with the last caller
+    auto it = m_requestAttachments.find(requestId);
+    if (it != m_requestAttachments.end()) {
+        if (!it->remove(handleId)) {
+            return false;
+        }
+        m_attachedHandles.remove(handleId);
+        
+        if (!it->isEmpty()) {
+            abandonedRequest = 0;
+            return true;
+        }
+    }
+    
+    abandonedRequest = requestId;
+    return true;
+}
+
+void AsianCryptoPayment::abandonRequest(quint64 requestId) {
+    finishRequest(requestId);
+    
+    for (auto it = m_requestQueues.begin(); it != m_requestQueues.end(); ++it) {
+        QList<RequestContext>& queue = it.value();
+        
+        for (int i = queue.size() - 1; i >= 0; --i) {
+            if (queue.at(i).requestId == requestId) {
+                queue.removeAt(i);
             }
         }
     }
     
-    QString countryName() const override { return "Cambodia"; }
-    QString currencyCode() const override { return "KHR"; }
-    QString regulator() const override { return "National Bank of Cambodia (NBC)"; }
-    double kycThreshold() const override { return 4000000.0; }
-};
+    // Untrack before aborting so the aborted replies are ignored
+    QList<QNetworkReply*> replies = m_inflightReplies.take(requestId);
+    if (!replies.isEmpty() && m_pendingRequests.contains(replies.first())) {
+        m_laneInFlight[m_pendingRequests[replies.first()].priority]--;
+    }
+    
+    for (QNetworkReply* reply : replies) {
+        m_pendingRequests.remove(reply);
+        reply->abort();
+    }
+}
 
-/**
- * @brief Vietnam compliance module
- */
-class VietnamComplianceModule : public CountryComplianceModule {
-public:
-    void validatePayment(const PaymentDetails& paymentDetails) override {
-        if (currencyCode() == paymentDetails.currency()) {
-            if (paymentDetails.amount() >= kycThreshold() && 
-                    paymentDetails.customerName().isEmpty()) {
-                throw std::invalid_argument("KYC information required for payments above " + 
-                        QString::number(kycThreshold()).toStdString() + " " + currencyCode().toStdString());
+void AsianCryptoPayment::drainRequestQueues() {
+    // A dispatch can fail at once and emit error(), whose slots may call
+    // back into the SDK and change the queues: each context is taken out
+    // before it is sent and its queue is scanned afresh afterwards
+    for (EndpointClass endpointClass : m_requestQueues.keys()) {
+        bool dispatched = true;
+        while (dispatched) {
+            dispatched = false;
+            QList<RequestContext>& queue = m_requestQueues[endpointClass];
+            TokenBucket& bucket = m_rateLimits[endpointClass];
+            qint64 now = QDateTime::currentMSecsSinceEpoch();
+            
+            // Full lanes are skipped, but a lower lane never takes a token
+            // that a waiting higher lane could not get. Behind a request the
+            // budget holds back, only createPayment may still go, on headroom
+            bool headroomOnly = false;
+            for (int index = 0; index < queue.size(); ++index) {
+                bool privileged = queue.at(index).type == RequestType::CreatePayment;
+                
+                if (!laneHasCapacity(queue.at(index).priority) || (headroomOnly && !privileged)) {
+                    continue;
+                }
+                
+                if (!bucket.tryAcquire(privileged, now)) {
+                    if (privileged) {
+                        break;
+                    }
+                    headroomOnly = true;
+                    continue;
+                }
+                
+                RequestContext context = queue.takeAt(index);
+                dispatchRequest(context);
+                dispatched = true;
+                break;
             }
         }
     }
     
-    QString countryName() const override { return "Vietnam"; }
-    QString currencyCode() const override { return "VND"; }
-    QString regulator() const override { return "State Bank of Vietnam (SBV)"; }
-    double kycThreshold() const override { return 20000000.0; }
-};
+    scheduleQueueDrain();
+}
 
-/**
- * @brief Laos compliance module
- */
-class LaosComplianceModule : public CountryComplianceModule {
-public:
-    void validatePayment(const PaymentDetails& paymentDetails) override {
-        if (currencyCode() == paymentDetails.currency()) {
-            if (paymentDetails.amount() >= kycThreshold() && 
-                    paymentDetails.customerName().isEmpty()) {
-                throw std::invalid_argument("KYC information required for payments above " + 
-                        QString::number(kycThreshold()).toStdString() + " " + currencyCode().toStdString());
+void AsianCryptoPayment::scheduleQueueDrain() {
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    qint64 wait = -1;
+    
+    for (auto it = m_requestQueues.begin(); it != m_requestQueues.end(); ++it) {
+        // Requests in full lanes are woken when a reply frees a slot; a
+        // createPayment behind a held-back request may go sooner on headroom
+        bool headroomOnly = false;
+        for (const RequestContext& next : it.value()) {
+            bool privileged = next.type == RequestType::CreatePayment;
+            if (!laneHasCapacity(next.priority) || (headroomOnly && !privileged)) {
+                continue;
+            }
+            
+            qint64 classWait = m_rateLimits[it.key()].msUntilAvailable(privileged, now);
+            wait = wait < 0 ? classWait : qMin(wait, classWait);
+            
+            if (privileged) {
+                break;
             }
+            headroomOnly = true;
         }
     }
     
-    QString countryName() const override { return "Laos"; }
-    QString currencyCode() const override { return "LAK"; }
-    QString regulator() const override { return "Bank of the Lao PDR (BOL)"; }
-    double kycThreshold() const override { return 9000000.0; }
-};
-
-/**
- * @brief Create country-specific compliance module
- * @param countryCode Country code
- * @return CountryComplianceModule instance
- */
-inline std::unique_ptr<CountryComplianceModule> createCountryModule(CountryCode countryCode) {
-    switch (countryCode) {
-        case CountryCode::Malaysia:
-            return std::make_unique<MalaysiaComplianceModule>();
-        case CountryCode::Singapore:
-            return std::make_unique<SingaporeComplianceModule>();
-        case CountryCode::Indonesia:
-            return std::make_unique<IndonesiaComplianceModule>();
-        case CountryCode::Thailand:
-            return std::make_unique<ThailandComplianceModule>();
-        case CountryCode::Brunei:
-            return std::make_unique<BruneiComplianceModule>();
-        case CountryCode::Cambodia:
-            return std::make_unique<CambodiaComplianceModule>();
-        case CountryCode::Vietnam:
-            return std::make_unique<VietnamComplianceModule>();
-        case CountryCode::Laos:
-            return std::make_unique<LaosComplianceModule>();
-        default:
-            return std::make_unique<MalaysiaComplianceModule>();
+    if (wait < 0) {
+        m_schedulerTimer->stop();
+    } else {
+        m_schedulerTimer->start(int(qBound<qint64>(1, wait, 60000)));
     }
 }
 
-/**
- * @brief AsianCryptoPayment implementation
- */
-AsianCryptoPayment::AsianCryptoPayment(const QString& apiKey, const QString& merchantId, CountryCode countryCode, QObject* parent)
-    : QObject(parent)
-    , m_apiKey(apiKey)
-    , m_merchantId(merchantId)
-    , m_countryCode(countryCode)
-    , m_networkManager(new QNetworkAccessManager(this))
-    , m_countryModule(createCountryModule(countryCode))
-    , m_securityModule(std::make_unique<SecurityModule>(apiKey))
-{
-    // Default supported cryptocurrencies
-    m_supportedCryptocurrencies << "BTC" << "ETH" << "USDT" << "USDC" << "BNB";
+bool AsianCryptoPayment::handleRateLimitHeaders(QNetworkReply* reply, RequestContext& context) {
+    const int maxRateLimitRetries = 3;
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    TokenBucket& bucket = m_rateLimits[context.endpointClass];
+    bool ok = false;
+    
+    int limit = reply->rawHeader("X-RateLimit-Limit").toInt(&ok);
+    if (!ok) {
+        limit = -1;
+    }
     
-    // Connect network manager
-    connect(m_networkManager, &QNetworkAccessManager::finished, this, &AsianCryptoPayment::onNetworkReply);
+    int remaining = reply->rawHeader("X-RateLimit-Remaining").toInt(&ok);
+    if (!ok) {
+        remaining = -1;
+    }
     
-    qDebug() << "SDK initialized for country:" << m_countryModule->countryName();
+    qint64 resetAt = reply->rawHeader("X-RateLimit-Reset").toLongLong(&ok) * 1000;
+    if (!ok) {
+        resetAt = 0;
+    }
+    
+    bucket.update(limit, remaining, resetAt, now);
+    
+    if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 429) {
+        return false;
+    }
+    
+    m_statistics.rateLimitedResponses++;
+    
+    // Hold the whole endpoint class until the server says it may continue
+    int retryAfter = reply->rawHeader("Retry-After").toInt(&ok);
+    if (ok) {
+        bucket.blockUntil(now + retryAfter * 1000);
+    } else {
+        bucket.blockUntil(resetAt > now ? resetAt : now + 1000);
+    }
+    
+    if (++context.rateLimitedCount > maxRateLimitRetries) {
+        return false;
+    }
+    
+    enqueueRequest(context, true);
+    return true;
 }
 
-AsianCryptoPayment::~AsianCryptoPayment() {
-    // Stop all payment timers
-    for (auto timer : m_paymentTimers.values()) {
-        timer->stop();
-        timer->deleteLater();
+bool AsianCryptoPayment::refetchUncachedResponse(QNetworkReply* reply, RequestContext& context) {
+    // A 304 whose cache entry has been evicted or cleared meanwhile has no
+    // body to serve. Without the entry the request goes out again with no
+    // validators and gets the full body; a second 304 is an error
+    if (context.request.method != "GET" || context.refetched ||
+            reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 304 ||
+            m_responseCache.contains(context.request.endpoint)) {
+        return false;
     }
-    m_paymentTimers.clear();
+    
+    context.refetched = true;
+    enqueueRequest(context, true);
+    return true;
 }
 
-void AsianCryptoPayment::setTestMode(bool testMode) {
-    m_testMode = testMode;
+bool AsianCryptoPayment::isTransientFailure(QNetworkReply* reply) {
+    switch (reply->error()) {
+        case QNetworkReply::ConnectionRefusedError:
+        case QNetworkReply::RemoteHostClosedError:
+        case QNetworkReply::HostNotFoundError:
+        case QNetworkReply::TimeoutError:
+        case QNetworkReply::TemporaryNetworkFailureError:
+        case QNetworkReply::NetworkSessionFailedError:
+        case QNetworkReply::UnknownNetworkError:
+        case QNetworkReply::ProxyTimeoutError:
+            return true;
+        default:
+            break;
+    }
+    
+    int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    return statusCode == 408 || statusCode == 500 || statusCode == 502 ||
+           statusCode == 503 || statusCode == 504;
 }
 
-void AsianCryptoPayment::setApiEndpoint(const QString& apiEndpoint) {
-    m_apiEndpoint = apiEndpoint;
+bool AsianCryptoPayment::decodeResponse(QNetworkReply* reply, const RequestContext& context, QJsonObject& response) {
+    QString cacheKey = context.request.endpoint;
+    bool cacheable = context.request.method == "GET";
+    int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    
+    // Not modified: reuse the decoded object without reading the body
+    if (cacheable && statusCode == 304) {
+        const CachedResponse* cached = m_responseCache.object(cacheKey);
+        if (!cached) {
+            return false;
+        }
+        
+        m_statistics.responseCacheHits++;
+        response = cached->response;
+        return true;
+    }
+    
+    // QNetworkAccessManager advertises gzip and deflate itself and inflates
+    // the body as it arrives; the original length is what crossed the wire
+    QByteArray body = reply->readAll();
+    QVariant wireLength = reply->attribute(QNetworkRequest::OriginalContentLengthAttribute);
+    
+    m_statistics.responseBodyBytes += quint64(body.size());
+    m_statistics.responseWireBytes += wireLength.isValid() ? wireLength.toULongLong() : quint64(body.size());
+    
+    QJsonDocument doc = QJsonDocument::fromJson(body);
+    if (doc.isNull() || !doc.isObject()) {
+        return false;
+    }
+    
+    response = doc.object();
+    
+    if (cacheable) {
+        cacheResponse(reply, context, response);
+    }
+    
+    return true;
 }
 
-void AsianCryptoPayment::setSupportedCryptocurrencies(const QStringList& supportedCryptocurrencies) {
-    m_supportedCryptocurrencies = supportedCryptocurrencies;
+void AsianCryptoPayment::cacheResponse(QNetworkReply* reply, const RequestContext& context, const QJsonObject& response,
+                                       const QList<Payment>& payments) {
+    m_statistics.responseCacheMisses++;
+    
+    QByteArray etag = reply->rawHeader("ETag");
+    QByteArray lastModified = reply->rawHeader("Last-Modified");
+    
+    if (etag.isEmpty() && lastModified.isEmpty()) {
+        m_responseCache.remove(context.request.endpoint);
+        return;
+    }
+    
+    CachedResponse* entry = new CachedResponse;
+    entry->etag = etag;
+    entry->lastModified = lastModified;
+    entry->response = response;
+    entry->payments = payments;
+    m_responseCache.insert(context.request.endpoint, entry);
 }
 
-void AsianCryptoPayment::setWebhookConfig(const QString& webhookEndpoint, const QString& webhookSecret) {
-    m_webhookConfig["endpoint"] = webhookEndpoint;
-    m_webhookConfig["secret"] = webhookSecret;
+bool AsianCryptoPayment::submitOutboundOperation(const RequestContext& context) {
+    if (m_outboundQueuePath.isEmpty() ||
+            (context.type != RequestType::CreatePayment && context.type != RequestType::CancelPayment)) {
+        return false;
+    }
+    
+    // Creates are independent; operations on an existing payment are ordered
+    OutboundOperation operation;
+    operation.key = context.type == RequestType::CancelPayment ? context.id : QString(context.request.idempotencyKey);
+    operation.queuedAt = QDateTime::currentMSecsSinceEpoch();
+    operation.context = context;
+    
+    for (const OutboundOperation& earlier : m_outboundOperations) {
+        if (earlier.key == operation.key) {
+            operation.parked = true;
+            break;
+        }
+    }
+    
+    m_outboundOperations.insert(m_nextOutboundSequence++, operation);
+    saveOutboundQueue();
+    
+    if (!operation.parked) {
+        enqueueRequest(context);
+    }
+    
+    return true;
 }
 
-void AsianCryptoPayment::createPayment(const PaymentDetails& paymentDetails) {
-    try {
-        // Validate payment details
-        validatePaymentDetails(paymentDetails);
-        
-        // Apply country-specific validations
-        m_countryModule->validatePayment(paymentDetails);
+bool AsianCryptoPayment::parkOutboundOperation(const RequestContext& context) {
+    for (auto it = m_outboundOperations.begin(); it != m_outboundOperations.end(); ++it) {
+        if (it->context.requestId != context.requestId) {
+            continue;
+        }
         
-        // Prepare payment data
-        QJsonObject paymentData = paymentDetails.toJson();
-        paymentData["merchant_id"] = m_merchantId;
-        paymentData["country_code"] = countryCodeToString(m_countryCode);
-        paymentData["test_mode"] = m_testMode;
+        // Resent with a fresh retry budget once the API is reachable again
+        it->parked = true;
+        it->context.attempt = 1;
+        it->context.rateLimitedCount = 0;
+        m_statistics.operationsDeferred++;
         
-        // Make API request
-        makeApiRequest("payments", "POST", paymentData);
-    } catch (const std::exception& e) {
-        emit error(400, QString::fromStdString(e.what()));
+        if (!m_outboundTimer->isActive()) {
+            m_outboundTimer->start(15000);
+        }
+        return true;
     }
+    
+    return false;
 }
 
-void AsianCryptoPayment::getPayment(const QString& paymentId) {
-    if (paymentId.isEmpty()) {
-        emit error(400, "Payment ID is required");
-        return;
+void AsianCryptoPayment::completeOutboundOperation(quint64 requestId) {
+    for (auto it = m_outboundOperations.begin(); it != m_outboundOperations.end(); ++it) {
+        if (it->context.requestId == requestId) {
+            QString key = it->key;
+            m_outboundOperations.erase(it);
+            saveOutboundQueue();
+            
+            // Release the next operation on the same payment
+            for (auto next = m_outboundOperations.begin(); next != m_outboundOperations.end(); ++next) {
+                if (next->key == key) {
+                    if (next->parked) {
+                        QTimer::singleShot(0, this, &AsianCryptoPayment::drainOutboundQueue);
+                    }
+                    break;
+                }
+            }
+            return;
+        }
     }
-    
-    QString endpoint = "payments/" + paymentId;
-    makeApiRequest(endpoint, "GET");
 }
 
-void AsianCryptoPayment::getPayments(const PaymentFilters& filters) {
-    QString endpoint = "payments";
+void AsianCryptoPayment::drainOutboundQueue() {
+    QSet<QString> busyKeys;
+    QList<quint64> released;
+    bool parked = false;
+    
+    // Only the oldest operation per key may be on its way
+    for (auto it = m_outboundOperations.cbegin(); it != m_outboundOperations.cend(); ++it) {
+        if (busyKeys.contains(it->key)) {
+            parked = parked || it->parked;
+            continue;
+        }
+        busyKeys.insert(it->key);
+        
+        if (it->parked) {
+            released.append(it.key());
+        }
+    }
     
-    // Add query parameters if filters are provided
-    QString queryString = filters.buildQueryString();
-    if (!queryString.isEmpty()) {
-        endpoint += "?" + queryString;
+    // Sending can expire a request and complete its operation, so each one
+    // is looked up again and sent from a copy
+    for (quint64 sequence : released) {
+        auto it = m_outboundOperations.find(sequence);
+        if (it == m_outboundOperations.end()) {
+            continue;
+        }
+        
+        it->parked = false;
+        RequestContext context = it->context;
+        enqueueRequest(context);
     }
     
-    makeApiRequest(endpoint, "GET");
+    if (!parked) {
+        m_outboundTimer->stop();
+    }
 }
 
-void AsianCryptoPayment::cancelPayment(const QString& paymentId) {
-    if (paymentId.isEmpty()) {
-        emit error(400, "Payment ID is required");
+void AsianCryptoPayment::loadOutboundQueue() {
+    // Operations restored from disk get new request IDs and are resent with
+    // their original idempotency keys, so the server applies them once
+    QFile file(m_outboundQueuePath);
+    if (m_outboundQueuePath.isEmpty() || !file.open(QIODevice::ReadOnly)) {
         return;
     }
     
-    QString endpoint = "payments/" + paymentId + "/cancel";
-    makeApiRequest(endpoint, "POST");
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    while (!file.atEnd()) {
+        QJsonObject entry = QJsonDocument::fromJson(file.readLine()).object();
+        if (entry.isEmpty()) {
+            continue;
+        }
+        
+        RequestContext context;
+        if (!outboundTypeFromName(entry["type"].toString(), context.type)) {
+            qWarning() << "Skipping unknown outbound operation:" << entry["type"].toVariant().toString();
+            continue;
+        }
+        
+        context.id = entry["id"].toString();
+        context.request = prepareApiRequest(entry["endpoint"].toString(), entry["method"].toString(),
+                                            QJsonDocument::fromJson(entry["body"].toString().toUtf8()).object());
+        context.request.idempotencyKey = entry["idempotency_key"].toString().toLatin1();
+        context.endpointClass = routeFor(context.type).endpointClass;
+        context.priority = defaultPriority(context.type);
+        context.submittedAt = now;
+        context.requestId = m_nextRequestId++;
+        m_liveRequests.insert(context.requestId);
+        
+        OutboundOperation operation;
+        operation.key = entry["key"].toString();
+        operation.queuedAt = qint64(entry["queued_at"].toDouble());
+        operation.parked = true;
+        operation.context = context;
+        m_outboundOperations.insert(m_nextOutboundSequence++, operation);
+    }
+    
+    if (!m_outboundOperations.isEmpty()) {
+        m_outboundTimer->start(15000);
+        QTimer::singleShot(0, this, &AsianCryptoPayment::drainOutboundQueue);
+    }
 }
 
-void AsianCryptoPayment::getExchangeRates(const QString& baseCurrency, const QStringList& cryptoCurrencies) {
-    if (baseCurrency.isEmpty()) {
-        emit error(400, "Base currency is required");
+void AsianCryptoPayment::saveOutboundQueue() {
+    if (m_outboundQueuePath.isEmpty()) {
         return;
     }
     
-    QStringList currencies = cryptoCurrencies.isEmpty() ? m_supportedCryptocurrencies : cryptoCurrencies;
+    QSaveFile file(m_outboundQueuePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to write outbound queue:" << m_outboundQueuePath;
+        return;
+    }
     
-    QString endpoint = "exchange-rates?base_currency=" + baseCurrency + "&currencies=" + currencies.join(",");
-    makeApiRequest(endpoint, "GET");
-}
-
-bool AsianCryptoPayment::verifyWebhookSignature(const QString& signature, const QString& body) {
-    if (!m_webhookConfig.contains("secret")) {
-        qWarning() << "Webhooks not initialized";
-        return false;
+    // One JSON document per line, oldest first
+    for (const OutboundOperation& operation : m_outboundOperations) {
+        const PreparedRequest& request = operation.context.request;
+        
+        QJsonObject entry;
+        entry["type"] = outboundTypeName(operation.context.type);
+        entry["id"] = operation.context.id;
+        entry["key"] = operation.key;
+        entry["endpoint"] = request.endpoint;
+        entry["method"] = QString::fromLatin1(request.method);
+        entry["body"] = QString::fromUtf8(request.body);
+        entry["idempotency_key"] = QString::fromLatin1(request.idempotencyKey);
+        entry["queued_at"] = double(operation.queuedAt);
+        
+        file.write(QJsonDocument(entry).toJson(QJsonDocument::Compact) + "\n");
     }
     
-    QString secret = m_webhookConfig["secret"].toString();
-    return m_securityModule->verifySignature(signature, body, secret);
+    file.commit();
 }
 
-bool AsianCryptoPayment::processWebhookEvent(const QJsonObject& event, const QString& signature) {
-    if (m_webhookConfig.isEmpty()) {
-        qWarning() << "Webhooks not initialized";
+bool AsianCryptoPayment::fallBackFromHttp2(QNetworkReply* reply, RequestContext& context) {
+    if (!http2Active() || reply->error() != QNetworkReply::ProtocolFailure) {
         return false;
     }
     
-    // Verify signature
-    QJsonDocument doc(event);
-    QString eventString = doc.toJson(QJsonDocument::Compact);
-    bool isValid = verifyWebhookSignature(signature, eventString);
+    // Intermediaries that break HTTP/2 framing surface as protocol failures;
+    // switch to HTTP/1.1 for the rest of the session and resend
+    qWarning() << "HTTP/2 protocol failure, falling back to HTTP/1.1:" << reply->errorString();
     
-    if (!isValid) {
-        qWarning() << "Invalid webhook signature";
+    m_http2FellBack = true;
+    m_statistics.http2Fallbacks++;
+    rebuildRequestTemplate();
+    m_prewarmTimer->start(0);
+    
+    enqueueRequest(context, true);
+    return true;
+}
+
+bool AsianCryptoPayment::retryRequest(QNetworkReply* reply, RequestContext& context) {
+    if (reply->error() == QNetworkReply::NoError || !isTransientFailure(reply)) {
         return false;
     }
     
-    // Process event
-    try {
-        QString eventType = event["type"].toString();
-        
-        if (event.contains("data") && event["data"].isObject()) {
-            Payment payment = Payment::fromJson(event["data"].toObject());
-            
-            if (eventType == "payment.created") {
-                emit paymentCreated(payment);
-            } else if (eventType == "payment.updated") {
-                emit paymentStatusUpdated(payment);
-            } else if (eventType == "payment.completed") {
-                emit paymentStatusUpdated(payment);
-                stopPaymentStatusCheck(payment.id());
-            } else if (eventType == "payment.cancelled") {
-                emit paymentStatusUpdated(payment);
-                stopPaymentStatusCheck(payment.id());
-            } else if (eventType == "payment.expired") {
-                emit paymentStatusUpdated(payment);
-                stopPaymentStatusCheck(payment.id());
-            }
+    RetryPolicy policy = m_retryPolicies.value(context.type, RetryPolicy(1));
+    if (context.attempt >= policy.maxAttempts || !m_liveRequests.contains(context.requestId)) {
+        if (policy.maxAttempts > 1) {
+            m_statistics.retriesExhausted++;
         }
-        
-        return true;
-    } catch (const std::exception& e) {
-        qWarning() << "Failed to process webhook event:" << e.what();
         return false;
     }
-}
-
-void AsianCryptoPayment::downloadQrCode(const QString& url) {
-    if (url.isEmpty()) {
-        emit error(400, "QR code URL is required");
-        return;
+    
+    // Exponential backoff with jitter, capped at the policy maximum
+    double delay = qMin<double>(policy.maxDelayMs, policy.baseDelayMs * double(1 << qMin(context.attempt - 1, 16)));
+    delay *= 1.0 - policy.jitter * QRandomGenerator::global()->generateDouble();
+    
+    // The region that failed has been left; resend to the new one at once
+    if (context.region != m_apiEndpoint) {
+        delay = 0;
     }
     
-    QNetworkRequest request(url);
-    QNetworkReply* reply = m_networkManager->get(request);
+    // A retry that cannot start before the deadline would only delay the error
+    if (context.deadline > 0 && QDateTime::currentMSecsSinceEpoch() + qint64(delay) >= context.deadline) {
+        return false;
+    }
     
-    RequestContext context;
-    context.type = RequestType::DownloadQrCode;
-    m_pendingRequests[reply] = context;
+    context.attempt++;
+    m_statistics.retries++;
     
-    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
-        onQrCodeDownloaded(reply);
+    RequestContext retry = context;
+    QTimer::singleShot(int(delay), this, [this, retry]() {
+        enqueueRequest(retry, true);
     });
+    
+    return true;
 }
 
-void AsianCryptoPayment::validatePaymentDetails(const PaymentDetails& paymentDetails) {
-    if (paymentDetails.amount() <= 0.0) {
-        throw std::invalid_argument("Payment amount must be greater than zero");
-    }
+void AsianCryptoPayment::onNetworkReply(QNetworkReply* reply) {
+    StreamedPage page = m_streamedPages.take(reply);
     
-    if (paymentDetails.currency().isEmpty()) {
-        throw std::invalid_argument("Currency is required");
+    if (!m_pendingRequests.contains(reply)) {
+        reply->deleteLater();
+        return;
     }
     
-    if (paymentDetails.cryptoCurrency().isEmpty()) {
-        throw std::invalid_argument("Cryptocurrency is required");
+    RequestContext context = m_pendingRequests.take(reply);
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    
+    if (isTransientFailure(reply)) {
+        m_circuitBreakers[context.endpointClass].recordFailure(context.sentAt, now);
+        recordRegionOutcome(context.region, true, context.sentAt, now);
+    } else {
+        m_circuitBreakers[context.endpointClass].recordSuccess(context.sentAt, now);
+        recordRegionOutcome(context.region, false, context.sentAt, now);
     }
     
-    if (!m_supportedCryptocurrencies.contains(paymentDetails.cryptoCurrency())) {
-        throw std::invalid_argument("Unsupported cryptocurrency. Must be one of: " + 
-                m_supportedCryptocurrencies.join(", ").toStdString());
+    if (reply->error() == QNetworkReply::NoError) {
+        m_latencies[context.endpointClass].addSample(int(now - context.sentAt));
+        
+        if (reply->attribute(QNetworkRequest::Http2WasUsedAttribute).toBool()) {
+            m_statistics.http2Requests++;
+        }
+        
+        if (reply->property("cold_connection").toBool()) {
+            m_statistics.coldConnectionRequests++;
+            m_statistics.coldConnectionLatencyMs += quint64(now - context.sentAt);
+        } else {
+            m_statistics.warmConnectionRequests++;
+            m_statistics.warmConnectionLatencyMs += quint64(now - context.sentAt);
+        }
     }
-}
-
-QNetworkRequest AsianCryptoPayment::createApiRequest(const QString& endpoint, const QJsonObject& data) {
-    QString url = m_apiEndpoint + "/" + endpoint;
-    QNetworkRequest request(url);
     
-    QString timestamp = QString::number(QDateTime::currentMSecsSinceEpoch());
+    m_lastNetworkActivity = now;
     
-    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
-    request.setRawHeader("X-Merchant-ID", m_merchantId.toUtf8());
-    request.setRawHeader("X-Timestamp", timestamp.toUtf8());
-    request.setRawHeader("X-Test-Mode", m_testMode ? "true" : "false");
-    request.setRawHeader("User-Agent", "AsianCryptoPayment-Qt/1.0.0");
+    if (context.type == RequestType::PollPayments || context.type == RequestType::GetPayment) {
+        applyPollHint(reply, context);
+    }
     
-    if (!data.isEmpty()) {
-        QJsonDocument doc(data);
-        QString dataString = doc.toJson(QJsonDocument::Compact);
-        QString signature = m_securityModule->generateSignature(dataString, timestamp);
-        request.setRawHeader("X-Signature", signature.toUtf8());
+    if (resolveHedgedReply(reply, context)) {
+        reply->deleteLater();
+        return;
     }
     
-    return request;
-}
-
-void AsianCryptoPayment::makeApiRequest(const QString& endpoint, const QString& method, const QJsonObject& data) {
-    QNetworkRequest request = createApiRequest(endpoint, data);
-    QNetworkReply* reply = nullptr;
+    bool resent = fallBackFromHttp2(reply, context) || handleRateLimitHeaders(reply, context) ||
+            retryRequest(reply, context) || refetchUncachedResponse(reply, context);
     
-    if (method == "GET") {
-        reply = m_networkManager->get(request);
-    } else if (method == "POST") {
-        QJsonDocument doc(data);
-        QByteArray requestData = doc.toJson(QJsonDocument::Compact);
-        reply = m_networkManager->post(request, requestData);
-    } else if (method == "PUT") {
-        QJsonDocument doc(data);
-        QByteArray requestData = doc.toJson(QJsonDocument::Compact);
-        reply = m_networkManager->put(request, requestData);
-    } else if (method == "DELETE") {
-        reply = m_networkManager->deleteResource(request);
+    // The request's lane slot is free again. Queued requests go out only now,
+    // once this reply's rate limit headers have updated the budget
+    m_laneInFlight[context.priority]--;
+    if (reply->error() == QNetworkReply::NoError) {
+        m_laneLatencies[context.priority].addSample(int(now - context.submittedAt));
     }
+    drainRequestQueues();
     
-    if (reply) {
-        RequestContext context;
-        
-        if (endpoint.startsWith("payments") && method == "POST" && !endpoint.contains("/cancel")) {
-            context.type = RequestType::CreatePayment;
-        } else if (endpoint.startsWith("payments/") && method == "GET") {
-            context.type = RequestType::GetPayment;
-            context.id = endpoint.mid(9);
-        } else if (endpoint.startsWith("payments") && method == "GET") {
-            context.type = RequestType::GetPayments;
-        } else if (endpoint.contains("/cancel")) {
-            context.type = RequestType::CancelPayment;
-            context.id = endpoint.mid(9, endpoint.indexOf("/cancel") - 9);
-        } else if (endpoint.startsWith("exchange-rates")) {
-            context.type = RequestType::GetExchangeRates;
-        }
-        
-        m_pendingRequests[reply] = context;
+    if (resent) {
+        reply->deleteLater();
+        return;
     }
-}
-
-void AsianCryptoPayment::onNetworkReply(QNetworkReply* reply) {
-    if (!m_pendingRequests.contains(reply)) {
+    
+    // Unreachable API: keep durable operations for later instead of failing
+    if (isTransientFailure(reply) && parkOutboundOperation(context)) {
         reply->deleteLater();
         return;
     }
     
-    RequestContext context = m_pendingRequests.take(reply);
+    // Status checks only report to callers that attached to them
+    QSet<quint64> callers = m_requestAttachments.value(context.requestId);
+    callers.remove(context.requestId);
+    bool attached = !callers.isEmpty();
+    finishRequest(context.requestId);
+    
+    if (reply->error() == QNetworkReply::NoError && m_outboundTimer->isActive()) {
+        drainOutboundQueue();
+    }
     
     if (reply->error() != QNetworkReply::NoError) {
-        emit error(reply->error(), reply->errorString());
+        int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        
+        // A server without multi-id lookup rejects the batch; poll one by one
+        if (context.type == RequestType::PollPayments &&
+                (statusCode == 400 || statusCode == 404 || statusCode == 405 || statusCode == 501)) {
+            m_batchPollingSupported = false;
+            pollPaymentsIndividually(context.paymentIds);
+            reply->deleteLater();
+            return;
+        }
+        
+        failRequest(context, reply->error(), reply->errorString());
         reply->deleteLater();
         return;
     }
     
-    QByteArray responseData = reply->readAll();
-    QJsonDocument doc = QJsonDocument::fromJson(responseData);
+    QJsonObject response;
+    bool streamed = page.parser.hasStarted();
     
-    if (doc.isNull() || !doc.isObject()) {
-        emit error(500, "Invalid JSON response");
+    if (streamed) {
+        for (const Payment& payment : feedStreamedPage(page, reply->readAll())) {
+            if (page.announce) {
+                emit paymentStreamed(payment);
+            }
+        }
+        
+        QVariant wireLength = reply->attribute(QNetworkRequest::OriginalContentLengthAttribute);
+        m_statistics.responseWireBytes += wireLength.isValid() ? wireLength.toULongLong() : page.bytes;
+    }
+    
+    // A page that cannot be read ends its history walk or sync like any failure
+    if (!(streamed ? page.parser.finish(response) : decodeResponse(reply, context, response))) {
+        failRequest(context, 500, "Invalid JSON response");
         reply->deleteLater();
         return;
     }
     
-    QJsonObject response = doc.object();
+    // Streamed pages are cached decoded; an unchanged page comes back from
+    // the cache with its payments and is announced at once
+    if (streamed) {
+        cacheResponse(reply, context, response, page.payments);
+    } else if (context.type == RequestType::GetPayments &&
+               reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 304) {
+        page.payments = m_responseCache.object(context.request.endpoint)->payments;
+        
+        if (page.announce) {
+            for (const Payment& payment : page.payments) {
+                emit paymentStreamed(payment);
+            }
+        }
+    }
     
     try {
         switch (context.type) {
             case RequestType::CreatePayment: {
                 Payment payment = Payment::fromJson(response);
                 m_activePayments[payment.id()] = payment;
+                acceptPaymentRevision(payment);
                 startPaymentStatusCheck(payment);
                 emit paymentCreated(payment);
                 break;
             }
             case RequestType::GetPayment: {
                 Payment payment = Payment::fromJson(response);
-                emit paymentRetrieved(payment);
+                if (m_activePayments.contains(payment.id()) || context.statusCheck) {
+                    payment = applyPolledPayment(payment);
+                } else {
+                    acceptPaymentRevision(payment);
+                }
+                
+                if (!context.statusCheck || attached) {
+                    emit paymentRetrieved(payment);
+                }
+                break;
+            }
+            case RequestType::PollPayments: {
+                handlePollReply(context.paymentIds, response);
                 break;
             }
             case RequestType::GetPayments: {
-                QList<Payment> payments;
+                QList<Payment> payments = page.payments;
                 int total = response["total"].toInt();
                 
-                if (response.contains("payments") && response["payments"].isArray()) {
+                if (!streamed && response.contains("payments") && response["payments"].isArray()) {
                     QJsonArray paymentsArray = response["payments"].toArray();
                     
                     for (const QJsonValue& value : paymentsArray) {
@@ -1580,11 +4905,24 @@ void AsianCryptoPayment::onNetworkReply(QNetworkReply* reply) {
                     }
                 }
                 
+                // History walks and syncs deliver pages their own way
+                if (context.historyId != 0) {
+                    handleHistoryPage(context, payments, response);
+                    break;
+                }
+                if (context.syncId != 0) {
+                    handleSyncPage(context, payments, response);
+                    break;
+                }
+                
                 emit paymentsRetrieved(payments, total);
                 break;
             }
             case RequestType::CancelPayment: {
+                // Recorded so that the cancellation arriving again by webhook,
+                // or a check answered before it, is not reported afterwards
                 Payment payment = Payment::fromJson(response);
+                acceptPaymentRevision(payment);
                 stopPaymentStatusCheck(payment.id());
                 emit paymentCancelled(payment);
                 break;
@@ -1607,14 +4945,58 @@ void AsianCryptoPayment::onNetworkReply(QNetworkReply* reply) {
             default:
                 break;
         }
+        
+        m_statistics.requestsSucceeded++;
     } catch (const std::exception& e) {
-        emit error(500, QString::fromStdString(e.what()));
+        failRequest(context, 500, QString::fromStdString(e.what()));
     }
     
     reply->deleteLater();
 }
 
+void AsianCryptoPayment::onStreamedReplyData(QNetworkReply* reply) {
+    auto it = m_streamedPages.find(reply);
+    
+    // Only successful pages are streamed; anything else takes the normal path
+    if (it == m_streamedPages.end() || reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 200) {
+        return;
+    }
+    
+    // Emitted after the page is updated, in case a slot starts another request
+    bool announce = it->announce;
+    for (const Payment& payment : feedStreamedPage(*it, reply->readAll())) {
+        if (announce) {
+            emit paymentStreamed(payment);
+        }
+    }
+}
+
+QList<Payment> AsianCryptoPayment::feedStreamedPage(StreamedPage& page, const QByteArray& data) {
+    page.bytes += quint64(data.size());
+    m_statistics.responseBodyBytes += quint64(data.size());
+    page.parser.feed(data);
+    
+    QList<Payment> payments;
+    for (const QJsonObject& element : page.parser.takeElements()) {
+        payments.append(Payment::fromJson(element));
+    }
+    
+    page.payments.append(payments);
+    return payments;
+}
+
 void AsianCryptoPayment::onQrCodeDownloaded(QNetworkReply* reply) {
+    quint64 requestId = reply->property("request_id").toULongLong();
+    
+    // Cancelled or expired; already reported if needed
+    if (!m_liveRequests.contains(requestId)) {
+        reply->deleteLater();
+        return;
+    }
+    
+    m_inflightReplies.remove(requestId);
+    finishRequest(requestId);
+    
     if (reply->error() != QNetworkReply::NoError) {
         emit error(reply->error(), reply->errorString());
         reply->deleteLater();
@@ -1634,40 +5016,542 @@ void AsianCryptoPayment::onQrCodeDownloaded(QNetworkReply* reply) {
 }
 
 void AsianCryptoPayment::startPaymentStatusCheck(const Payment& payment) {
-    if (m_paymentTimers.contains(payment.id())) {
+    if (m_statusChecks.contains(payment.id())) {
         return;
     }
     
-    QTimer* timer = new QTimer(this);
-    m_paymentTimers[payment.id()] = timer;
+    // An idle wheel has not been advanced; catch up so the delay counts from now
+    if (m_statusChecks.size() == 0) {
+        m_statusChecks.advance(m_statusCheckClock.elapsed());
+    }
+    
+    m_statusCheckStates.insert(payment.id(), StatusCheckState());
+    scheduleStatusCheck(payment.id());
+    sendPushSubscription("subscribe", QStringList() << payment.id());
+    
+    // Already past expiry: only the last check is left, and it goes out
+    // with the next batch
+    if (!m_statusChecks.contains(payment.id())) {
+        m_duePaymentChecks.insert(payment.id());
+        m_statusCheckStates[payment.id()].checks++;
+        
+        if (!m_pollBatchTimer->isActive()) {
+            m_pollBatchTimer->start(500);
+        }
+        return;
+    }
     
-    connect(timer, &QTimer::timeout, this, &AsianCryptoPayment::checkPaymentStatus);
-    timer->setProperty("payment_id", payment.id());
-    timer->start(10000); // Check every 10 seconds
+    if (!m_statusCheckTimer->isActive()) {
+        m_statusCheckTimer->start(m_statusChecks.tickMs());
+    }
 }
 
 void AsianCryptoPayment::stopPaymentStatusCheck(const QString& paymentId) {
-    if (m_paymentTimers.contains(paymentId)) {
-        QTimer* timer = m_paymentTimers.take(paymentId);
-        timer->stop();
-        timer->deleteLater();
+    m_statusChecks.cancel(paymentId);
+    m_activePayments.remove(paymentId);
+    
+    if (m_statusCheckStates.remove(paymentId) > 0) {
+        m_statistics.statusCheckedPayments++;
+        sendPushSubscription("unsubscribe", QStringList() << paymentId);
     }
     
-    m_activePayments.remove(paymentId);
+    if (m_statusChecks.size() == 0) {
+        m_statusCheckTimer->stop();
+    }
 }
 
 void AsianCryptoPayment::checkPaymentStatus() {
-    QTimer* timer = qobject_cast<QTimer*>(sender());
-    if (!timer) {
+    QStringList due = m_statusChecks.advance(m_statusCheckClock.elapsed());
+    if (due.isEmpty()) {
         return;
     }
     
-    QString paymentId = timer->property("payment_id").toString();
-    if (paymentId.isEmpty()) {
+    // Collect due payments and poll them together in one request
+    for (const QString& paymentId : due) {
+        m_duePaymentChecks.insert(paymentId);
+        m_statusCheckStates[paymentId].checks++;
+        scheduleStatusCheck(paymentId);
+    }
+    
+    if (!m_pollBatchTimer->isActive()) {
+        m_pollBatchTimer->start(500);
+    }
+}
+
+void AsianCryptoPayment::pollDuePayments() {
+    const int pollHorizon = 5000;
+    const int maxBatchSize = 100;
+    
+    // Payments whose next check is close join this batch; rescheduling them
+    // keeps them in step so later batches stay large
+    for (const QString& paymentId : m_statusChecks.takeDueWithin(pollHorizon)) {
+        m_duePaymentChecks.insert(paymentId);
+        m_statusCheckStates[paymentId].checks++;
+        scheduleStatusCheck(paymentId);
+    }
+    
+    QStringList due;
+    for (const QString& paymentId : m_duePaymentChecks) {
+        if (m_activePayments.contains(paymentId)) {
+            due.append(paymentId);
+        }
+    }
+    m_duePaymentChecks.clear();
+    m_statistics.statusChecks += quint64(due.size());
+    
+    if (!m_batchPollingSupported) {
+        pollPaymentsIndividually(due);
+    } else {
+        for (int i = 0; i < due.size(); i += maxBatchSize) {
+            QStringList batch = due.mid(i, maxBatchSize);
+            
+            QStringList ids;
+            for (const QString& paymentId : batch) {
+                ids << QString::fromLatin1(QUrl::toPercentEncoding(paymentId));
+            }
+            
+            QString endpoint = QString("payments?ids=%1&limit=%2").arg(ids.join(","), QString::number(batch.size()));
+            RequestContext context = newRequestContext(RequestType::PollPayments, endpoint, QString(), QJsonObject(),
+                                                       RequestOptions());
+            context.paymentIds = batch;
+            submitRequest(context);
+        }
+    }
+    
+    // Payments left off the wheel have had their last check after expiry;
+    // tracking ends now, whether or not its answer ever comes back
+    for (const QString& paymentId : due) {
+        if (!m_statusChecks.contains(paymentId)) {
+            stopPaymentStatusCheck(paymentId);
+        }
+    }
+}
+
+void AsianCryptoPayment::scheduleStatusCheck(const QString& paymentId) {
+    const int expiryGraceMs = 2000;
+    const int pushSafetyPollIntervalMs = 60000;
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    const StatusCheckState state = m_statusCheckStates.value(paymentId);
+    
+    // Fast right after the QR code is shown, slower the longer nobody pays
+    double interval = m_pollingPolicy.initialIntervalMs;
+    for (int i = 0; i < state.checks && interval < m_pollingPolicy.maxIntervalMs; ++i) {
+        interval *= m_pollingPolicy.backoffFactor;
+    }
+    qint64 delay = qMin<qint64>(m_pollingPolicy.maxIntervalMs, qint64(interval));
+    
+    // With a healthy push channel polling is only a safety net
+    if (m_pushHealthy) {
+        delay = qMax<qint64>(delay, pushSafetyPollIntervalMs);
+    }
+    
+    QDateTime expiresAt = m_activePayments.value(paymentId).expiresAt();
+    if (expiresAt.isValid()) {
+        qint64 untilExpiry = expiresAt.toMSecsSinceEpoch() - now;
+        
+        // The check going out now is the one after expiry; it is the last,
+        // and tracking ends once it has been sent
+        if (untilExpiry + expiryGraceMs <= 0) {
+            m_statusChecks.cancel(paymentId);
+            return;
+        }
+        
+        // Fast again near expiry, and never sleeping past it
+        if (untilExpiry <= m_pollingPolicy.expiryWindowMs) {
+            delay = qMin<qint64>(delay, m_pollingPolicy.initialIntervalMs);
+        }
+        delay = qMin(delay, untilExpiry + expiryGraceMs);
+    }
+    
+    if (state.notBefore > now) {
+        delay = qMax(delay, state.notBefore - now);
+    }
+    
+    m_statusChecks.schedule(paymentId, delay);
+}
+
+void AsianCryptoPayment::applyPollHint(QNetworkReply* reply, const RequestContext& context) {
+    bool ok = false;
+    int retryAfter = reply->rawHeader("Retry-After").toInt(&ok);
+    if (!ok || retryAfter <= 0) {
+        return;
+    }
+    
+    QStringList paymentIds = context.type == RequestType::PollPayments ? context.paymentIds
+                                                                       : QStringList() << context.id;
+    qint64 notBefore = QDateTime::currentMSecsSinceEpoch() + qint64(retryAfter) * 1000;
+    
+    for (const QString& paymentId : paymentIds) {
+        auto it = m_statusCheckStates.find(paymentId);
+        if (it == m_statusCheckStates.end()) {
+            continue;
+        }
+        
+        it->notBefore = notBefore;
+        if (m_statusChecks.contains(paymentId)) {
+            scheduleStatusCheck(paymentId);
+        }
+    }
+}
+
+bool AsianCryptoPayment::pushChannelOpen() const {
+    return m_pushStreamReply || (m_pushSocket && m_pushSocket->state() != QAbstractSocket::UnconnectedState);
+}
+
+void AsianCryptoPayment::closePushChannel() {
+    if (m_pushStreamReply) {
+        m_pushStreamReply->abort();
+    }
+    if (m_pushSocket) {
+        m_pushSocket->abort();
+    }
+}
+
+void AsianCryptoPayment::connectPushChannel() {
+    if (m_pushEndpoint.isEmpty() || pushChannelOpen()) {
+        return;
+    }
+    
+    if (m_pushReconnectAttempts > 0) {
+        m_statistics.pushReconnects++;
+    }
+    
+    QUrl url(m_pushEndpoint);
+    QNetworkRequest request(m_requestTemplate);
+    request.setUrl(url);
+    request.setRawHeader("X-Timestamp", QByteArray::number(QDateTime::currentMSecsSinceEpoch()));
+    
+    if (url.scheme() == "ws" || url.scheme() == "wss") {
+        if (!m_pushSocket) {
+            m_pushSocket = new QWebSocket(QString(), QWebSocketProtocol::VersionLatest, this);
+            connect(m_pushSocket, &QWebSocket::connected, this, &AsianCryptoPayment::onPushConnected);
+            connect(m_pushSocket, &QWebSocket::disconnected, this, &AsianCryptoPayment::onPushDisconnected);
+            connect(m_pushSocket, &QWebSocket::textMessageReceived, this, &AsianCryptoPayment::onPushMessage);
+            connect(m_pushSocket, &QWebSocket::pong, this, [this]() {
+                m_pushLastPong = QDateTime::currentMSecsSinceEpoch();
+            });
+        }
+        
+        m_pushSocket->open(request);
+        return;
+    }
+    
+    // One long-lived response for all payments; the server resumes after
+    // Last-Event-ID and sends comment lines as heartbeats
+    request.setRawHeader("Accept", "text/event-stream");
+    request.setRawHeader("Cache-Control", "no-cache");
+    request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysNetwork);
+    if (m_pushSequence > 0) {
+        request.setRawHeader("Last-Event-ID", QByteArray::number(m_pushSequence));
+    }
+    
+    m_pushStreamBuffer.clear();
+    m_pushStreamReply = m_networkManager->get(request);
+    connect(m_pushStreamReply, &QNetworkReply::readyRead, this, &AsianCryptoPayment::onPushStreamData);
+    connect(m_pushStreamReply, &QNetworkReply::finished, this, &AsianCryptoPayment::onPushStreamFinished);
+    
+    m_pushLastPong = QDateTime::currentMSecsSinceEpoch();
+    m_pushPingTimer->start(pushPingIntervalMs);
+}
+
+void AsianCryptoPayment::onPushConnected() {
+    // Healthy once the server confirms the subscription
+    m_pushLastPong = QDateTime::currentMSecsSinceEpoch();
+    m_pushPingTimer->start(pushPingIntervalMs);
+    sendPushSubscription("subscribe", m_statusCheckStates.keys());
+}
+
+void AsianCryptoPayment::onPushStreamData() {
+    if (!m_pushStreamReply) {
+        return;
+    }
+    
+    if (m_pushStreamReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 200) {
+        m_pushStreamReply->abort();
+        return;
+    }
+    
+    m_pushLastPong = QDateTime::currentMSecsSinceEpoch();
+    m_pushStreamBuffer.append(m_pushStreamReply->readAll());
+    m_pushStreamBuffer.replace("\r\n", "\n");
+    
+    // Events end with a blank line; their data lines are joined, other
+    // fields and comments are not needed
+    int end;
+    while ((end = m_pushStreamBuffer.indexOf("\n\n")) >= 0) {
+        QByteArray block = m_pushStreamBuffer.left(end);
+        m_pushStreamBuffer.remove(0, end + 2);
+        
+        QByteArray data;
+        for (const QByteArray& line : block.split('\n')) {
+            if (line.startsWith("data:")) {
+                if (!data.isEmpty()) {
+                    data.append('\n');
+                }
+                data.append(line.mid(line.startsWith("data: ") ? 6 : 5));
+            }
+        }
+        
+        if (!data.isEmpty()) {
+            onPushMessage(QString::fromUtf8(data));
+        }
+    }
+}
+
+void AsianCryptoPayment::onPushStreamFinished() {
+    m_pushStreamReply->deleteLater();
+    m_pushStreamReply = nullptr;
+    onPushDisconnected();
+}
+
+void AsianCryptoPayment::onPushDisconnected() {
+    m_pushPingTimer->stop();
+    setPushHealthy(false);
+    
+    if (m_pushEndpoint.isEmpty()) {
+        return;
+    }
+    
+    // Exponential backoff with jitter, so kiosks do not reconnect together
+    double delay = qMin(30000.0, 1000.0 * double(1 << qMin(m_pushReconnectAttempts, 5)));
+    delay *= 1.0 - 0.5 * QRandomGenerator::global()->generateDouble();
+    m_pushReconnectAttempts++;
+    m_pushReconnectTimer->start(int(delay));
+}
+
+void AsianCryptoPayment::checkPushHealth() {
+    const int pongTimeoutMs = 25000;
+    
+    // A channel that stops answering pings is as good as closed
+    if (QDateTime::currentMSecsSinceEpoch() - m_pushLastPong > pongTimeoutMs) {
+        qWarning() << "Push channel stopped answering; falling back to polling";
+        closePushChannel();
+        return;
+    }
+    
+    // Event streams are kept alive by the server's heartbeats
+    if (m_pushSocket && m_pushSocket->state() == QAbstractSocket::ConnectedState) {
+        m_pushSocket->ping();
+    }
+}
+
+void AsianCryptoPayment::onPushMessage(const QString& message) {
+    QJsonObject event = QJsonDocument::fromJson(message.toUtf8()).object();
+    QString type = event["type"].toString();
+    qint64 sequence = qint64(event["sequence"].toDouble());
+    
+    // The first confirmation after connecting says whether the server
+    // replays what was missed; if not, the payments are polled instead and
+    // later resumes start from the server's current sequence
+    if (type == "subscribed") {
+        if (!m_pushHealthy) {
+            if (!event["resumed"].toBool()) {
+                if (m_pushSequence > 0) {
+                    checkAllPaymentsNow();
+                }
+                m_pushSequence = sequence;
+            }
+            
+            m_pushReconnectAttempts = 0;
+            setPushHealthy(true);
+        }
+        return;
+    }
+    
+    if (!event.contains("data") || !event["data"].isObject()) {
+        return;
+    }
+    
+    // Replays after a resume can overlap with events already seen
+    if (sequence > 0 && sequence <= m_pushSequence) {
+        return;
+    }
+    m_pushSequence = qMax(m_pushSequence, sequence);
+    
+    m_statistics.pushEvents++;
+    if (event.contains("sent_at")) {
+        m_statistics.pushDeliveryMs +=
+                quint64(qMax<qint64>(0, QDateTime::currentMSecsSinceEpoch() - qint64(event["sent_at"].toDouble())));
+    }
+    
+    dispatchPaymentEvent(event, false);
+}
+
+void AsianCryptoPayment::sendPushSubscription(const QString& type, const QStringList& paymentIds) {
+    if (!m_pushSocket || m_pushSocket->state() != QAbstractSocket::ConnectedState) {
+        return;
+    }
+    
+    QJsonObject message;
+    message["type"] = type;
+    message["payment_ids"] = QJsonArray::fromStringList(paymentIds);
+    
+    // Only the subscription made on connecting resumes
+    if (type == "subscribe" && !m_pushHealthy && m_pushSequence > 0) {
+        message["resume_from"] = double(m_pushSequence);
+    }
+    
+    m_pushSocket->sendTextMessage(QString::fromUtf8(QJsonDocument(message).toJson(QJsonDocument::Compact)));
+}
+
+void AsianCryptoPayment::setPushHealthy(bool healthy) {
+    if (m_pushHealthy == healthy) {
+        return;
+    }
+    
+    m_pushHealthy = healthy;
+    
+    // Move every check to the new schedule; after losing the channel, poll
+    // at once for whatever was missed while it was failing
+    for (auto it = m_statusCheckStates.constBegin(); it != m_statusCheckStates.constEnd(); ++it) {
+        if (m_statusChecks.contains(it.key())) {
+            scheduleStatusCheck(it.key());
+        }
+    }
+    
+    if (!healthy) {
+        checkAllPaymentsNow();
+    }
+    
+    emit pushChannelChanged(healthy);
+}
+
+void AsianCryptoPayment::checkAllPaymentsNow() {
+    for (auto it = m_statusCheckStates.constBegin(); it != m_statusCheckStates.constEnd(); ++it) {
+        m_duePaymentChecks.insert(it.key());
+    }
+    
+    if (!m_duePaymentChecks.isEmpty() && !m_pollBatchTimer->isActive()) {
+        m_pollBatchTimer->start(500);
+    }
+}
+
+void AsianCryptoPayment::handlePollReply(const QStringList& paymentIds, const QJsonObject& response) {
+    QMap<QString, Payment> received;
+    bool filtered = true;
+    QJsonArray paymentsArray = response["payments"].toArray();
+    
+    for (const QJsonValue& value : paymentsArray) {
+        Payment payment = Payment::fromJson(value.toObject());
+        
+        if (!paymentIds.contains(payment.id())) {
+            filtered = false;
+            break;
+        }
+        
+        received[payment.id()] = payment;
+    }
+    
+    // Payments outside the batch mean the server ignored the id filter;
+    // poll one by one from now on
+    if (!filtered) {
+        m_batchPollingSupported = false;
+        pollPaymentsIndividually(paymentIds);
         return;
     }
     
-    getPayment(paymentId);
+    // Payments the batch left out, possibly all of them, are fetched on
+    // their own this time only
+    QStringList missing;
+    for (const QString& paymentId : paymentIds) {
+        if (received.contains(paymentId)) {
+            applyPolledPayment(received[paymentId]);
+        } else {
+            missing.append(paymentId);
+        }
+    }
+    
+    pollPaymentsIndividually(missing);
+}
+
+void AsianCryptoPayment::pollPaymentsIndividually(const QStringList& paymentIds) {
+    // A fetch already in flight reports through applyPolledPayment as well
+    for (const QString& paymentId : paymentIds) {
+        if (m_activePayments.contains(paymentId) && !m_inflightPaymentFetches.contains(paymentId)) {
+            fetchPayment(paymentId, true, RequestOptions());
+        }
+    }
+}
+
+Payment AsianCryptoPayment::applyPolledPayment(const Payment& payment) {
+    // The answer to a last check arrives after tracking has ended; it is
+    // still reported if it brings news
+    if (!m_activePayments.contains(payment.id())) {
+        if (acceptPaymentRevision(payment)) {
+            emit paymentStatusUpdated(payment);
+        }
+        return payment;
+    }
+    
+    const Payment previous = m_activePayments[payment.id()];
+    Payment current = previous;
+    
+    if (acceptPaymentRevision(payment)) {
+        current = payment;
+        m_activePayments[payment.id()] = payment;
+        emit paymentStatusUpdated(payment);
+        
+        if (payment.status() == PaymentStatus::Completed && previous.status() != PaymentStatus::Completed &&
+                payment.updatedAt().isValid()) {
+            m_statistics.completionsDetected++;
+            m_statistics.completionDetectionMs +=
+                    quint64(qMax<qint64>(0, QDateTime::currentMSecsSinceEpoch() - payment.updatedAt().toMSecsSinceEpoch()));
+        }
+    }
+    
+    if (current.status() == PaymentStatus::Completed ||
+            current.status() == PaymentStatus::Cancelled ||
+            current.status() == PaymentStatus::Expired) {
+        stopPaymentStatusCheck(payment.id());
+    }
+    
+    return current;
+}
+
+bool AsianCryptoPayment::acceptPaymentRevision(const Payment& payment) {
+    auto statusRank = [](PaymentStatus status) {
+        switch (status) {
+            case PaymentStatus::Created: return 0;
+            case PaymentStatus::Pending: return 1;
+            default: return 2;
+        }
+    };
+    
+    // Looking a payment up marks it as recently seen; tracked payments are
+    // seen on every check, so the cache forgets finished ones first
+    PaymentRevision* revision = m_paymentRevisions.object(payment.id());
+    if (revision) {
+        // A finished payment stays finished; otherwise the server's version
+        // decides, then updated_at, then how far the status has progressed
+        int order;
+        if (statusRank(revision->status) == 2 && statusRank(payment.status()) < 2) {
+            order = -1;
+        } else if (revision->version > 0 && payment.version() > 0 && revision->version != payment.version()) {
+            order = payment.version() > revision->version ? 1 : -1;
+        } else if (revision->updatedAt.isValid() && payment.updatedAt().isValid() &&
+                   revision->updatedAt != payment.updatedAt()) {
+            order = payment.updatedAt() > revision->updatedAt ? 1 : -1;
+        } else {
+            order = statusRank(payment.status()) - statusRank(revision->status);
+        }
+        
+        if (order <= 0) {
+            if (order == 0) {
+                m_statistics.duplicateUpdates++;
+            } else {
+                m_statistics.staleUpdates++;
+            }
+            return false;
+        }
+    } else {
+        revision = new PaymentRevision;
+        m_paymentRevisions.insert(payment.id(), revision);
+    }
+    
+    revision->version = payment.version();
+    revision->updatedAt = payment.updatedAt();
+    revision->status = payment.status();
+    return true;
 }
 
 } // namespace AsianCryptoPay